@@ -0,0 +1,154 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// helpers shared by the benchmarks
+// every benchmark accepts the usual google benchmark flags, e.g. --benchmark_format=json or --benchmark_out=<file>
+// to get machine-readable results; dataset sizes are overridden with <NAME>_BENCH_* environment variables
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace bench
+{
+
+// fixtures (generated data, built indexes) are built on first use and kept until exit
+// a failed build is kept as null, so it is reported once and the benchmarks that need it are skipped
+template <typename KEY, typename VALUE>
+class LazyCache_T
+{
+public:
+	template <typename BUILD>
+	VALUE * Get ( const KEY & tKey, BUILD && fnBuild )
+	{
+		auto tFound = m_hItems.find(tKey);
+		if ( tFound!=m_hItems.end() )
+			return tFound->second.get();
+
+		std::unique_ptr<VALUE> pItem = fnBuild();
+		return ( m_hItems[tKey] = std::move(pItem) ).get();
+	}
+
+private:
+	std::map<KEY, std::unique_ptr<VALUE>> m_hItems;
+};
+
+
+inline int RunBenchmarks ( int argc, char ** argv, void (*fnRegister)() )
+{
+	fnRegister();
+	benchmark::Initialize ( &argc, argv );
+	if ( benchmark::ReportUnrecognizedArguments ( argc, argv ) )
+		return 1;
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
+
+
+inline int64_t GetEnvInt ( const char * szName, int64_t iDefault )
+{
+	const char * szValue = getenv(szName);
+	int64_t iValue = szValue ? strtoll ( szValue, nullptr, 10 ) : 0;
+	return iValue>0 ? iValue : iDefault;
+}
+
+
+inline int64_t GetTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+// monotonic, so range filters can be mapped from base values; wide enough to exercise 64-bit codecs
+inline int64_t ToInt64 ( int64_t iValue )
+{
+	return iValue*1000003 - ( 1LL << 40 );
+}
+
+
+inline std::string GetTempFile ( const std::string & sName )
+{
+	return ( std::filesystem::temp_directory_path() / sName ).string();
+}
+
+// sum of sizes of the files that start with the given path (e.g. temporary files of a builder)
+inline int64_t GetFilesSize ( const std::string & sPrefix )
+{
+	std::filesystem::path tPrefix(sPrefix);
+	std::string sStem = tPrefix.filename().string();
+	std::error_code tError;
+	int64_t iSize = 0;
+	for ( const auto & tEntry : std::filesystem::directory_iterator ( tPrefix.parent_path(), tError ) )
+		if ( tEntry.is_regular_file() && !tEntry.path().filename().string().compare ( 0, sStem.size(), sStem ) )
+			iSize += (int64_t)tEntry.file_size(tError);
+
+	return iSize;
+}
+
+#if defined(__linux__)
+inline int64_t ReadProcStatus ( const char * szField )
+{
+	FILE * pFile = fopen ( "/proc/self/status", "r" );
+	if ( !pFile )
+		return 0;
+
+	char szLine[256];
+	int64_t iValue = 0;
+	size_t tLen = strlen(szField);
+	while ( fgets ( szLine, sizeof(szLine), pFile ) )
+		if ( !strncmp ( szLine, szField, tLen ) && szLine[tLen]==':' )
+		{
+			iValue = strtoll ( szLine+tLen+1, nullptr, 10 )*1024;
+			break;
+		}
+
+	fclose(pFile);
+	return iValue;
+}
+
+// resets the peak RSS (VmHWM) of the process to the current RSS
+inline void ResetPeakRSS()
+{
+	FILE * pFile = fopen ( "/proc/self/clear_refs", "w" );
+	if ( !pFile )
+		return;
+
+	fputs ( "5", pFile );
+	fclose(pFile);
+}
+
+inline int64_t GetPeakRSS()		{ return ReadProcStatus("VmHWM"); }
+inline int64_t GetCurrentRSS()	{ return ReadProcStatus("VmRSS"); }
+#else
+// no portable way to get these; the benchmarks report zeroes
+inline void ResetPeakRSS() {}
+inline int64_t GetPeakRSS()		{ return 0; }
+inline int64_t GetCurrentRSS()	{ return 0; }
+#endif
+
+} // namespace bench
@@ -0,0 +1,522 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// micro-benchmarks for codecs, iterators, analyzers and minmax estimates over synthetic columns
+// COLUMNAR_BENCH_DOCS overrides the number of rows in each generated storage
+
+#include "columnar.h"
+#include "builder.h"
+#include "codec.h"
+#include "benchutil.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <random>
+
+using namespace columnar;
+
+// shape of a generated column; all attributes of a storage are derived from the same base values
+struct ColumnSpec_t
+{
+	const char *	m_szName;
+	int64_t			m_iCardinality;	// 0 means "as many as there are rows"
+	bool			m_bSorted;
+	int				m_iRunLength;
+};
+
+static const ColumnSpec_t g_dSpecs[] =
+{
+	{ "const",		1,		false,	1 },
+	{ "table",		16,		false,	1 },
+	{ "sorted",		0,		true,	1 },
+	{ "generic",	0,		false,	1 },
+	{ "runs",		0,		false,	64 }
+};
+
+enum class BenchAttr_e
+{
+	UINT32,
+	INT64,
+	STRING,
+	MVA,
+	BOOL,
+
+	TOTAL
+};
+
+static const char * g_dAttrNames[] = { "u32", "i64", "str", "mva", "bool" };
+
+static const char * g_dIntPackings[] = { "const", "table", "delta", "generic", "hash" };
+static const char * g_dStrPackings[] = { "const", "constlen", "table", "generic" };
+static const char * g_dMvaPackings[] = { "const", "constlen", "table", "delta_pfor", "dict", "floatvec" };
+static const char * g_dBoolPackings[] = { "const", "bitmap" };
+
+static const int BATCH_SIZE = 1024;
+
+/////////////////////////////////////////////////////////////////////
+
+static std::string ToString ( int64_t iValue )
+{
+	return "value_" + std::to_string(iValue);
+}
+
+
+static void ToMva ( int64_t iValue, std::vector<int64_t> & dMva )
+{
+	dMva.resize ( iValue % 3 + 1 );
+	for ( size_t i = 0; i < dMva.size(); i++ )
+		dMva[i] = iValue + i;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+struct Storage_t
+{
+	std::string					m_sFile;
+	std::vector<int64_t>		m_dValues;	// base values per row
+	std::vector<int64_t>		m_dSorted;	// base values, sorted; used to pick filter bounds with a given selectivity
+	std::unique_ptr<Columnar_i>	m_pColumnar;
+
+				~Storage_t() { m_pColumnar.reset(); std::error_code tError; std::filesystem::remove ( m_sFile, tError ); }
+};
+
+
+static uint32_t GetNumDocs()
+{
+	return (uint32_t)bench::GetEnvInt ( "COLUMNAR_BENCH_DOCS", 1 << 20 );
+}
+
+
+static void GenerateValues ( const ColumnSpec_t & tSpec, uint32_t uNumDocs, std::vector<int64_t> & dValues )
+{
+	std::mt19937_64 tRng(42);
+	int64_t iCardinality = tSpec.m_iCardinality ? tSpec.m_iCardinality : uNumDocs;
+
+	dValues.resize(uNumDocs);
+	int64_t iValue = 0;
+	for ( uint32_t i = 0; i < uNumDocs; i++ )
+	{
+		if ( !( i % tSpec.m_iRunLength ) )
+			iValue = tRng() % iCardinality;
+
+		dValues[i] = iValue;
+	}
+
+	if ( tSpec.m_bSorted )
+		std::sort ( dValues.begin(), dValues.end() );
+}
+
+
+static bool BuildStorage ( Storage_t & tStorage, std::string & sError )
+{
+	Schema_t tSchema;
+	for ( int i = 0; i < (int)BenchAttr_e::TOTAL; i++ )
+	{
+		static const common::AttrType_e dTypes[] = { common::AttrType_e::UINT32, common::AttrType_e::INT64, common::AttrType_e::STRING, common::AttrType_e::UINT32SET, common::AttrType_e::BOOLEAN };
+		AttrWithSettings_t tAttr;
+		tAttr.m_sName = g_dAttrNames[i];
+		tAttr.m_eType = dTypes[i];
+		tSchema.push_back(tAttr);
+	}
+
+	std::unique_ptr<Builder_i> pBuilder ( CreateColumnarBuilder ( tSchema, tStorage.m_sFile, 1u << 20, 0, sError ) );
+	if ( !pBuilder )
+		return false;
+
+	std::vector<int64_t> dMva;
+	for ( auto iValue : tStorage.m_dValues )
+	{
+		std::string sValue = ToString(iValue);
+		ToMva ( iValue, dMva );
+
+		pBuilder->SetAttr ( (int)BenchAttr_e::UINT32, iValue );
+		pBuilder->SetAttr ( (int)BenchAttr_e::INT64, bench::ToInt64(iValue) );
+		pBuilder->SetAttr ( (int)BenchAttr_e::STRING, (const uint8_t*)sValue.data(), (int)sValue.size() );
+		pBuilder->SetAttr ( (int)BenchAttr_e::MVA, dMva.data(), (int)dMva.size() );
+		pBuilder->SetAttr ( (int)BenchAttr_e::BOOL, iValue & 1 );
+	}
+
+	if ( !pBuilder->Done(sError) )
+		return false;
+
+	tStorage.m_pColumnar.reset ( CreateColumnarStorageReader ( tStorage.m_sFile, (uint32_t)tStorage.m_dValues.size(), sError ) );
+	return !!tStorage.m_pColumnar;
+}
+
+
+static Storage_t * GetStorage ( const ColumnSpec_t & tSpec )
+{
+	static bench::LazyCache_T<std::string, Storage_t> tStorages;
+	return tStorages.Get ( tSpec.m_szName, [&tSpec]
+	{
+		std::unique_ptr<Storage_t> pStorage ( new Storage_t );
+		pStorage->m_sFile = bench::GetTempFile ( std::string("columnar_bench_") + tSpec.m_szName + ".spc" );
+		GenerateValues ( tSpec, GetNumDocs(), pStorage->m_dValues );
+		pStorage->m_dSorted = pStorage->m_dValues;
+		std::sort ( pStorage->m_dSorted.begin(), pStorage->m_dSorted.end() );
+
+		std::string sError;
+		if ( !BuildStorage ( *pStorage, sError ) )
+		{
+			fprintf ( stderr, "unable to build '%s': %s\n", pStorage->m_sFile.c_str(), sError.c_str() );
+			pStorage.reset();
+		}
+
+		return pStorage;
+	} );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+class TrueBlockTester_c : public BlockTester_i
+{
+public:
+	bool	Test ( const MinMaxVec_t & ) const override { return true; }
+};
+
+
+static int StrCmp ( std::pair<const uint8_t *, int> tStrA, std::pair<const uint8_t *, int> tStrB, bool )
+{
+	int iRes = memcmp ( tStrA.first, tStrB.first, std::min ( tStrA.second, tStrB.second ) );
+	return iRes ? iRes : tStrA.second - tStrB.second;
+}
+
+
+enum class FilterKind_e
+{
+	VALUE,		// single value
+	VALUES,		// 64 values
+	RANGE,		// ~1% of rows
+	RANGE_WIDE	// ~50% of rows
+};
+
+static const char * g_dFilterNames[] = { "value", "values64", "range1pct", "range50pct" };
+
+
+static bool CreateFilter ( const Storage_t & tStorage, BenchAttr_e eAttr, FilterKind_e eKind, common::Filter_t & tFilter )
+{
+	const auto & dSorted = tStorage.m_dSorted;
+	auto fnMap = [eAttr]( int64_t iValue ){ return eAttr==BenchAttr_e::INT64 ? bench::ToInt64(iValue) : iValue; };
+
+	tFilter = common::Filter_t();
+	tFilter.m_sName = g_dAttrNames[(int)eAttr];
+	tFilter.m_eMvaAggr = eAttr==BenchAttr_e::MVA ? common::MvaAggr_e::ANY : common::MvaAggr_e::NONE;
+
+	switch ( eKind )
+	{
+	case FilterKind_e::VALUE:
+	case FilterKind_e::VALUES:
+	{
+		int iValues = eKind==FilterKind_e::VALUE ? 1 : 64;
+		std::vector<int64_t> dValues;
+		for ( int i = 0; i < iValues; i++ )
+			dValues.push_back ( dSorted[ ( dSorted.size()-1 )*( 2*i+1 )/( 2*iValues ) ] );
+
+		if ( eAttr==BenchAttr_e::BOOL )
+			dValues = { 1 };
+
+		std::sort ( dValues.begin(), dValues.end() );
+		dValues.erase ( std::unique ( dValues.begin(), dValues.end() ), dValues.end() );
+
+		if ( eAttr==BenchAttr_e::STRING )
+		{
+			tFilter.m_eType = common::FilterType_e::STRINGS;
+			tFilter.m_fnStrCmp = StrCmp;
+			for ( auto i : dValues )
+			{
+				std::string sValue = ToString(i);
+				tFilter.m_dStringValues.push_back ( std::vector<uint8_t> ( sValue.begin(), sValue.end() ) );
+			}
+		}
+		else
+		{
+			tFilter.m_eType = common::FilterType_e::VALUES;
+			for ( auto i : dValues )
+				tFilter.m_dValues.push_back ( fnMap(i) );
+		}
+	}
+	return true;
+
+	case FilterKind_e::RANGE:
+	case FilterKind_e::RANGE_WIDE:
+	{
+		if ( eAttr==BenchAttr_e::STRING || eAttr==BenchAttr_e::BOOL )
+			return false;
+
+		size_t tWidth = eKind==FilterKind_e::RANGE ? dSorted.size()/100 : dSorted.size()/2;
+		size_t tStart = ( dSorted.size()-tWidth )/2;
+		tFilter.m_eType = common::FilterType_e::RANGE;
+		tFilter.m_iMinValue = fnMap ( dSorted[tStart] );
+		tFilter.m_iMaxValue = fnMap ( dSorted[tStart+tWidth] );
+	}
+	return true;
+
+	default:
+		return false;
+	}
+}
+
+
+static void ReportStats ( benchmark::State & tState, const common::IteratorStats_t & tStats, BenchAttr_e eAttr )
+{
+	using benchmark::Counter;
+	double fIterations = (double)std::max<int64_t> ( tState.iterations(), 1 );
+	tState.counters["rows"] = Counter ( tStats.m_iRowsEmitted/fIterations );
+	tState.counters["blocks"] = Counter ( tStats.m_iBlocks/fIterations );
+	tState.counters["blocks_skipped"] = Counter ( tStats.m_iBlocksSkipped/fIterations );
+	tState.counters["subblocks"] = Counter ( tStats.m_iSubblocks/fIterations );
+	tState.counters["subblocks_minmax"] = Counter ( tStats.m_iSubblocksMinMax/fIterations );
+	tState.counters["bytes_read"] = Counter ( tStats.m_iBytesRead/fIterations );
+
+	const char ** pPackings = nullptr;
+	int iPackings = 0;
+	switch ( eAttr )
+	{
+	case BenchAttr_e::UINT32:
+	case BenchAttr_e::INT64:	pPackings = g_dIntPackings;		iPackings = (int)std::size(g_dIntPackings); break;
+	case BenchAttr_e::STRING:	pPackings = g_dStrPackings;		iPackings = (int)std::size(g_dStrPackings); break;
+	case BenchAttr_e::MVA:		pPackings = g_dMvaPackings;		iPackings = (int)std::size(g_dMvaPackings); break;
+	case BenchAttr_e::BOOL:		pPackings = g_dBoolPackings;	iPackings = (int)std::size(g_dBoolPackings); break;
+	default: break;
+	}
+
+	for ( int i = 0; i < iPackings; i++ )
+		if ( tStats.m_dBlocksByPacking[i] )
+			tState.counters[std::string("packing_") + pPackings[i]] = Counter ( tStats.m_dBlocksByPacking[i]/fIterations );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+static void BenchFetch ( benchmark::State & tState, const ColumnSpec_t & tSpec, BenchAttr_e eAttr, int iStep )
+{
+	Storage_t * pStorage = GetStorage(tSpec);
+	if ( !pStorage )
+	{
+		tState.SkipWithError ( "no storage" );
+		return;
+	}
+
+	std::string sError;
+	std::unique_ptr<Iterator_i> pIterator ( pStorage->m_pColumnar->CreateIterator ( g_dAttrNames[(int)eAttr], IteratorHints_t(), nullptr, sError ) );
+	if ( !pIterator )
+	{
+		tState.SkipWithError ( sError.c_str() );
+		return;
+	}
+
+	uint32_t uNumDocs = (uint32_t)pStorage->m_dValues.size();
+	std::vector<uint32_t> dRowIDs(BATCH_SIZE);
+	std::vector<int64_t> dValues(BATCH_SIZE);
+	bool bFixedWidth = eAttr==BenchAttr_e::UINT32 || eAttr==BenchAttr_e::INT64 || eAttr==BenchAttr_e::BOOL;
+
+	uint32_t tRowID = 0;
+	int64_t iBytes = 0;
+	for ( auto _ : tState )
+	{
+		// ascending batches; start over (with a fresh iterator state) when the end is reached
+		if ( tRowID + (uint64_t)BATCH_SIZE*iStep > uNumDocs )
+		{
+			tRowID = 0;
+			pIterator.reset ( pStorage->m_pColumnar->CreateIterator ( g_dAttrNames[(int)eAttr], IteratorHints_t(), nullptr, sError ) );
+		}
+
+		for ( auto & i : dRowIDs )
+		{
+			i = tRowID;
+			tRowID += iStep;
+		}
+
+		if ( bFixedWidth )
+		{
+			util::Span_T<uint32_t> dRowIDSpan(dRowIDs);
+			util::Span_T<int64_t> dValueSpan(dValues);
+			pIterator->Fetch ( dRowIDSpan, dValueSpan );
+			benchmark::DoNotOptimize ( dValues.data() );
+		}
+		else
+		{
+			for ( auto i : dRowIDs )
+			{
+				const uint8_t * pData = nullptr;
+				iBytes += pIterator->Get ( i, pData );
+				benchmark::DoNotOptimize(pData);
+			}
+		}
+	}
+
+	tState.SetItemsProcessed ( tState.iterations()*BATCH_SIZE );
+	if ( iBytes )
+		tState.SetBytesProcessed(iBytes);
+}
+
+
+static void BenchAnalyzer ( benchmark::State & tState, const ColumnSpec_t & tSpec, BenchAttr_e eAttr, FilterKind_e eKind )
+{
+	Storage_t * pStorage = GetStorage(tSpec);
+	common::Filter_t tFilter;
+	if ( !pStorage || !CreateFilter ( *pStorage, eAttr, eKind, tFilter ) )
+	{
+		tState.SkipWithError ( "no storage or filter" );
+		return;
+	}
+
+	TrueBlockTester_c tTester;
+	common::IteratorStats_t tTotal;
+	std::vector<common::Filter_t> dFilters { tFilter };
+	for ( auto _ : tState )
+	{
+		std::vector<int> dDeletedFilters;
+		std::string sError;
+		std::vector<common::BlockIterator_i *> dIterators = pStorage->m_pColumnar->CreateAnalyzerOrPrefilter ( dFilters, dDeletedFilters, tTester, nullptr, sError );
+		if ( dIterators.empty() )
+		{
+			tState.SkipWithError ( sError.empty() ? "no analyzer created" : sError.c_str() );
+			return;
+		}
+
+		for ( auto pRawIterator : dIterators )
+		{
+			std::unique_ptr<common::BlockIterator_i> pIterator(pRawIterator);
+			util::Span_T<uint32_t> dRowIdBlock;
+			while ( pIterator->GetNextRowIdBlock(dRowIdBlock) )
+				benchmark::DoNotOptimize ( dRowIdBlock.data() );
+
+			common::IteratorStats_t tStats;
+			pIterator->GetStats(tStats);
+			tTotal.Add(tStats);
+		}
+	}
+
+	tState.SetItemsProcessed ( tState.iterations()*pStorage->m_dValues.size() );
+	ReportStats ( tState, tTotal, eAttr );
+}
+
+
+static void BenchMinMax ( benchmark::State & tState, const ColumnSpec_t & tSpec, BenchAttr_e eAttr, FilterKind_e eKind )
+{
+	Storage_t * pStorage = GetStorage(tSpec);
+	common::Filter_t tFilter;
+	if ( !pStorage || !CreateFilter ( *pStorage, eAttr, eKind, tFilter ) )
+	{
+		tState.SkipWithError ( "no storage or filter" );
+		return;
+	}
+
+	TrueBlockTester_c tTester;
+	int64_t iEstimate = 0;
+	for ( auto _ : tState )
+	{
+		iEstimate = pStorage->m_pColumnar->EstimateMinMax ( tFilter, tTester );
+		benchmark::DoNotOptimize(iEstimate);
+	}
+
+	tState.counters["estimate"] = (double)iEstimate;
+}
+
+
+static void BenchCodec ( benchmark::State & tState, const ColumnSpec_t & tSpec, const std::string & sCodec, bool bDecode )
+{
+	Storage_t * pStorage = GetStorage(tSpec);
+	if ( !pStorage )
+	{
+		tState.SkipWithError ( "no storage" );
+		return;
+	}
+
+	std::unique_ptr<util::IntCodec_i> pCodec ( util::CreateIntCodec ( sCodec, "fastpfor256" ) );
+
+	// one subblock worth of values, the unit the packers compress (less if the storage is smaller)
+	const size_t SUBBLOCK_SIZE = 1024;
+	std::vector<uint32_t> dSource ( std::min ( SUBBLOCK_SIZE, pStorage->m_dValues.size() ) );
+	for ( size_t i = 0; i < dSource.size(); i++ )
+		dSource[i] = (uint32_t)pStorage->m_dValues[i];
+
+	std::vector<uint32_t> dCompressed;
+	pCodec->Encode ( util::Span_T<uint32_t>(dSource), dCompressed );
+	util::SpanResizeable_T<uint32_t> dDecompressed;
+
+	for ( auto _ : tState )
+	{
+		if ( bDecode )
+		{
+			pCodec->Decode ( util::Span_T<uint32_t>(dCompressed), dDecompressed );
+			benchmark::DoNotOptimize ( dDecompressed.data() );
+		}
+		else
+		{
+			dCompressed.clear();
+			pCodec->Encode ( util::Span_T<uint32_t>(dSource), dCompressed );
+			benchmark::DoNotOptimize ( dCompressed.data() );
+		}
+	}
+
+	tState.SetItemsProcessed ( tState.iterations()*dSource.size() );
+	tState.SetBytesProcessed ( tState.iterations()*dSource.size()*sizeof(uint32_t) );
+	tState.counters["ratio"] = double ( dSource.size() ) / std::max<size_t> ( dCompressed.size(), 1 );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+static void RegisterBenchmarks()
+{
+	static const char * dCodecs[] = { "libstreamvbyte", "simdfastpfor128", "fastpfor128", "fastpfor256", "simdbinarypacking", "simple8b", "varint" };
+	static const int dSteps[] = { 1, 16, 256 };
+
+	for ( const auto & tSpec : g_dSpecs )
+	{
+		std::string sSpec = tSpec.m_szName;
+
+		for ( auto szCodec : dCodecs )
+		{
+			std::string sCodec = szCodec;
+			benchmark::RegisterBenchmark ( ( "Codec/encode/" + sSpec + "/" + sCodec ).c_str(), BenchCodec, tSpec, sCodec, false );
+			benchmark::RegisterBenchmark ( ( "Codec/decode/" + sSpec + "/" + sCodec ).c_str(), BenchCodec, tSpec, sCodec, true );
+		}
+
+		for ( int iAttr = 0; iAttr < (int)BenchAttr_e::TOTAL; iAttr++ )
+		{
+			auto eAttr = (BenchAttr_e)iAttr;
+			std::string sAttr = g_dAttrNames[iAttr];
+
+			for ( auto iStep : dSteps )
+				benchmark::RegisterBenchmark ( ( "Fetch/" + sAttr + "/" + sSpec + "/step" + std::to_string(iStep) ).c_str(), BenchFetch, tSpec, eAttr, iStep );
+
+			for ( int iKind = 0; iKind < (int)std::size(g_dFilterNames); iKind++ )
+			{
+				auto eKind = (FilterKind_e)iKind;
+				bool bRange = eKind==FilterKind_e::RANGE || eKind==FilterKind_e::RANGE_WIDE;
+				if ( bRange && ( eAttr==BenchAttr_e::STRING || eAttr==BenchAttr_e::BOOL ) )
+					continue;
+
+				std::string sName = sAttr + "/" + sSpec + "/" + g_dFilterNames[iKind];
+				benchmark::RegisterBenchmark ( ( "Analyzer/" + sName ).c_str(), BenchAnalyzer, tSpec, eAttr, eKind );
+				if ( bRange )
+					benchmark::RegisterBenchmark ( ( "EstimateMinMax/" + sName ).c_str(), BenchMinMax, tSpec, eAttr, eKind );
+			}
+		}
+	}
+}
+
+
+int main ( int argc, char ** argv )
+{
+	return bench::RunBenchmarks ( argc, argv, RegisterBenchmarks );
+}
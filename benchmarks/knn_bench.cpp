@@ -0,0 +1,322 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// HNSW recall/latency benchmarks over clustered synthetic vectors
+// KNN_BENCH_DOCS, KNN_BENCH_DIMS and KNN_BENCH_QUERIES override the dataset size
+
+#include "knn/knn.h"
+#include "benchutil.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+
+static const int NUM_CLUSTERS = 64;
+static const int TOP_K = 10;
+static const char * ATTR_NAME = "vec";
+
+static const char * g_dSimilarityNames[] = { "l2", "ip", "cosine" };
+
+static void Normalize ( float * pVec, int iDims )
+{
+	double fNorm = 0.0;
+	for ( int i = 0; i < iDims; i++ )
+		fNorm += pVec[i]*pVec[i];
+
+	fNorm = std::sqrt(fNorm);
+	if ( fNorm>0.0 )
+		for ( int i = 0; i < iDims; i++ )
+			pVec[i] = float ( pVec[i]/fNorm );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+struct Dataset_t
+{
+	int							m_iDims = 0;
+	std::vector<float>			m_dDocs;		// row-major, one vector per row
+	std::vector<float>			m_dQueries;
+	std::vector<uint32_t>		m_dTruth;		// TOP_K nearest rowids per query
+
+	int				GetNumDocs() const					{ return int ( m_dDocs.size()/m_iDims ); }
+	int				GetNumQueries() const				{ return int ( m_dQueries.size()/m_iDims ); }
+	util::Span_T<float> GetDoc ( int iDoc )				{ return util::Span_T<float> ( &m_dDocs[size_t(iDoc)*m_iDims], m_iDims ); }
+	util::Span_T<float> GetQuery ( int iQuery )			{ return util::Span_T<float> ( &m_dQueries[size_t(iQuery)*m_iDims], m_iDims ); }
+};
+
+
+static void GenerateVectors ( std::mt19937_64 & tRng, const std::vector<float> & dCenters, int iDims, int iNumVectors, std::vector<float> & dVectors )
+{
+	// gaussian blobs around random cluster centers
+	std::normal_distribution<float> tNoise ( 0.0f, 0.15f );
+	std::uniform_int_distribution<int> tCluster ( 0, NUM_CLUSTERS-1 );
+
+	dVectors.resize ( size_t(iNumVectors)*iDims );
+	for ( int i = 0; i < iNumVectors; i++ )
+	{
+		const float * pCenter = &dCenters[size_t ( tCluster(tRng) )*iDims];
+		float * pVec = &dVectors[size_t(i)*iDims];
+		for ( int iDim = 0; iDim < iDims; iDim++ )
+			pVec[iDim] = pCenter[iDim] + tNoise(tRng);
+	}
+}
+
+
+static void CalcGroundTruth ( Dataset_t & tDataset, knn::HNSWSimilarity_e eSimilarity )
+{
+	knn::IndexSettings_t tSettings;
+	tSettings.m_iDims = tDataset.m_iDims;
+	tSettings.m_eHNSWSimilarity = eSimilarity;
+	std::unique_ptr<knn::Distance_i> pDist ( CreateDistanceCalc(tSettings) );
+
+	int iNumDocs = tDataset.GetNumDocs();
+	std::vector<std::pair<float,uint32_t>> dDists(iNumDocs);
+	tDataset.m_dTruth.resize ( size_t ( tDataset.GetNumQueries() )*TOP_K );
+	for ( int iQuery = 0; iQuery < tDataset.GetNumQueries(); iQuery++ )
+	{
+		auto dQuery = tDataset.GetQuery(iQuery);
+		for ( int iDoc = 0; iDoc < iNumDocs; iDoc++ )
+			dDists[iDoc] = { pDist->CalcDist ( dQuery, tDataset.GetDoc(iDoc) ), (uint32_t)iDoc };
+
+		int iTop = std::min ( TOP_K, iNumDocs );
+		std::partial_sort ( dDists.begin(), dDists.begin()+iTop, dDists.end() );
+		for ( int i = 0; i < iTop; i++ )
+			tDataset.m_dTruth[size_t(iQuery)*TOP_K+i] = dDists[i].second;
+	}
+}
+
+
+static std::unique_ptr<Dataset_t> GenerateDataset ( knn::HNSWSimilarity_e eSimilarity )
+{
+	std::unique_ptr<Dataset_t> pDataset ( new Dataset_t );
+	pDataset->m_iDims = (int)bench::GetEnvInt ( "KNN_BENCH_DIMS", 128 );
+	int iDims = pDataset->m_iDims;
+
+	std::mt19937_64 tRng(42);
+	std::uniform_real_distribution<float> tUniform ( -1.0f, 1.0f );
+	std::vector<float> dCenters ( size_t(NUM_CLUSTERS)*iDims );
+	for ( auto & i : dCenters )
+		i = tUniform(tRng);
+
+	GenerateVectors ( tRng, dCenters, iDims, (int)bench::GetEnvInt ( "KNN_BENCH_DOCS", 100000 ), pDataset->m_dDocs );
+	GenerateVectors ( tRng, dCenters, iDims, (int)bench::GetEnvInt ( "KNN_BENCH_QUERIES", 1000 ), pDataset->m_dQueries );
+
+	// the index normalizes documents for COSINE but expects queries to be normalized by the caller
+	if ( eSimilarity==knn::HNSWSimilarity_e::COSINE )
+	{
+		for ( int i = 0; i < pDataset->GetNumDocs(); i++ )
+			Normalize ( pDataset->GetDoc(i).data(), iDims );
+
+		for ( int i = 0; i < pDataset->GetNumQueries(); i++ )
+			Normalize ( pDataset->GetQuery(i).data(), iDims );
+	}
+
+	CalcGroundTruth ( *pDataset, eSimilarity );
+	return pDataset;
+}
+
+
+static Dataset_t * GetDataset ( knn::HNSWSimilarity_e eSimilarity )
+{
+	// one dataset (with its own ground truth) per similarity
+	static bench::LazyCache_T<knn::HNSWSimilarity_e, Dataset_t> tDatasets;
+	return tDatasets.Get ( eSimilarity, [eSimilarity]{ return GenerateDataset(eSimilarity); } );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+struct IndexParams_t
+{
+	knn::HNSWSimilarity_e	m_eSimilarity = knn::HNSWSimilarity_e::L2;
+	int						m_iM = 16;
+	int						m_iEFConstruction = 200;
+
+	std::string	GetName() const { return std::string ( g_dSimilarityNames[(int)m_eSimilarity] ) + "/M" + std::to_string(m_iM) + "/efc" + std::to_string(m_iEFConstruction); }
+};
+
+
+struct Index_t
+{
+	std::string					m_sFile;
+	int64_t						m_iBuildTimeNs = 0;
+	int64_t						m_iFileBytes = 0;
+	std::unique_ptr<knn::KNN_i>	m_pKNN;
+
+				~Index_t() { m_pKNN.reset(); std::error_code tError; std::filesystem::remove ( m_sFile, tError ); }
+};
+
+
+static bool BuildIndex ( Dataset_t & tDataset, const IndexParams_t & tParams, Index_t & tIndex, std::string & sError )
+{
+	knn::AttrWithSettings_t tAttr;
+	tAttr.m_sName = ATTR_NAME;
+	tAttr.m_eType = common::AttrType_e::FLOATVEC;
+	tAttr.m_iDims = tDataset.m_iDims;
+	tAttr.m_eHNSWSimilarity = tParams.m_eSimilarity;
+	tAttr.m_iHNSWM = tParams.m_iM;
+	tAttr.m_iHNSWEFConstruction = tParams.m_iEFConstruction;
+
+	int64_t iStart = bench::GetTimeNs();
+	std::unique_ptr<knn::Builder_i> pBuilder ( CreateKNNBuilder ( { tAttr }, tDataset.GetNumDocs() ) );
+	for ( int i = 0; i < tDataset.GetNumDocs(); i++ )
+		if ( !pBuilder->SetAttr ( 0, tDataset.GetDoc(i) ) )
+		{
+			sError = pBuilder->GetError();
+			return false;
+		}
+
+	if ( !pBuilder->Save ( tIndex.m_sFile, 1 << 20, sError ) )
+		return false;
+
+	tIndex.m_iBuildTimeNs = bench::GetTimeNs()-iStart;
+	tIndex.m_iFileBytes = bench::GetFilesSize ( tIndex.m_sFile );
+
+	tIndex.m_pKNN.reset ( CreateKNN() );
+	return tIndex.m_pKNN->Load ( tIndex.m_sFile, sError );
+}
+
+
+static Index_t * GetIndex ( const IndexParams_t & tParams )
+{
+	static bench::LazyCache_T<std::string, Index_t> tIndexes;
+	return tIndexes.Get ( tParams.GetName(), [&tParams]
+	{
+		std::string sFileName = "knn_bench_" + tParams.GetName() + ".knn";
+		std::replace ( sFileName.begin(), sFileName.end(), '/', '_' );
+
+		std::unique_ptr<Index_t> pIndex ( new Index_t );
+		pIndex->m_sFile = bench::GetTempFile(sFileName);
+
+		std::string sError;
+		if ( !BuildIndex ( *GetDataset ( tParams.m_eSimilarity ), tParams, *pIndex, sError ) )
+		{
+			fprintf ( stderr, "unable to build '%s': %s\n", pIndex->m_sFile.c_str(), sError.c_str() );
+			pIndex.reset();
+		}
+
+		return pIndex;
+	} );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+static void BenchBuild ( benchmark::State & tState, IndexParams_t tParams )
+{
+	// the dataset and its ground truth are generated before timing starts
+	GetDataset ( tParams.m_eSimilarity );
+
+	for ( auto _ : tState )
+	{
+		Index_t * pIndex = GetIndex(tParams);
+		if ( !pIndex )
+		{
+			tState.SkipWithError ( "unable to build index" );
+			return;
+		}
+
+		tState.SetIterationTime ( pIndex->m_iBuildTimeNs/1e9 );
+		tState.counters["index_mb"] = pIndex->m_iFileBytes/1048576.0;
+	}
+}
+
+
+static void BenchSearch ( benchmark::State & tState, IndexParams_t tParams, int iEf )
+{
+	Index_t * pIndex = GetIndex(tParams);
+	if ( !pIndex )
+	{
+		tState.SkipWithError ( "unable to build index" );
+		return;
+	}
+
+	Dataset_t & tDataset = *GetDataset ( tParams.m_eSimilarity );
+	int iNumQueries = tDataset.GetNumQueries();
+
+	std::vector<int64_t> dLatencies;
+	std::vector<uint32_t> dResults ( size_t(iNumQueries)*TOP_K, UINT32_MAX );
+	int iQuery = 0;
+	for ( auto _ : tState )
+	{
+		std::string sError;
+		int64_t iStart = bench::GetTimeNs();
+		std::unique_ptr<knn::Iterator_i> pIterator ( pIndex->m_pKNN->CreateIterator ( ATTR_NAME, tDataset.GetQuery(iQuery), TOP_K, iEf, sError ) );
+		if ( !pIterator )
+		{
+			tState.SkipWithError ( sError.c_str() );
+			return;
+		}
+
+		auto dData = pIterator->GetData();
+		dLatencies.push_back ( bench::GetTimeNs()-iStart );
+
+		for ( size_t i = 0; i < dData.size() && i < TOP_K; i++ )
+			dResults[size_t(iQuery)*TOP_K+i] = dData[i].m_tRowID;
+
+		iQuery = ( iQuery+1 ) % iNumQueries;
+	}
+
+	// recall over the queries that were run at least once
+	int64_t iFound = 0;
+	int64_t iTotal = 0;
+	for ( int i = 0; i < std::min<int64_t> ( iNumQueries, tState.iterations() ); i++ )
+	{
+		auto tTruthStart = tDataset.m_dTruth.begin() + size_t(i)*TOP_K;
+		for ( int iResult = 0; iResult < TOP_K; iResult++ )
+			iFound += std::find ( tTruthStart, tTruthStart+TOP_K, dResults[size_t(i)*TOP_K+iResult] )!=tTruthStart+TOP_K;
+
+		iTotal += TOP_K;
+	}
+
+	std::sort ( dLatencies.begin(), dLatencies.end() );
+	auto fnPercentile = [&dLatencies]( double fPercentile ){ return dLatencies.empty() ? 0.0 : dLatencies[size_t ( ( dLatencies.size()-1 )*fPercentile )]/1000.0; };
+
+	tState.SetItemsProcessed ( tState.iterations() );	// items/s is QPS
+	tState.counters["recall"] = iTotal ? double(iFound)/iTotal : 0.0;
+	tState.counters["p50_us"] = fnPercentile(0.5);
+	tState.counters["p95_us"] = fnPercentile(0.95);
+	tState.counters["p99_us"] = fnPercentile(0.99);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+static void RegisterBenchmarks()
+{
+	static const knn::HNSWSimilarity_e dSimilarities[] = { knn::HNSWSimilarity_e::L2, knn::HNSWSimilarity_e::IP, knn::HNSWSimilarity_e::COSINE };
+	static const int dM[] = { 8, 16, 32 };
+	static const int dEFConstruction[] = { 100, 200 };
+	static const int dEF[] = { 10, 20, 40, 80, 160, 320 };
+
+	for ( auto eSimilarity : dSimilarities )
+		for ( auto iM : dM )
+			for ( auto iEFConstruction : dEFConstruction )
+			{
+				IndexParams_t tParams { eSimilarity, iM, iEFConstruction };
+				std::string sName = tParams.GetName();
+
+				benchmark::RegisterBenchmark ( ( "Build/" + sName ).c_str(), BenchBuild, tParams )->Iterations(1)->UseManualTime()->Unit(benchmark::kMillisecond);
+				for ( auto iEf : dEF )
+					benchmark::RegisterBenchmark ( ( "Search/" + sName + "/ef" + std::to_string(iEf) ).c_str(), BenchSearch, tParams, iEf )->Unit(benchmark::kMicrosecond);
+			}
+}
+
+
+int main ( int argc, char ** argv )
+{
+	return bench::RunBenchmarks ( argc, argv, RegisterBenchmarks );
+}
@@ -0,0 +1,410 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// secondary index build and query benchmarks over synthetic distributions
+// SECONDARY_BENCH_DOCS overrides the number of rows in each generated index
+
+#include "secondary/secondary.h"
+#include "secondary/builder.h"
+#include "common/filter.h"
+#include "common/blockiterator.h"
+#include "benchutil.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <random>
+
+struct Distribution_t
+{
+	const char *	m_szName;
+	int64_t			m_iCardinality;	// 0 means "a quarter of the rows"
+	bool			m_bSorted;
+	bool			m_bSkewed;		// power-law frequencies instead of uniform ones
+};
+
+static const Distribution_t g_dDistributions[] =
+{
+	{ "uniform",	0,		false,	false },
+	{ "lowcard",	100,	false,	false },
+	{ "skewed",		0,		false,	true },
+	{ "sorted",		0,		true,	false }
+};
+
+static const char * g_dAttrNames[] = { "u32", "i64" };
+
+static uint32_t GetNumDocs()
+{
+	return (uint32_t)bench::GetEnvInt ( "SECONDARY_BENCH_DOCS", 1 << 22 );
+}
+
+
+static void GenerateValues ( const Distribution_t & tDist, uint32_t uNumDocs, std::vector<int64_t> & dValues )
+{
+	std::mt19937_64 tRng(42);
+	std::uniform_real_distribution<double> tUniform ( 0.0, 1.0 );
+	int64_t iCardinality = tDist.m_iCardinality ? tDist.m_iCardinality : std::max<int64_t> ( uNumDocs/4, 1 );
+
+	dValues.resize(uNumDocs);
+	for ( auto & i : dValues )
+		i = tDist.m_bSkewed ? int64_t ( iCardinality*std::pow ( tUniform(tRng), 4.0 ) ) : int64_t ( tRng() % iCardinality );
+
+	if ( tDist.m_bSorted )
+		std::sort ( dValues.begin(), dValues.end() );
+}
+
+
+static std::string GetIndexFile ( const Distribution_t & tDist, int iMemoryLimit )
+{
+	return bench::GetTempFile ( std::string("secondary_bench_") + tDist.m_szName + "_" + std::to_string(iMemoryLimit) + ".spidx" );
+}
+
+
+struct BuildStats_t
+{
+	int64_t	m_iTimeNs = 0;
+	int64_t	m_iPeakRSS = 0;
+	int64_t	m_iTempBytes = 0;
+	int64_t	m_iIndexBytes = 0;
+};
+
+
+static bool BuildIndex ( const std::vector<int64_t> & dValues, const std::string & sFile, int iMemoryLimit, BuildStats_t & tStats, std::string & sError )
+{
+	common::Schema_t tSchema;
+	tSchema.push_back ( { g_dAttrNames[0], common::AttrType_e::UINT32, nullptr } );
+	tSchema.push_back ( { g_dAttrNames[1], common::AttrType_e::INT64, nullptr } );
+
+	bench::ResetPeakRSS();
+	int64_t iStart = bench::GetTimeNs();
+
+	std::unique_ptr<SI::Builder_i> pBuilder ( CreateBuilder ( tSchema, iMemoryLimit, sFile, 1 << 20, sError ) );
+	if ( !pBuilder )
+		return false;
+
+	for ( size_t i = 0; i < dValues.size(); i++ )
+	{
+		pBuilder->SetRowID ( (uint32_t)i );
+		pBuilder->SetAttr ( 0, dValues[i] );
+		pBuilder->SetAttr ( 1, bench::ToInt64 ( dValues[i] ) );
+	}
+
+	// everything spilled so far is still on disk; Done() merges the spills and removes them
+	tStats.m_iTempBytes = bench::GetFilesSize ( sFile + "." );
+
+	if ( !pBuilder->Done(sError) )
+		return false;
+
+	tStats.m_iTimeNs = bench::GetTimeNs() - iStart;
+	tStats.m_iPeakRSS = bench::GetPeakRSS();
+	tStats.m_iIndexBytes = bench::GetFilesSize(sFile);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+struct Index_t
+{
+	std::string					m_sFile;
+	std::vector<int64_t>		m_dValues;	// base values per row
+	std::vector<int64_t>		m_dSorted;
+	std::vector<int64_t>		m_dUniques;
+	std::unique_ptr<SI::Index_i> m_pIndex;
+
+				~Index_t() { m_pIndex.reset(); std::error_code tError; std::filesystem::remove ( m_sFile, tError ); }
+};
+
+
+static Index_t * GetIndex ( const Distribution_t & tDist )
+{
+	// indexes used by queries are built with a generous memory limit
+	static bench::LazyCache_T<std::string, Index_t> tIndexes;
+	return tIndexes.Get ( tDist.m_szName, [&tDist]
+	{
+		const int MEMORY_LIMIT = 256 << 20;
+		std::unique_ptr<Index_t> pIndex ( new Index_t );
+		pIndex->m_sFile = GetIndexFile ( tDist, MEMORY_LIMIT );
+		GenerateValues ( tDist, GetNumDocs(), pIndex->m_dValues );
+		pIndex->m_dSorted = pIndex->m_dValues;
+		std::sort ( pIndex->m_dSorted.begin(), pIndex->m_dSorted.end() );
+		pIndex->m_dUniques = pIndex->m_dSorted;
+		pIndex->m_dUniques.erase ( std::unique ( pIndex->m_dUniques.begin(), pIndex->m_dUniques.end() ), pIndex->m_dUniques.end() );
+
+		BuildStats_t tStats;
+		std::string sError;
+		if ( BuildIndex ( pIndex->m_dValues, pIndex->m_sFile, MEMORY_LIMIT, tStats, sError ) )
+			pIndex->m_pIndex.reset ( CreateSecondaryIndex ( pIndex->m_sFile.c_str(), sError ) );
+
+		if ( !pIndex->m_pIndex )
+		{
+			fprintf ( stderr, "unable to build '%s': %s\n", pIndex->m_sFile.c_str(), sError.c_str() );
+			pIndex.reset();
+		}
+
+		return pIndex;
+	} );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+enum class FilterKind_e
+{
+	VALUES,
+	RANGE
+};
+
+struct Query_t
+{
+	FilterKind_e	m_eKind = FilterKind_e::VALUES;
+	int				m_iAttr = 0;
+	int				m_iValues = 1;			// VALUES: number of values
+	double			m_fSelectivity = 0.0;	// RANGE: fraction of rows
+	bool			m_bBounded = false;		// limit rowids to the middle 10% of the index
+};
+
+
+static common::Filter_t CreateFilter ( const Index_t & tIndex, const Query_t & tQuery, int64_t & iExpectedRows )
+{
+	auto fnMap = [&tQuery]( int64_t iValue ){ return tQuery.m_iAttr ? bench::ToInt64(iValue) : iValue; };
+
+	common::Filter_t tFilter;
+	tFilter.m_sName = g_dAttrNames[tQuery.m_iAttr];
+
+	const auto & dSorted = tIndex.m_dSorted;
+	if ( tQuery.m_eKind==FilterKind_e::VALUES )
+	{
+		// evenly spread over the distinct values
+		const auto & dUniques = tIndex.m_dUniques;
+		int iValues = std::min ( tQuery.m_iValues, (int)dUniques.size() );
+		tFilter.m_eType = common::FilterType_e::VALUES;
+		iExpectedRows = 0;
+		for ( int i = 0; i < iValues; i++ )
+		{
+			int64_t iValue = dUniques[ ( dUniques.size()-1 )*( 2*int64_t(i)+1 )/( 2*int64_t(iValues) ) ];
+			if ( !tFilter.m_dValues.empty() && tFilter.m_dValues.back()==fnMap(iValue) )
+				continue;
+
+			tFilter.m_dValues.push_back ( fnMap(iValue) );
+			iExpectedRows += std::upper_bound ( dSorted.begin(), dSorted.end(), iValue ) - std::lower_bound ( dSorted.begin(), dSorted.end(), iValue );
+		}
+	}
+	else
+	{
+		size_t tWidth = std::max<size_t> ( size_t ( dSorted.size()*tQuery.m_fSelectivity ), 1 );
+		size_t tStart = ( dSorted.size()-tWidth )/2;
+		tFilter.m_eType = common::FilterType_e::RANGE;
+		tFilter.m_iMinValue = fnMap ( dSorted[tStart] );
+		tFilter.m_iMaxValue = fnMap ( dSorted[tStart+tWidth-1] );
+		iExpectedRows = (int64_t)tWidth;
+	}
+
+	return tFilter;
+}
+
+
+static common::RowidRange_t GetBounds ( const Index_t & tIndex )
+{
+	uint32_t uNumDocs = (uint32_t)tIndex.m_dValues.size();
+	common::RowidRange_t tBounds;
+	tBounds.m_uMin = uNumDocs/20*9;
+	tBounds.m_uMax = uNumDocs/20*11;
+	return tBounds;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+static void BenchBuild ( benchmark::State & tState, const Distribution_t & tDist, int iMemoryLimit )
+{
+	std::vector<int64_t> dValues;
+	GenerateValues ( tDist, GetNumDocs(), dValues );
+	std::string sFile = GetIndexFile ( tDist, iMemoryLimit ) + ".build";
+
+	BuildStats_t tStats;
+	for ( auto _ : tState )
+	{
+		std::string sError;
+		if ( !BuildIndex ( dValues, sFile, iMemoryLimit, tStats, sError ) )
+		{
+			tState.SkipWithError ( sError.c_str() );
+			break;
+		}
+
+		tState.SetIterationTime ( tStats.m_iTimeNs/1e9 );
+	}
+
+	std::error_code tError;
+	std::filesystem::remove ( sFile, tError );
+
+	tState.SetItemsProcessed ( tState.iterations()*dValues.size() );
+	tState.counters["peak_rss_mb"] = tStats.m_iPeakRSS/1048576.0;
+	tState.counters["temp_mb"] = tStats.m_iTempBytes/1048576.0;
+	tState.counters["index_mb"] = tStats.m_iIndexBytes/1048576.0;
+}
+
+
+static void BenchIterators ( benchmark::State & tState, const Distribution_t & tDist, Query_t tQuery )
+{
+	Index_t * pIndex = GetIndex(tDist);
+	if ( !pIndex )
+	{
+		tState.SkipWithError ( "no index" );
+		return;
+	}
+
+	int64_t iExpectedRows = 0;
+	common::Filter_t tFilter = CreateFilter ( *pIndex, tQuery, iExpectedRows );
+	common::RowidRange_t tBounds = GetBounds(*pIndex);
+	uint32_t uNumDocs = (uint32_t)pIndex->m_dValues.size();
+
+	int64_t iRows = 0;
+	int64_t iIterators = 0;
+	for ( auto _ : tState )
+	{
+		std::vector<common::BlockIterator_i *> dIterators;
+		std::string sError;
+		if ( !pIndex->m_pIndex->CreateIterators ( dIterators, tFilter, tQuery.m_bBounded ? &tBounds : nullptr, uNumDocs, iExpectedRows, -1, nullptr, sError ) )
+		{
+			tState.SkipWithError ( sError.c_str() );
+			return;
+		}
+
+		iIterators += dIterators.size();
+		for ( auto pRawIterator : dIterators )
+		{
+			std::unique_ptr<common::BlockIterator_i> pIterator(pRawIterator);
+			util::Span_T<uint32_t> dRowIdBlock;
+			while ( pIterator->GetNextRowIdBlock(dRowIdBlock) )
+				iRows += dRowIdBlock.size();
+		}
+	}
+
+	double fIterations = (double)std::max<int64_t> ( tState.iterations(), 1 );
+	tState.SetItemsProcessed(iRows);
+	tState.counters["rows"] = iRows/fIterations;
+	tState.counters["iterators"] = iIterators/fIterations;
+}
+
+
+static void BenchCalcCount ( benchmark::State & tState, const Distribution_t & tDist, Query_t tQuery )
+{
+	Index_t * pIndex = GetIndex(tDist);
+	if ( !pIndex )
+	{
+		tState.SkipWithError ( "no index" );
+		return;
+	}
+
+	int64_t iExpectedRows = 0;
+	common::Filter_t tFilter = CreateFilter ( *pIndex, tQuery, iExpectedRows );
+	uint32_t uCount = 0;
+	for ( auto _ : tState )
+	{
+		std::string sError;
+		if ( !pIndex->m_pIndex->CalcCount ( uCount, tFilter, (uint32_t)pIndex->m_dValues.size(), sError ) )
+		{
+			tState.SkipWithError ( sError.c_str() );
+			return;
+		}
+
+		benchmark::DoNotOptimize(uCount);
+	}
+
+	tState.counters["count"] = (double)uCount;
+}
+
+
+static void BenchNumIterators ( benchmark::State & tState, const Distribution_t & tDist, Query_t tQuery )
+{
+	Index_t * pIndex = GetIndex(tDist);
+	if ( !pIndex )
+	{
+		tState.SkipWithError ( "no index" );
+		return;
+	}
+
+	int64_t iExpectedRows = 0;
+	common::Filter_t tFilter = CreateFilter ( *pIndex, tQuery, iExpectedRows );
+	uint32_t uIterators = 0;
+	for ( auto _ : tState )
+	{
+		uIterators = pIndex->m_pIndex->GetNumIterators(tFilter);
+		benchmark::DoNotOptimize(uIterators);
+	}
+
+	tState.counters["iterators"] = (double)uIterators;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+static void RegisterBenchmarks()
+{
+	static const int dMemoryLimits[] = { 16 << 20, 64 << 20, 256 << 20, 1024 << 20 };
+	static const int dNumValues[] = { 1, 10, 100, 1000, 10000 };
+	static const double dSelectivities[] = { 0.001, 0.01, 0.1, 0.5 };
+
+	for ( const auto & tDist : g_dDistributions )
+	{
+		std::string sDist = tDist.m_szName;
+		for ( auto iLimit : dMemoryLimits )
+			benchmark::RegisterBenchmark ( ( "Build/" + sDist + "/mem" + std::to_string ( iLimit>>20 ) + "mb" ).c_str(), BenchBuild, tDist, iLimit )
+				->Iterations(1)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+		for ( int iAttr = 0; iAttr < (int)std::size(g_dAttrNames); iAttr++ )
+		{
+			std::string sPrefix = sDist + "/" + g_dAttrNames[iAttr];
+
+			for ( auto iValues : dNumValues )
+			{
+				Query_t tQuery;
+				tQuery.m_iAttr = iAttr;
+				tQuery.m_iValues = iValues;
+				std::string sName = sPrefix + "/values" + std::to_string(iValues);
+
+				benchmark::RegisterBenchmark ( ( "Values/" + sName ).c_str(), BenchIterators, tDist, tQuery );
+				benchmark::RegisterBenchmark ( ( "CalcCount/" + sName ).c_str(), BenchCalcCount, tDist, tQuery );
+				benchmark::RegisterBenchmark ( ( "NumIterators/" + sName ).c_str(), BenchNumIterators, tDist, tQuery );
+
+				tQuery.m_bBounded = true;
+				benchmark::RegisterBenchmark ( ( "ValuesBounded/" + sName ).c_str(), BenchIterators, tDist, tQuery );
+			}
+
+			for ( auto fSelectivity : dSelectivities )
+			{
+				Query_t tQuery;
+				tQuery.m_eKind = FilterKind_e::RANGE;
+				tQuery.m_iAttr = iAttr;
+				tQuery.m_fSelectivity = fSelectivity;
+				std::string sName = sPrefix + "/range" + std::to_string ( fSelectivity*100 ).substr ( 0, 4 ) + "pct";
+
+				benchmark::RegisterBenchmark ( ( "Range/" + sName ).c_str(), BenchIterators, tDist, tQuery );
+				benchmark::RegisterBenchmark ( ( "CalcCount/" + sName ).c_str(), BenchCalcCount, tDist, tQuery );
+				benchmark::RegisterBenchmark ( ( "NumIterators/" + sName ).c_str(), BenchNumIterators, tDist, tQuery );
+
+				tQuery.m_bBounded = true;
+				benchmark::RegisterBenchmark ( ( "RangeBounded/" + sName ).c_str(), BenchIterators, tDist, tQuery );
+			}
+		}
+	}
+}
+
+
+int main ( int argc, char ** argv )
+{
+	return bench::RunBenchmarks ( argc, argv, RegisterBenchmarks );
+}
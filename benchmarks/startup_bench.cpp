@@ -0,0 +1,399 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// segment open benchmarks: latency, resident memory and heap footprint of columnar storages, secondary indexes and KNN indexes
+// STARTUP_BENCH_SEGMENTS, STARTUP_BENCH_DOCS, STARTUP_BENCH_ATTRS and STARTUP_BENCH_KNN_DOCS override the generated data
+
+#include "columnar/columnar.h"
+#include "columnar/builder.h"
+#include "secondary/secondary.h"
+#include "secondary/builder.h"
+#include "knn/knn.h"
+#include "benchutil.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+
+// heap accounting: every operator new block carries its size in a header so live bytes can be tracked
+// allocations that bypass operator new (e.g. malloc in hnswlib) are only visible in RSS and GetMemoryUsage
+static std::atomic<int64_t> g_iNumAllocs {0};
+static std::atomic<int64_t> g_iLiveBytes {0};
+static const size_t ALLOC_HEADER = 16;
+
+void * operator new ( size_t tSize )
+{
+	auto pBlock = (uint8_t *)malloc ( tSize + ALLOC_HEADER );
+	if ( !pBlock )
+		throw std::bad_alloc();
+
+	*(size_t*)pBlock = tSize;
+	g_iNumAllocs++;
+	g_iLiveBytes += tSize;
+	return pBlock + ALLOC_HEADER;
+}
+
+void * operator new[] ( size_t tSize )	{ return operator new(tSize); }
+
+void operator delete ( void * pPtr ) noexcept
+{
+	if ( !pPtr )
+		return;
+
+	auto pBlock = (uint8_t*)pPtr - ALLOC_HEADER;
+	g_iLiveBytes -= *(size_t*)pBlock;
+	free(pBlock);
+}
+
+void operator delete[] ( void * pPtr ) noexcept					{ operator delete(pPtr); }
+void operator delete ( void * pPtr, size_t ) noexcept			{ operator delete(pPtr); }
+void operator delete[] ( void * pPtr, size_t ) noexcept			{ operator delete(pPtr); }
+
+/////////////////////////////////////////////////////////////////////
+
+static const char * KNN_ATTR = "vec";
+static const int KNN_DIMS = 32;
+
+enum class SegmentPart_e
+{
+	COLUMNAR,
+	SECONDARY,
+	KNN,
+	ALL
+};
+
+static const char * g_dPartNames[] = { "columnar", "secondary", "knn", "all" };
+
+
+struct SegmentFiles_t
+{
+	std::string	m_sColumnar;
+	std::string	m_sSecondary;
+	std::string	m_sKNN;
+};
+
+
+struct Segments_t
+{
+	uint32_t					m_uNumDocs = 0;
+	std::vector<std::string>	m_dAttrs;
+	std::vector<SegmentFiles_t>	m_dFiles;
+
+	~Segments_t()
+	{
+		std::error_code tError;
+		for ( const auto & i : m_dFiles )
+		{
+			std::filesystem::remove ( i.m_sColumnar, tError );
+			std::filesystem::remove ( i.m_sSecondary, tError );
+			std::filesystem::remove ( i.m_sKNN, tError );
+		}
+	}
+};
+
+
+static common::AttrType_e GetAttrType ( int iAttr )
+{
+	// strings and MVAs go to the columnar storage only; numeric attributes get secondary indexes as well
+	static const common::AttrType_e dTypes[] = { common::AttrType_e::UINT32, common::AttrType_e::INT64, common::AttrType_e::FLOAT, common::AttrType_e::STRING, common::AttrType_e::UINT32SET };
+	return dTypes[iAttr % std::size(dTypes)];
+}
+
+
+static bool IsSecondaryAttr ( common::AttrType_e eType )
+{
+	return eType==common::AttrType_e::UINT32 || eType==common::AttrType_e::INT64 || eType==common::AttrType_e::FLOAT;
+}
+
+
+static bool BuildSegment ( const Segments_t & tSegments, int iSegment, const SegmentFiles_t & tFiles, std::string & sError )
+{
+	columnar::Schema_t tColumnarSchema;
+	common::Schema_t tSISchema;
+	std::vector<int> dSIAttrs;
+	for ( int i = 0; i < (int)tSegments.m_dAttrs.size(); i++ )
+	{
+		columnar::AttrWithSettings_t tAttr;
+		tAttr.m_sName = tSegments.m_dAttrs[i];
+		tAttr.m_eType = GetAttrType(i);
+		tColumnarSchema.push_back(tAttr);
+
+		if ( IsSecondaryAttr ( tAttr.m_eType ) )
+		{
+			tSISchema.push_back(tAttr);
+			dSIAttrs.push_back(i);
+		}
+	}
+
+	std::unique_ptr<columnar::Builder_i> pColumnar ( CreateColumnarBuilder ( tColumnarSchema, tFiles.m_sColumnar, 1 << 20, 1, sError ) );
+	std::unique_ptr<SI::Builder_i> pSI ( pColumnar ? CreateBuilder ( tSISchema, 64 << 20, tFiles.m_sSecondary, 1 << 20, sError ) : nullptr );
+	if ( !pColumnar || !pSI )
+		return false;
+
+	std::mt19937_64 tRng(iSegment);
+	std::vector<int64_t> dMva;
+	for ( uint32_t tRowID = 0; tRowID < tSegments.m_uNumDocs; tRowID++ )
+	{
+		pSI->SetRowID(tRowID);
+		int iSIAttr = 0;
+		for ( int i = 0; i < (int)tColumnarSchema.size(); i++ )
+		{
+			int64_t iValue = tRng() % ( 1000 << ( i % 10 ) );
+			switch ( tColumnarSchema[i].m_eType )
+			{
+			case common::AttrType_e::STRING:
+			{
+				std::string sValue = "value_" + std::to_string(iValue);
+				pColumnar->SetAttr ( i, (const uint8_t*)sValue.data(), (int)sValue.size() );
+			}
+			break;
+
+			case common::AttrType_e::UINT32SET:
+				dMva = { iValue, iValue+1+( iValue & 7 ) };
+				pColumnar->SetAttr ( i, dMva.data(), (int)dMva.size() );
+				break;
+
+			case common::AttrType_e::FLOAT:
+			{
+				float fValue = iValue*0.5f;
+				uint32_t uBits;
+				memcpy ( &uBits, &fValue, sizeof(uBits) );
+				iValue = uBits;
+			}
+			// fall through
+
+			default:
+				pColumnar->SetAttr ( i, iValue );
+				pSI->SetAttr ( iSIAttr++, iValue );
+				break;
+			}
+		}
+	}
+
+	if ( !pColumnar->Done(sError) || !pSI->Done(sError) )
+		return false;
+
+	knn::AttrWithSettings_t tKNNAttr;
+	tKNNAttr.m_sName = KNN_ATTR;
+	tKNNAttr.m_eType = common::AttrType_e::FLOATVEC;
+	tKNNAttr.m_iDims = KNN_DIMS;
+
+	int iKNNDocs = (int)bench::GetEnvInt ( "STARTUP_BENCH_KNN_DOCS", 16384 );
+	std::unique_ptr<knn::Builder_i> pKNN ( CreateKNNBuilder ( { tKNNAttr }, iKNNDocs ) );
+	std::uniform_real_distribution<float> tUniform ( -1.0f, 1.0f );
+	std::vector<float> dVec(KNN_DIMS);
+	for ( int iDoc = 0; iDoc < iKNNDocs; iDoc++ )
+	{
+		for ( auto & i : dVec )
+			i = tUniform(tRng);
+
+		if ( !pKNN->SetAttr ( 0, util::Span_T<float>(dVec) ) )
+		{
+			sError = pKNN->GetError();
+			return false;
+		}
+	}
+
+	return pKNN->Save ( tFiles.m_sKNN, 1 << 20, sError );
+}
+
+
+static std::unique_ptr<Segments_t> BuildSegments()
+{
+	std::unique_ptr<Segments_t> pSegments ( new Segments_t );
+	pSegments->m_uNumDocs = (uint32_t)bench::GetEnvInt ( "STARTUP_BENCH_DOCS", 1 << 18 );
+	for ( int i = 0; i < (int)bench::GetEnvInt ( "STARTUP_BENCH_ATTRS", 20 ); i++ )
+		pSegments->m_dAttrs.push_back ( "attr" + std::to_string(i) );
+
+	int iNumSegments = (int)bench::GetEnvInt ( "STARTUP_BENCH_SEGMENTS", 8 );
+	for ( int i = 0; i < iNumSegments; i++ )
+	{
+		std::string sPrefix = bench::GetTempFile ( "startup_bench_" + std::to_string(i) );
+		pSegments->m_dFiles.push_back ( { sPrefix + ".spc", sPrefix + ".spidx", sPrefix + ".spknn" } );
+
+		std::string sError;
+		if ( !BuildSegment ( *pSegments, i, pSegments->m_dFiles.back(), sError ) )
+		{
+			fprintf ( stderr, "unable to build segment %d: %s\n", i, sError.c_str() );
+			pSegments.reset();
+			break;
+		}
+	}
+
+	return pSegments;
+}
+
+
+static Segments_t * GetSegments()
+{
+	// all benchmarks open the same set of segments
+	static bench::LazyCache_T<int, Segments_t> tSegments;
+	return tSegments.Get ( 0, BuildSegments );
+}
+
+/////////////////////////////////////////////////////////////////////
+
+struct OpenedSegment_t
+{
+	std::unique_ptr<columnar::Columnar_i>	m_pColumnar;
+	std::unique_ptr<SI::Index_i>			m_pSecondary;
+	std::unique_ptr<knn::KNN_i>				m_pKNN;
+
+	void	GetMemoryUsage ( std::vector<common::MemoryUsage_t> & dUsage ) const
+	{
+		if ( m_pColumnar )
+			m_pColumnar->GetMemoryUsage(dUsage);
+
+		if ( m_pSecondary )
+			m_pSecondary->GetMemoryUsage(dUsage);
+
+		if ( m_pKNN )
+			m_pKNN->GetMemoryUsage(dUsage);
+	}
+};
+
+
+static bool OpenSegment ( const Segments_t & tSegments, const SegmentFiles_t & tFiles, SegmentPart_e ePart, bool bTouch, OpenedSegment_t & tSegment, std::string & sError )
+{
+	if ( ePart==SegmentPart_e::COLUMNAR || ePart==SegmentPart_e::ALL )
+	{
+		tSegment.m_pColumnar.reset ( CreateColumnarStorageReader ( tFiles.m_sColumnar, tSegments.m_uNumDocs, sError ) );
+		if ( !tSegment.m_pColumnar )
+			return false;
+
+		// headers are loaded lazily; creating an iterator per attribute is what the first query does
+		if ( bTouch )
+			for ( const auto & sAttr : tSegments.m_dAttrs )
+				if ( !std::unique_ptr<columnar::Iterator_i> ( tSegment.m_pColumnar->CreateIterator ( sAttr, columnar::IteratorHints_t(), nullptr, sError ) ) )
+					return false;
+	}
+
+	if ( ePart==SegmentPart_e::SECONDARY || ePart==SegmentPart_e::ALL )
+	{
+		tSegment.m_pSecondary.reset ( CreateSecondaryIndex ( tFiles.m_sSecondary.c_str(), sError ) );
+		if ( !tSegment.m_pSecondary )
+			return false;
+	}
+
+	if ( ePart==SegmentPart_e::KNN || ePart==SegmentPart_e::ALL )
+	{
+		tSegment.m_pKNN.reset ( CreateKNN() );
+		if ( !tSegment.m_pKNN->Load ( tFiles.m_sKNN, sError ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+static void BenchOpen ( benchmark::State & tState, SegmentPart_e ePart, bool bTouch )
+{
+	Segments_t * pSegments = GetSegments();
+	if ( !pSegments )
+	{
+		tState.SkipWithError ( "no segments" );
+		return;
+	}
+
+	int iNumSegments = (int)pSegments->m_dFiles.size();
+	int64_t iRSS = 0;
+	int64_t iPeakRSS = 0;
+	int64_t iHeapBytes = 0;
+	int64_t iAllocs = 0;
+	std::map<std::string, int64_t> hAttrBytes;
+	std::map<std::string, int64_t> hCategoryBytes;
+
+	for ( auto _ : tState )
+	{
+		std::vector<OpenedSegment_t> dOpened(iNumSegments);
+
+		bench::ResetPeakRSS();
+		int64_t iRSSBefore = bench::GetCurrentRSS();
+		int64_t iHeapBefore = g_iLiveBytes;
+		int64_t iAllocsBefore = g_iNumAllocs;
+
+		int64_t iStart = bench::GetTimeNs();
+		for ( int i = 0; i < iNumSegments; i++ )
+		{
+			std::string sError;
+			if ( !OpenSegment ( *pSegments, pSegments->m_dFiles[i], ePart, bTouch, dOpened[i], sError ) )
+			{
+				tState.SkipWithError ( sError.c_str() );
+				return;
+			}
+		}
+
+		tState.SetIterationTime ( ( bench::GetTimeNs()-iStart )/1e9 );
+
+		iRSS += bench::GetCurrentRSS()-iRSSBefore;
+		iPeakRSS += bench::GetPeakRSS()-iRSSBefore;
+		iHeapBytes += g_iLiveBytes-iHeapBefore;
+		iAllocs += g_iNumAllocs-iAllocsBefore;
+
+		std::vector<common::MemoryUsage_t> dUsage;
+		for ( const auto & i : dOpened )
+			i.GetMemoryUsage(dUsage);
+
+		static const char * dCategories[] = { "headers", "minmax", "block_offsets", "pgm", "hnsw", "reader_buffers", "decode_scratch", "updates" };
+		for ( const auto & tUsage : dUsage )
+		{
+			hAttrBytes[tUsage.m_sAttr.empty() ? "shared" : tUsage.m_sAttr] += tUsage.GetTotal();
+			for ( int i = 0; i < (int)common::MemCategory_e::TOTAL; i++ )
+				hCategoryBytes[dCategories[i]] += tUsage.m_dBytes[i];
+		}
+	}
+
+	// everything is reported per segment
+	double fDiv = double ( std::max<int64_t> ( tState.iterations(), 1 ) )*iNumSegments;
+	tState.counters["segments"] = iNumSegments;
+	tState.counters["rss_kb"] = iRSS/1024.0/fDiv;
+	tState.counters["peak_rss_kb"] = iPeakRSS/1024.0/fDiv;
+	tState.counters["heap_kb"] = iHeapBytes/1024.0/fDiv;
+	tState.counters["allocs"] = iAllocs/fDiv;
+
+	for ( const auto & i : hCategoryBytes )
+		if ( i.second )
+			tState.counters["mem_kb:" + i.first] = i.second/1024.0/fDiv;
+
+	for ( const auto & i : hAttrBytes )
+		tState.counters["attr_kb:" + i.first] = i.second/1024.0/fDiv;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+static void RegisterBenchmarks()
+{
+	for ( int iPart = 0; iPart < (int)std::size(g_dPartNames); iPart++ )
+	{
+		auto ePart = (SegmentPart_e)iPart;
+		std::string sName = std::string("Open/") + g_dPartNames[iPart];
+		benchmark::RegisterBenchmark ( sName.c_str(), BenchOpen, ePart, false )->UseManualTime()->Unit(benchmark::kMillisecond);
+
+		if ( ePart==SegmentPart_e::COLUMNAR || ePart==SegmentPart_e::ALL )
+			benchmark::RegisterBenchmark ( ( sName + "/touch" ).c_str(), BenchOpen, ePart, true )->UseManualTime()->Unit(benchmark::kMillisecond);
+	}
+}
+
+
+int main ( int argc, char ** argv )
+{
+	return bench::RunBenchmarks ( argc, argv, RegisterBenchmarks );
+}
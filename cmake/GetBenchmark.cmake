@@ -0,0 +1,35 @@
+# Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+# All rights reserved
+#
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+set ( BENCHMARK_GITHUB "https://github.com/google/benchmark/archive/refs/tags/v1.8.3.tar.gz" )
+set ( BENCHMARK_BUNDLEZIP "${LIBS_BUNDLE}/benchmark-1.8.3.tar.gz" )
+
+cmake_minimum_required ( VERSION 3.17 FATAL_ERROR )
+include ( update_bundle )
+
+# determine destination folder where we expect pre-built google benchmark
+find_package ( benchmark QUIET CONFIG )
+return_if_target_found ( benchmark::benchmark "found ready" )
+
+# not found. Populate sources and build them as a part of our tree (only benchmarks link it, so no install/export here)
+select_nearest_url ( BENCHMARK_PLACE benchmark ${BENCHMARK_BUNDLEZIP} ${BENCHMARK_GITHUB} )
+fetch_sources ( benchmark ${BENCHMARK_PLACE} BENCHMARK_SRC )
+
+set ( BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE )
+set ( BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE )
+set ( BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE )
+set ( BENCHMARK_ENABLE_WERROR OFF CACHE BOOL "" FORCE )
+add_subdirectory ( ${BENCHMARK_SRC} ${CMAKE_CURRENT_BINARY_DIR}/benchmark-build EXCLUDE_FROM_ALL )
@@ -55,6 +55,7 @@ class Analyzer_i : public common::BlockIterator_i
 {
 public:
 	virtual void	Setup ( SharedBlocks_c & pBlocks, uint32_t uTotalDocs ) = 0;
+	virtual void	SetDeadRows ( const common::DeadRows_t & tDeadRows ) = 0;	// must be called before Setup
 };
 
 
@@ -48,22 +48,23 @@ public:
 
 	FORCE_INLINE void		ReadHeader ( FileReader_c & tReader, uint32_t uDocsInBlock );
 	FORCE_INLINE void		ReadSubblock ( int iSubblockId, int iNumValues, FileReader_c & tReader );
-	FORCE_INLINE int64_t	GetValue ( int iIdInSubblock );
-	FORCE_INLINE const Span_T<uint32_t> & GetValues() const { return m_tValuesRead; }
+	FORCE_INLINE int64_t	GetValue ( int iIdInSubblock ) const	{ return ( m_dBits[iIdInSubblock>>6] >> ( iIdInSubblock & 63 ) ) & 1; }
+	FORCE_INLINE const Span_T<uint64_t> & GetBits() const			{ return m_tBitsRead; }
+	size_t					GetAllocatedBytes() const				{ return m_dBits.capacity()*sizeof(m_dBits[0]) + m_dEncoded.capacity()*sizeof(m_dEncoded[0]); }
 
 private:
-	std::vector<uint32_t>	m_dValues;
+	std::vector<uint64_t>	m_dBits;
 	std::vector<uint32_t>	m_dEncoded;
 	int64_t					m_iValuesOffset = 0;
 	int						m_iSubblockId = -1;
-	Span_T<uint32_t>		m_tValuesRead;
+	Span_T<uint64_t>		m_tBitsRead;
 };
 
 
 StoredBlock_Bool_Bitmap_c::StoredBlock_Bool_Bitmap_c ( int iSubblockSize )
 {
 	assert ( !( iSubblockSize & 127 ) );
-	m_dValues.resize(iSubblockSize);
+	m_dBits.resize ( iSubblockSize >> 6 );
 	m_dEncoded.resize ( iSubblockSize >> 5 );
 }
 
@@ -75,6 +76,17 @@ void StoredBlock_Bool_Bitmap_c::ReadHeader ( FileReader_c & tReader, uint32_t uD
 }
 
 
+static FORCE_INLINE uint64_t SpreadBits16 ( uint32_t uValue )
+{
+	uint64_t uRes = uValue & 0xFFFF;
+	uRes = ( uRes | ( uRes << 24 ) ) & 0x000000FF000000FFULL;
+	uRes = ( uRes | ( uRes << 12 ) ) & 0x000F000F000F000FULL;
+	uRes = ( uRes | ( uRes << 6 ) )  & 0x0303030303030303ULL;
+	uRes = ( uRes | ( uRes << 3 ) )  & 0x1111111111111111ULL;
+	return uRes;
+}
+
+
 void StoredBlock_Bool_Bitmap_c::ReadSubblock ( int iSubblockId, int iNumValues, FileReader_c & tReader )
 {
 	if ( m_iSubblockId==iSubblockId )
@@ -85,15 +97,23 @@ void StoredBlock_Bool_Bitmap_c::ReadSubblock ( int iSubblockId, int iNumValues,
 	size_t uPackedSize = m_dEncoded.size()*sizeof ( m_dEncoded[0] );
 	tReader.Seek ( m_iValuesOffset + uPackedSize*iSubblockId );
 	tReader.Read ( (uint8_t*)m_dEncoded.data(), uPackedSize );
-	BitUnpack ( m_dEncoded, m_dValues, 1 );
 
-	m_tValuesRead = { m_dValues.data(), (size_t)iNumValues };
-}
+	// 1-bit SIMD packing interleaves each 128 values over 4 words (bit B of word W holds value 4*B+W)
+	// so we convert every 4 packed words into 2 sequential 64-bit words instead of unpacking to one value per uint32
+	const uint32_t * pEncoded = m_dEncoded.data();
+	const uint32_t * pEncodedEnd = pEncoded + m_dEncoded.size();
+	uint64_t * pBits = m_dBits.data();
+	for ( ; pEncoded < pEncodedEnd; pEncoded += 4, pBits += 2 )
+	{
+		pBits[0] = SpreadBits16 ( pEncoded[0] ) | ( SpreadBits16 ( pEncoded[1] ) << 1 ) | ( SpreadBits16 ( pEncoded[2] ) << 2 ) | ( SpreadBits16 ( pEncoded[3] ) << 3 );
+		pBits[1] = SpreadBits16 ( pEncoded[0]>>16 ) | ( SpreadBits16 ( pEncoded[1]>>16 ) << 1 ) | ( SpreadBits16 ( pEncoded[2]>>16 ) << 2 ) | ( SpreadBits16 ( pEncoded[3]>>16 ) << 3 );
+	}
 
+	int iNumWords = ( iNumValues+63 ) >> 6;
+	if ( iNumValues & 63 )
+		m_dBits[iNumWords-1] &= ( 1ULL << ( iNumValues & 63 ) ) - 1;
 
-int64_t StoredBlock_Bool_Bitmap_c::GetValue ( int iIdInSubblock )
-{
-	return m_dValues[iIdInSubblock];
+	m_tBitsRead = { m_dBits.data(), (size_t)iNumWords };
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -104,9 +124,13 @@ public:
 						Accessor_Bool_c ( const AttributeHeader_i & tHeader, FileReader_c * pReader );
 
 	FORCE_INLINE void	SetCurBlock ( uint32_t uBlockId );
+	void				AddMemoryUsage ( MemoryUsage_t & tUsage ) const;
+	FORCE_INLINE int	GetPackingId() const	{ return to_underlying(m_ePacking); }
+	int64_t				GetBytesRead() const	{ return m_pReader->GetBytesRead(); }
 
 protected:
 	const AttributeHeader_i &		m_tHeader;
+	std::shared_ptr<const AttributeHeader_i>	m_pHeaderRef;	// keeps an evictable header alive
 	std::unique_ptr<FileReader_c>	m_pReader;
 
 	StoredBlock_Bool_Const_c		m_tBlockConst;
@@ -124,6 +148,7 @@ protected:
 Accessor_Bool_c::Accessor_Bool_c ( const AttributeHeader_i & tHeader, FileReader_c * pReader )
 	: StoredBlockTraits_t ( tHeader.GetSettings().m_iSubblockSize )
 	, m_tHeader ( tHeader )
+	, m_pHeaderRef ( tHeader.weak_from_this().lock() )
 	, m_pReader ( pReader )
 	, m_tBlockBitmap ( tHeader.GetSettings().m_iSubblockSize )
 {
@@ -131,6 +156,13 @@ Accessor_Bool_c::Accessor_Bool_c ( const AttributeHeader_i & tHeader, FileReader
 }
 
 
+void Accessor_Bool_c::AddMemoryUsage ( MemoryUsage_t & tUsage ) const
+{
+	tUsage.Add ( MemCategory_e::READER_BUFFERS, m_pReader->GetAllocatedBytes() );
+	tUsage.Add ( MemCategory_e::DECODE_SCRATCH, m_tBlockBitmap.GetAllocatedBytes() );
+}
+
+
 void Accessor_Bool_c::SetCurBlock ( uint32_t uBlockId )
 {
 	m_pReader->Seek ( m_tHeader.GetBlockOffset(uBlockId) );
@@ -188,8 +220,10 @@ public:
 	int			Get ( uint32_t tRowID, const uint8_t * & pData ) final	{ assert ( 0 && "INTERNAL ERROR: requesting blob from bool iterator" ); return 0; }
 	uint8_t *	GetPacked ( uint32_t tRowID ) final						{ assert ( 0 && "INTERNAL ERROR: requesting blob from bool iterator" ); return nullptr; }
 	int			GetLength ( uint32_t tRowID ) final						{ assert ( 0 && "INTERNAL ERROR: requesting string length from bool iterator" ); return 0; }
+	int			GetFloatVec ( uint32_t tRowID, Span_T<float> & dValues ) final	{ assert ( 0 && "INTERNAL ERROR: requesting float vector from bool iterator" ); return 0; }
 
 	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const override { dDesc.push_back ( { m_tHeader.GetName(), "iterator" } ); };
+	void		GetMemoryUsage ( MemoryUsage_t & tUsage ) const final { BASE::AddMemoryUsage(tUsage); }
 
 private:
 	FORCE_INLINE int64_t	DoGet ( uint32_t tRowID );
@@ -249,31 +283,49 @@ class AnalyzerBlock_Bool_Bitmap_c
 public:
 						AnalyzerBlock_Bool_Bitmap_c ( uint32_t & tRowID ) : m_tRowID ( tRowID ) {}
 
-	FORCE_INLINE int	ProcessSubblock ( uint32_t * & pRowID, const Span_T<uint32_t> & dValues );
-	void				Setup ( bool bFilterValue ) { m_bFilterValue=bFilterValue; }
+	FORCE_INLINE int	ProcessSubblock ( uint32_t * & pRowID, const Span_T<uint64_t> & dBits, int iNumValues );
+	void				Setup ( bool bFilterValue ) { m_uInvert = bFilterValue ? 0 : 0xFFFFFFFFFFFFFFFFULL; }
 
 private:
 	uint32_t &			m_tRowID;
-	bool				m_bFilterValue = false;
+	uint64_t			m_uInvert = 0;
+
+	FORCE_INLINE uint64_t	GetWord ( const Span_T<uint64_t> & dBits, int iWord, int iNumValues ) const;
 };
 
 
-int AnalyzerBlock_Bool_Bitmap_c::ProcessSubblock ( uint32_t * & pRowID, const Span_T<uint32_t> & dValues )
+uint64_t AnalyzerBlock_Bool_Bitmap_c::GetWord ( const Span_T<uint64_t> & dBits, int iWord, int iNumValues ) const
 {
-	uint32_t tRowID = m_tRowID;
+	uint64_t uWord = dBits[iWord] ^ m_uInvert;
+	int iLeftover = iNumValues - ( iWord<<6 );
+	if ( iLeftover < 64 )
+		uWord &= ( 1ULL << iLeftover ) - 1;
 
-	uint32_t uFilterValue = m_bFilterValue ? 1 : 0;
-	for ( auto i : dValues )
-	{
-		if ( i == uFilterValue )
-			*pRowID++ = tRowID;
+	return uWord;
+}
 
-		tRowID++;
-	}
 
-	m_tRowID = tRowID;
+int AnalyzerBlock_Bool_Bitmap_c::ProcessSubblock ( uint32_t * & pRowID, const Span_T<uint64_t> & dBits, int iNumValues )
+{
+	int iNumWords = (int)dBits.size();
+
+	// popcount first; empty and full subblocks don't need bit expansion
+	int iMatches = 0;
+	for ( int i = 0; i < iNumWords; i++ )
+		iMatches += PopCount64 ( GetWord ( dBits, i, iNumValues ) );
+
+	if ( iMatches==iNumValues )
+		return FillWithIncreasingValues ( pRowID, iNumValues, m_tRowID );
+
+	if ( iMatches )
+	{
+		uint32_t tRowID = m_tRowID;
+		for ( int i = 0; i < iNumWords; i++, tRowID += 64 )
+			BitmapWordToRowIDs ( GetWord ( dBits, i, iNumValues ), tRowID, pRowID );
+	}
 
-	return (int)dValues.size();
+	m_tRowID += iNumValues;
+	return iNumValues;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -288,7 +340,7 @@ public:
 				Analyzer_Bool_T ( const AttributeHeader_i & tHeader, FileReader_c * pReader, const Filter_t & tSettings );
 
 	bool		GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) final;
-	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan" } ); }
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan", ANALYZER::m_tStats } ); }
 
 private:
 	bool		m_bAcceptFalse = false;
@@ -396,8 +448,9 @@ int Analyzer_Bool_T<HAVE_MATCHING_BLOCKS>::ProcessSubblockConst ( uint32_t * & p
 template <bool HAVE_MATCHING_BLOCKS>
 int Analyzer_Bool_T<HAVE_MATCHING_BLOCKS>::ProcessSubblockBitmap ( uint32_t * & pRowID, int iSubblockIdInBlock )
 {
-	ACCESSOR::m_tBlockBitmap.ReadSubblock ( iSubblockIdInBlock, StoredBlockTraits_t::GetNumSubblockValues(iSubblockIdInBlock), *ACCESSOR::m_pReader );
-	return m_tBlockBitmap.ProcessSubblock ( pRowID, ACCESSOR::m_tBlockBitmap.GetValues() );
+	int iNumValues = StoredBlockTraits_t::GetNumSubblockValues(iSubblockIdInBlock);
+	ACCESSOR::m_tBlockBitmap.ReadSubblock ( iSubblockIdInBlock, iNumValues, *ACCESSOR::m_pReader );
+	return m_tBlockBitmap.ProcessSubblock ( pRowID, ACCESSOR::m_tBlockBitmap.GetBits(), iNumValues );
 }
 
 template <bool HAVE_MATCHING_BLOCKS>
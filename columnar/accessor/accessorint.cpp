@@ -61,6 +61,7 @@ public:
 	FORCE_INLINE int		GetIndexInTable ( T tValue ) const;
 	FORCE_INLINE T			GetValueFromTable ( uint8_t uIndex ) const { return m_dTableValues[uIndex]; }
 	FORCE_INLINE int		GetTableSize() const { return (int)m_dTableValues.size(); }
+	size_t					GetAllocatedBytes() const;
 
 private:
 	std::unique_ptr<IntCodec_i>	m_pCodec;
@@ -133,6 +134,12 @@ int StoredBlock_Int_Table_T<T>::GetIndexInTable ( T tValue ) const
 
 //////////////////////////////////////////////////////////////////////////
 
+template <typename T>
+size_t StoredBlock_Int_Table_T<T>::GetAllocatedBytes() const
+{
+	return m_dTableValues.GetAllocatedBytes() + m_dTmp.GetAllocatedBytes() + m_dValueIndexes.capacity()*sizeof(uint32_t) + m_dEncoded.capacity()*sizeof(uint32_t);
+}
+
 template <typename T>
 class StoredBlock_Int_PFOR_T
 {
@@ -145,6 +152,7 @@ public:
 	FORCE_INLINE void		ReadSubblock_Hash ( int iSubblockId, int iNumValues, FileReader_c & tReader );
 	FORCE_INLINE T			GetValue ( int iIdInSubblock ) const;
 	FORCE_INLINE const Span_T<T> & GetAllValues() const { return m_dSubblockValues; }
+	size_t					GetAllocatedBytes() const;
 
 private:
 	std::unique_ptr<IntCodec_i>	m_pCodec;
@@ -277,14 +285,25 @@ void StoredBlock_Int_PFOR_T<T>::ReadHashesWithNullMap ( FileReader_c & tReader,
 
 //////////////////////////////////////////////////////////////////////////
 
+template <typename T>
+size_t StoredBlock_Int_PFOR_T<T>::GetAllocatedBytes() const
+{
+	return m_dSubblockCumulativeSizes.GetAllocatedBytes() + m_dTmp.GetAllocatedBytes() + m_dTmp64.GetAllocatedBytes() + m_dNullMap.GetAllocatedBytes() + m_dSubblockValues.GetAllocatedBytes();
+}
+
 template<typename T>
 class Accessor_INT_T : public StoredBlockTraits_t
 {
 public:
 					Accessor_INT_T ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader );
 
+	void			AddMemoryUsage ( MemoryUsage_t & tUsage ) const;
+	FORCE_INLINE int	GetPackingId() const	{ return to_underlying(m_ePacking); }
+	int64_t			GetBytesRead() const	{ return m_pReader->GetBytesRead(); }
+
 protected:
 	const AttributeHeader_i &		m_tHeader;
+	std::shared_ptr<const AttributeHeader_i>	m_pHeaderRef;	// keeps an evictable header alive
 	std::unique_ptr<FileReader_c>	m_pReader;
 
 	StoredBlock_Int_Const_T<T>		m_tBlockConst;
@@ -308,6 +327,7 @@ template<typename T>
 Accessor_INT_T<T>::Accessor_INT_T ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader )
 	: StoredBlockTraits_t ( tHeader.GetSettings().m_iSubblockSize )
 	, m_tHeader ( tHeader )
+	, m_pHeaderRef ( tHeader.weak_from_this().lock() )
 	, m_pReader ( pReader )
 	, m_tBlockTable ( tHeader.GetSettings().m_iSubblockSize, tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion )
 	, m_tBlockPFOR ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion )
@@ -315,6 +335,13 @@ Accessor_INT_T<T>::Accessor_INT_T ( const AttributeHeader_i & tHeader, uint32_t
 	assert(pReader);
 }
 
+template<typename T>
+void Accessor_INT_T<T>::AddMemoryUsage ( MemoryUsage_t & tUsage ) const
+{
+	tUsage.Add ( MemCategory_e::READER_BUFFERS, m_pReader->GetAllocatedBytes() );
+	tUsage.Add ( MemCategory_e::DECODE_SCRATCH, m_tBlockTable.GetAllocatedBytes() + m_tBlockPFOR.GetAllocatedBytes() );
+}
+
 template<typename T>
 void Accessor_INT_T<T>::SetCurBlock ( uint32_t uBlockId )
 {
@@ -413,8 +440,10 @@ public:
 	int			Get ( uint32_t tRowID, const uint8_t * & pData ) final	{ assert ( 0 && "INTERNAL ERROR: requesting blob from int iterator" ); return 0; }
 	uint8_t *	GetPacked ( uint32_t tRowID ) final						{ assert ( 0 && "INTERNAL ERROR: requesting blob from int iterator" ); return nullptr; }
 	int			GetLength ( uint32_t tRowID ) final						{ assert ( 0 && "INTERNAL ERROR: requesting blob length from int iterator" ); return 0; }
+	int			GetFloatVec ( uint32_t tRowID, Span_T<float> & dValues ) final	{ assert ( 0 && "INTERNAL ERROR: requesting float vector from int iterator" ); return 0; }
 
 	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const override { dDesc.push_back ( { BASE::m_tHeader.GetName(), "iterator" } ); };
+	void		GetMemoryUsage ( MemoryUsage_t & tUsage ) const final { BASE::AddMemoryUsage(tUsage); }
 
 private:
 	FORCE_INLINE int64_t DoGet ( uint32_t tRowID );
@@ -870,7 +899,7 @@ public:
 					Analyzer_INT_T ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader, const Filter_t & tSettings );
 
 	bool			GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) final;
-	void			AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan" } ); }
+	void			AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan", ANALYZER::m_tStats } ); }
 
 private:
 	AnalyzerBlock_Int_Const_c	m_tBlockConst;
@@ -1155,6 +1184,7 @@ bool Analyzer_INT_T<VALUES,ACCESSOR_VALUES,RANGE_EVAL,HAVE_MATCHING_BLOCKS>::Mov
 	{
 		ANALYZER::m_iCurBlockId = iNextBlock;
 		ACCESSOR::SetCurBlock ( ANALYZER::m_iCurBlockId );
+		ANALYZER::CountBlock ( ACCESSOR::GetPackingId() );
 
 		ePackingForProcessingFunc = ACCESSOR::m_ePacking;
 
@@ -28,21 +28,119 @@ namespace columnar
 using namespace util;
 using namespace common;
 
+// both MVA values and filter values are sorted, so ANY/ALL are set intersection/inclusion tests
+// we use a linear merge when list sizes are comparable and galloping (exponential) search otherwise
+static const size_t GALLOP_RATIO = 32;
+
+template <typename T, typename V>
+static FORCE_INLINE const T * GallopLowerBound ( const T * pStart, const T * pEnd, V tValue )
+{
+	size_t uLen = pEnd-pStart;
+	size_t uLo = 0;
+	size_t uHi = 0;
+	size_t uStep = 1;
+	while ( uHi<uLen && pStart[uHi]<tValue )
+	{
+		uLo = uHi+1;
+		uHi += uStep;
+		uStep <<= 1;
+	}
+
+	return std::lower_bound ( pStart+uLo, pStart+std::min ( uHi, uLen ), tValue );
+}
+
+// skip 4-value blocks that are entirely less than the value, then step one by one
+template <typename T, typename V>
+static FORCE_INLINE const T * SkipLess ( const T * pStart, const T * pEnd, V tValue )
+{
+	while ( pStart+4<=pEnd && pStart[3]<tValue )
+		pStart += 4;
+
+	while ( pStart<pEnd && *pStart<tValue )
+		pStart++;
+
+	return pStart;
+}
+
+template <typename T, typename V>
+static FORCE_INLINE bool IntersectsGallop ( const Span_T<T> & dSmall, const Span_T<V> & dLarge )
+{
+	const V * pLarge = dLarge.begin();
+	const V * pLargeEnd = dLarge.end();
+	for ( auto tValue : dSmall )
+	{
+		pLarge = GallopLowerBound ( pLarge, pLargeEnd, tValue );
+		if ( pLarge==pLargeEnd )
+			return false;
+
+		if ( *pLarge==tValue )
+			return true;
+	}
+
+	return false;
+}
+
+template <typename T, typename V>
+static FORCE_INLINE bool Intersects ( const Span_T<T> & dValues, const Span_T<V> & dTestValues )
+{
+	if ( dTestValues.size() > dValues.size()*GALLOP_RATIO )
+		return IntersectsGallop ( dValues, dTestValues );
+
+	if ( dValues.size() > dTestValues.size()*GALLOP_RATIO )
+		return IntersectsGallop ( dTestValues, dValues );
+
+	const T * pValue = dValues.begin();
+	const T * pValueEnd = dValues.end();
+	const V * pTest = dTestValues.begin();
+	const V * pTestEnd = dTestValues.end();
+	while ( pValue<pValueEnd && pTest<pTestEnd )
+	{
+		pValue = SkipLess ( pValue, pValueEnd, *pTest );
+		if ( pValue==pValueEnd )
+			return false;
+
+		pTest = SkipLess ( pTest, pTestEnd, *pValue );
+		if ( pTest==pTestEnd )
+			return false;
+
+		if ( *pValue==*pTest )
+			return true;
+	}
+
+	return false;
+}
+
+// checks that every value is present in the test values
+template <typename T, typename V>
+static FORCE_INLINE bool IsSubset ( const Span_T<T> & dValues, const Span_T<V> & dTestValues )
+{
+	bool bGallop = dTestValues.size() > dValues.size()*GALLOP_RATIO;
+	const V * pTest = dTestValues.begin();
+	const V * pTestEnd = dTestValues.end();
+	for ( auto tValue : dValues )
+	{
+		pTest = bGallop ? GallopLowerBound ( pTest, pTestEnd, tValue ) : SkipLess ( pTest, pTestEnd, tValue );
+		if ( pTest==pTestEnd || *pTest!=tValue )
+			return false;
+	}
+
+	return true;
+}
+
 template<bool LEFT_CLOSED, bool RIGHT_CLOSED, bool EQ>
 class MvaAll_T
 {
 public:
+	static const bool IS_ALL = true;
+	static const bool EXCLUDE = !EQ;
+
 	template<typename T>
 	static FORCE_INLINE bool Test ( const Span_T<T> & dValues, const Span_T<int64_t> & dTestValues )
 	{
 		if ( dValues.empty() || dTestValues.empty() )
 			return false ^ (!EQ);
 
-		for ( auto i : dValues )
-			if ( !std::binary_search ( dTestValues.begin(), dTestValues.end(), i ) )
-				return false ^ (!EQ);
-
-		return true ^ (!EQ);
+		return IsSubset ( dValues, dTestValues ) ^ (!EQ);
 	}
 
 	template<typename T>
@@ -72,31 +170,16 @@ template<bool LEFT_CLOSED, bool RIGHT_CLOSED, bool EQ>
 class MvaAny_T
 {
 public:
+	static const bool IS_ALL = false;
+	static const bool EXCLUDE = !EQ;
+
 	template <typename T>
 	static inline bool Test ( const Span_T<T> & dValues, const Span_T<int64_t> & dTestValues )
 	{
 		if ( dValues.empty() || dTestValues.empty() )
 			return false ^ (!EQ);
 
-		const T * pLeft = dValues.data();
-
-		for ( auto iTestValue : dTestValues )
-		{
-			const T * pRight = &dValues.back();
-			while ( pLeft<=pRight )
-			{
-				const T * pValue = pLeft + (pRight - pLeft) / 2;
-				T iValue = *pValue;
-				if ( iValue < iTestValue )
-					pLeft = pValue + 1;
-				else if ( iValue > iTestValue )
-					pRight = pValue - 1;
-				else
-					return true ^ (!EQ);
-			}
-		}
-
-		return false ^ (!EQ);
+		return Intersects ( dValues, dTestValues ) ^ (!EQ);
 	}
 
 	template <typename T>
@@ -125,7 +208,11 @@ public:
 			else if ( iValue > iMinValue )
 				pRight = pValue - 1;
 			else
-				return ( LEFT_CLOSED || pValue+1<pEnd ) ^ (!EQ);
+			{
+				// found min; if it is excluded, the next value should still fit the range
+				pLeft = LEFT_CLOSED ? pValue : pValue + 1;
+				break;
+			}
 		}
 
 		if ( pLeft==pEnd )
@@ -223,6 +310,7 @@ public:
 	template <bool PACK>
 	FORCE_INLINE uint32_t	GetValue ( uint8_t * & pValue ) const	{ return PackValue<T,PACK> ( m_dValueSpan, pValue ); }
 	FORCE_INLINE int		GetValueLength() const					{ return (int)m_dValueSpan.size()*sizeof(T); }
+	size_t					GetAllocatedBytes() const				{ return m_dValue.GetAllocatedBytes() + m_dTmp.GetAllocatedBytes(); }
 
 private:
 	SpanResizeable_T<T>			m_dValue;
@@ -267,6 +355,7 @@ public:
 	FORCE_INLINE uint32_t	GetValue ( uint8_t * & pValue, int iIdInSubblock ) const	{ return PackValue<T,PACK> ( m_dValuePtrs[iIdInSubblock], pValue ); }
 	FORCE_INLINE int		GetValueLength() const										{ return (int)m_iLength*sizeof(T); }
 	FORCE_INLINE const std::vector<Span_T<T>> & GetAllValues() const					{ return m_dValuePtrs; }
+	size_t					GetAllocatedBytes() const { return m_dSubblockCumulativeSizes.GetAllocatedBytes() + m_dTmp.GetAllocatedBytes() + m_dValues.GetAllocatedBytes() + m_dValuePtrs.capacity()*sizeof(m_dValuePtrs[0]); }
 
 private:
 	SpanResizeable_T<uint32_t>	m_dSubblockCumulativeSizes;
@@ -360,6 +449,7 @@ public:
 	template <typename T_COMP>
 	FORCE_INLINE Span_T<T_COMP>	GetValueFromTable ( uint8_t uIndex ) const { return { (T_COMP*)m_dValuePtrs[uIndex].data(), m_dValuePtrs[uIndex].size() }; }
 	FORCE_INLINE int			GetTableSize() const { return (int)m_dValuePtrs.size(); }
+	size_t						GetAllocatedBytes() const;
 
 private:
 	SpanResizeable_T<uint32_t>	m_dTmp;
@@ -377,6 +467,13 @@ private:
 	Span_T<uint32_t>			m_tValuesRead;
 };
 
+template <typename T>
+size_t StoredBlock_MvaTable_T<T>::GetAllocatedBytes() const
+{
+	return m_dTmp.GetAllocatedBytes() + m_dLengths.GetAllocatedBytes() + m_dValues.GetAllocatedBytes() + m_dValuePtrs.capacity()*sizeof(m_dValuePtrs[0])
+		+ ( m_dValueIndexes.capacity() + m_dEncoded.capacity() )*sizeof(uint32_t);
+}
+
 template <typename T>
 StoredBlock_MvaTable_T<T>::StoredBlock_MvaTable_T ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion, int iSubblockSize )
 	: StoredBlock_Mva_c ( sCodec32, sCodec64, uVersion )
@@ -446,6 +543,7 @@ public:
 	FORCE_INLINE uint32_t	GetValue ( uint8_t * & pValue, int iIdInSubblock ) const;
 	FORCE_INLINE int		GetValueLength ( int iIdInSubblock ) const	{ return (int)m_dValuePtrs[iIdInSubblock].size()*sizeof(T); }
 	FORCE_INLINE const std::vector<Span_T<T>> & GetAllValues() const	{ return m_dValuePtrs; }
+	size_t					GetAllocatedBytes() const;
 
 private:
 	SpanResizeable_T<uint32_t>	m_dSubblockCumulativeSizes;
@@ -456,6 +554,12 @@ private:
 	std::vector<Span_T<T>>		m_dValuePtrs;
 };
 
+template <typename T>
+size_t StoredBlock_MvaPFOR_T<T>::GetAllocatedBytes() const
+{
+	return m_dSubblockCumulativeSizes.GetAllocatedBytes() + m_dTmp.GetAllocatedBytes() + m_dLengths.GetAllocatedBytes() + m_dValues.GetAllocatedBytes() + m_dValuePtrs.capacity()*sizeof(m_dValuePtrs[0]);
+}
+
 template <typename T>
 StoredBlock_MvaPFOR_T<T>::StoredBlock_MvaPFOR_T ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion  )
 	: StoredBlock_Mva_c ( sCodec32, sCodec64, uVersion )
@@ -521,6 +625,276 @@ FORCE_INLINE uint32_t StoredBlock_MvaPFOR_T<T>::GetValue ( uint8_t * & pValue, i
 
 //////////////////////////////////////////////////////////////////////////
 
+template <typename T>
+class StoredBlock_MvaDict_T : public StoredBlock_Mva_c
+{
+public:
+							StoredBlock_MvaDict_T ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion, int iSubblockSize );
+
+	FORCE_INLINE void		ReadHeader ( FileReader_c & tReader, int iNumSubblocks );
+	FORCE_INLINE void		ReadSubblock ( int iSubblockId, int iSubblockValues, FileReader_c & tReader );
+
+	template <bool PACK>
+	FORCE_INLINE uint32_t	GetValue ( uint8_t * & pValue, int iIdInSubblock );
+	FORCE_INLINE int		GetValueLength ( int iIdInSubblock ) const;
+
+	FORCE_INLINE const SpanResizeable_T<T> & GetDict() const	{ return m_dDict; }
+	FORCE_INLINE int		GetNumPresent() const					{ return (int)m_dPresent.size(); }
+	FORCE_INLINE int		GetPresentId ( int iPresent ) const		{ return m_dPresent[iPresent]; }
+	FORCE_INLINE const uint64_t * GetBitmap ( int iPresent ) const	{ return &m_dBitmaps [ iPresent*m_iNumWords ]; }
+	FORCE_INLINE int		GetNumWords() const						{ return m_iNumWords; }
+	size_t					GetAllocatedBytes() const;
+
+private:
+	SpanResizeable_T<uint32_t>	m_dSubblockCumulativeSizes;
+	SpanResizeable_T<uint32_t>	m_dTmp;
+
+	SpanResizeable_T<T>			m_dDict;
+	std::vector<uint8_t>		m_dPresent;		// dictionary ids of elements present in current subblock
+	std::vector<uint64_t>		m_dBitmaps;		// per-element row bitmaps of current subblock
+	std::vector<T>				m_dRowValues;
+	int							m_iNumWords = 0;
+
+	FORCE_INLINE bool		IsSet ( int iPresent, int iIdInSubblock ) const { return !!( GetBitmap(iPresent)[iIdInSubblock>>6] & ( 1ULL << ( iIdInSubblock & 63 ) ) ); }
+};
+
+template <typename T>
+size_t StoredBlock_MvaDict_T<T>::GetAllocatedBytes() const
+{
+	return m_dSubblockCumulativeSizes.GetAllocatedBytes() + m_dTmp.GetAllocatedBytes() + m_dDict.GetAllocatedBytes() + m_dPresent.capacity()
+		+ m_dBitmaps.capacity()*sizeof(uint64_t) + m_dRowValues.capacity()*sizeof(T);
+}
+
+template <typename T>
+StoredBlock_MvaDict_T<T>::StoredBlock_MvaDict_T ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion, int iSubblockSize )
+	: StoredBlock_Mva_c ( sCodec32, sCodec64, uVersion )
+{
+	// the presence mask limits the dictionary to 64 elements
+	m_dPresent.reserve(64);
+	m_dBitmaps.reserve ( 64*( iSubblockSize>>6 ) );
+	m_dRowValues.resize(64);
+}
+
+template <typename T>
+void StoredBlock_MvaDict_T<T>::ReadHeader ( FileReader_c & tReader, int iNumSubblocks )
+{
+	ReadSortedFlag(tReader);
+
+	m_dDict.resize ( tReader.Unpack_uint32() );
+	uint32_t uDictSize = tReader.Unpack_uint32();
+	DecodeValues_Delta_PFOR ( m_dDict, tReader, *m_pCodec, m_dTmp, uDictSize, false, m_uVersion );
+
+	m_dSubblockCumulativeSizes.resize(iNumSubblocks);
+	uint32_t uSubblockSize = tReader.Unpack_uint32();
+	DecodeValues_Delta_PFOR ( m_dSubblockCumulativeSizes, tReader, *m_pCodec, m_dTmp, uSubblockSize, false, m_uVersion );
+
+	m_tValuesOffset = tReader.GetPos();
+	m_iSubblockId = -1;
+}
+
+template <typename T>
+void StoredBlock_MvaDict_T<T>::ReadSubblock ( int iSubblockId, int iSubblockValues, FileReader_c & tReader )
+{
+	if ( m_iSubblockId==iSubblockId )
+		return;
+
+	m_iSubblockId = iSubblockId;
+
+	uint32_t uOffset = iSubblockId>0 ? m_dSubblockCumulativeSizes[iSubblockId-1] : 0;
+	tReader.Seek ( m_tValuesOffset+uOffset );
+
+	uint64_t uMask = tReader.Read_uint64();
+	m_dPresent.resize(0);
+	for ( int i = 0; uMask; i++, uMask >>= 1 )
+		if ( uMask & 1 )
+			m_dPresent.push_back ( (uint8_t)i );
+
+	m_iNumWords = ( iSubblockValues+63 ) >> 6;
+	m_dBitmaps.resize ( m_dPresent.size()*m_iNumWords );
+	tReader.Read ( (uint8_t*)m_dBitmaps.data(), m_dBitmaps.size()*sizeof ( m_dBitmaps[0] ) );
+}
+
+template <typename T>
+template <bool PACK>
+uint32_t StoredBlock_MvaDict_T<T>::GetValue ( uint8_t * & pValue, int iIdInSubblock )
+{
+	// elements are stored in ascending order, so the rebuilt MVA is sorted too
+	int iLength = 0;
+	for ( int i = 0; i < GetNumPresent(); i++ )
+		if ( IsSet ( i, iIdInSubblock ) )
+			m_dRowValues[iLength++] = m_dDict [ m_dPresent[i] ];
+
+	return PackValue<T,PACK> ( Span_T<T> ( m_dRowValues.data(), iLength ), pValue );
+}
+
+template <typename T>
+int StoredBlock_MvaDict_T<T>::GetValueLength ( int iIdInSubblock ) const
+{
+	int iLength = 0;
+	for ( int i = 0; i < GetNumPresent(); i++ )
+		iLength += IsSet ( i, iIdInSubblock );
+
+	return iLength*sizeof(T);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class StoredBlock_MvaFloatVec_T : public StoredBlock_Mva_c
+{
+public:
+							StoredBlock_MvaFloatVec_T ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion, int iSubblockSize );
+
+	FORCE_INLINE void		ReadHeader ( FileReader_c & tReader );
+	FORCE_INLINE void		ReadSubblock ( int iSubblockId, int iSubblockValues, FileReader_c & tReader );
+
+	template <bool PACK>
+	FORCE_INLINE uint32_t	GetValue ( uint8_t * & pValue, int iIdInSubblock );
+	FORCE_INLINE int		GetValueLength ( int iIdInSubblock ) const	{ return GetLength(iIdInSubblock)*sizeof(float); }
+	FORCE_INLINE int		Decode ( int iIdInSubblock, Span_T<float> & dValues ) const;
+	size_t					GetAllocatedBytes() const { return m_dTmp.GetAllocatedBytes() + m_dLengths.GetAllocatedBytes() + m_dOffsets.capacity()*sizeof(uint64_t) + m_dData.capacity() + m_dDecoded.capacity()*sizeof(float); }
+
+private:
+	SpanResizeable_T<uint32_t>	m_dTmp;
+	SpanResizeable_T<uint32_t>	m_dLengths;
+	std::vector<uint64_t>		m_dOffsets;		// vector offsets in bytes; only used for variable length vectors
+	std::vector<uint8_t>		m_dData;		// raw vectors of current subblock
+	std::vector<float>			m_dDecoded;
+
+	FloatVecStorage_e			m_eStorage = FloatVecStorage_e::FLOAT32;
+	int							m_iSubblockSize = 0;
+	int							m_iConstLength = -1;
+	int							m_iElementSize = 0;
+	int							m_iScaleSize = 0;
+	float						m_fBlockScale = 0.0f;
+	int							m_iFirstRow = 0;
+
+	FORCE_INLINE uint64_t		GetOffset ( int iRow ) const		{ return m_iConstLength>=0 ? uint64_t(iRow)*( m_iScaleSize + m_iConstLength*m_iElementSize ) : m_dOffsets[iRow]; }
+	FORCE_INLINE int			GetLength ( int iIdInSubblock ) const	{ return m_iConstLength>=0 ? m_iConstLength : (int)m_dLengths[m_iFirstRow+iIdInSubblock]; }
+	FORCE_INLINE const uint8_t *GetData ( int iIdInSubblock ) const	{ return m_dData.data() + ( GetOffset ( m_iFirstRow+iIdInSubblock ) - GetOffset(m_iFirstRow) ); }
+	FORCE_INLINE void			DecodeValues ( const uint8_t * pData, int iLength, float * pDst ) const;
+};
+
+template <typename T>
+StoredBlock_MvaFloatVec_T<T>::StoredBlock_MvaFloatVec_T ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion, int iSubblockSize )
+	: StoredBlock_Mva_c ( sCodec32, sCodec64, uVersion )
+	, m_iSubblockSize ( iSubblockSize )
+{}
+
+template <typename T>
+void StoredBlock_MvaFloatVec_T<T>::ReadHeader ( FileReader_c & tReader )
+{
+	ReadSortedFlag(tReader);
+
+	m_eStorage = (FloatVecStorage_e)tReader.Read_uint8();
+	switch ( m_eStorage )
+	{
+	case FloatVecStorage_e::FLOAT16:
+	case FloatVecStorage_e::BFLOAT16:	m_iElementSize = sizeof(uint16_t); break;
+	case FloatVecStorage_e::INT8_VECTOR:
+	case FloatVecStorage_e::INT8_BLOCK:	m_iElementSize = sizeof(int8_t); break;
+	default:							m_iElementSize = sizeof(float); break;
+	}
+
+	m_iScaleSize = m_eStorage==FloatVecStorage_e::INT8_VECTOR ? sizeof(float) : 0;
+
+	m_iConstLength = int ( tReader.Unpack_uint32() ) - 1;
+	if ( m_iConstLength<0 )
+	{
+		m_dLengths.resize ( tReader.Unpack_uint32() );
+		uint32_t uSizeOfLengths = tReader.Unpack_uint32();
+		DecodeValues_PFOR ( m_dLengths, tReader, *m_pCodec, m_dTmp, uSizeOfLengths );
+
+		m_dOffsets.resize ( m_dLengths.size()+1 );
+		m_dOffsets[0] = 0;
+		for ( size_t i = 0; i < m_dLengths.size(); i++ )
+			m_dOffsets[i+1] = m_dOffsets[i] + m_iScaleSize + m_dLengths[i]*m_iElementSize;
+	}
+
+	if ( m_eStorage==FloatVecStorage_e::INT8_BLOCK )
+		m_fBlockScale = UintToFloat ( tReader.Read_uint32() );
+
+	m_tValuesOffset = tReader.GetPos();
+	m_iSubblockId = -1;
+}
+
+template <typename T>
+void StoredBlock_MvaFloatVec_T<T>::ReadSubblock ( int iSubblockId, int iSubblockValues, FileReader_c & tReader )
+{
+	if ( m_iSubblockId==iSubblockId )
+		return;
+
+	m_iSubblockId = iSubblockId;
+	m_iFirstRow = iSubblockId*m_iSubblockSize;
+
+	uint64_t uStart = GetOffset(m_iFirstRow);
+	m_dData.resize ( GetOffset ( m_iFirstRow+iSubblockValues ) - uStart );
+	tReader.Seek ( m_tValuesOffset+uStart );
+	tReader.Read ( m_dData.data(), m_dData.size() );
+}
+
+template <typename T>
+void StoredBlock_MvaFloatVec_T<T>::DecodeValues ( const uint8_t * pData, int iLength, float * pDst ) const
+{
+	switch ( m_eStorage )
+	{
+	case FloatVecStorage_e::FLOAT16:
+		for ( int i = 0; i < iLength; i++ )
+			pDst[i] = HalfToFloat ( ((const uint16_t*)pData)[i] );
+		break;
+
+	case FloatVecStorage_e::BFLOAT16:
+		for ( int i = 0; i < iLength; i++ )
+			pDst[i] = BFloat16ToFloat ( ((const uint16_t*)pData)[i] );
+		break;
+
+	case FloatVecStorage_e::INT8_VECTOR:
+	case FloatVecStorage_e::INT8_BLOCK:
+	{
+		float fScale = m_fBlockScale;
+		if ( m_iScaleSize )
+		{
+			memcpy ( &fScale, pData, sizeof(fScale) );
+			pData += sizeof(fScale);
+		}
+
+		for ( int i = 0; i < iLength; i++ )
+			pDst[i] = ((const int8_t*)pData)[i]*fScale;
+	}
+	break;
+
+	default:
+		memcpy ( pDst, pData, iLength*sizeof(float) );
+		break;
+	}
+}
+
+template <typename T>
+template <bool PACK>
+uint32_t StoredBlock_MvaFloatVec_T<T>::GetValue ( uint8_t * & pValue, int iIdInSubblock )
+{
+	int iLength = GetLength(iIdInSubblock);
+	const uint8_t * pData = GetData(iIdInSubblock);
+
+	// raw float32 vectors are returned straight from the subblock buffer
+	if ( m_eStorage==FloatVecStorage_e::FLOAT32 )
+		return PackValue<float,PACK> ( Span_T<float> ( (float*)pData, iLength ), pValue );
+
+	m_dDecoded.resize(iLength);
+	DecodeValues ( pData, iLength, m_dDecoded.data() );
+	return PackValue<float,PACK> ( Span_T<float>(m_dDecoded), pValue );
+}
+
+template <typename T>
+int StoredBlock_MvaFloatVec_T<T>::Decode ( int iIdInSubblock, Span_T<float> & dValues ) const
+{
+	int iLength = GetLength(iIdInSubblock);
+	DecodeValues ( GetData(iIdInSubblock), std::min ( iLength, (int)dValues.size() ), dValues.data() );
+	return iLength;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 template<typename T>
 class Accessor_MVA_T : public StoredBlockTraits_t
 {
@@ -530,15 +904,21 @@ public:
 									Accessor_MVA_T ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader );
 
 	FORCE_INLINE void				SetCurBlock ( uint32_t uBlockId );
+	void							AddMemoryUsage ( MemoryUsage_t & tUsage ) const;
+	FORCE_INLINE int				GetPackingId() const	{ return to_underlying(m_ePacking); }
+	int64_t							GetBytesRead() const	{ return m_pReader->GetBytesRead(); }
 
 protected:
 	const AttributeHeader_i &		m_tHeader;
+	std::shared_ptr<const AttributeHeader_i>	m_pHeaderRef;	// keeps an evictable header alive
 	std::unique_ptr<FileReader_c>	m_pReader;
 
 	StoredBlock_MvaConst_T<T>		m_tBlockConst;
 	StoredBlock_MvaConstLen_T<T>	m_tBlockConstLen;
 	StoredBlock_MvaTable_T<T>		m_tBlockTable;
 	StoredBlock_MvaPFOR_T<T>		m_tBlockPFOR;
+	StoredBlock_MvaDict_T<T>		m_tBlockDict;
+	StoredBlock_MvaFloatVec_T<T>	m_tBlockFloatVec;
 
 	void	(Accessor_MVA_T::*m_fnReadValue)()		= nullptr;
 	void	(Accessor_MVA_T::*m_fnReadValuePacked)()= nullptr;
@@ -561,6 +941,12 @@ protected:
 	template <bool PACK> void		ReadValue_PFOR()			{ m_tValueLength = m_tBlockPFOR.template GetValue<PACK> ( m_pResult, ReadSubblock(m_tBlockPFOR) ); }
 	int								GetValueLength_PFOR()		{ return m_tBlockPFOR.GetValueLength ( ReadSubblock(m_tBlockPFOR) ); }
 
+	template <bool PACK> void		ReadValue_Dict()			{ m_tValueLength = m_tBlockDict.template GetValue<PACK> ( m_pResult, ReadSubblock(m_tBlockDict) ); }
+	int								GetValueLength_Dict()		{ return m_tBlockDict.GetValueLength ( ReadSubblock(m_tBlockDict) ); }
+
+	template <bool PACK> void		ReadValue_FloatVec()		{ m_tValueLength = m_tBlockFloatVec.template GetValue<PACK> ( m_pResult, ReadSubblock(m_tBlockFloatVec) ); }
+	int								GetValueLength_FloatVec()	{ return m_tBlockFloatVec.GetValueLength ( ReadSubblock(m_tBlockFloatVec) ); }
+
 	template <typename SUBBLOCK>
 	FORCE_INLINE int				ReadSubblock ( SUBBLOCK & tSubblock );
 };
@@ -569,15 +955,26 @@ template<typename T>
 Accessor_MVA_T<T>::Accessor_MVA_T ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader )
 	: StoredBlockTraits_t ( tHeader.GetSettings().m_iSubblockSize )
 	, m_tHeader ( tHeader )
+	, m_pHeaderRef ( tHeader.weak_from_this().lock() )
 	, m_pReader ( pReader )
 	, m_tBlockConst ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion )
 	, m_tBlockConstLen ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion )
 	, m_tBlockTable ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion, tHeader.GetSettings().m_iSubblockSize )
 	, m_tBlockPFOR ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion )
+	, m_tBlockDict ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion, tHeader.GetSettings().m_iSubblockSize )
+	, m_tBlockFloatVec ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion, tHeader.GetSettings().m_iSubblockSize )
 {
 	assert(pReader);
 }
 
+template<typename T>
+void Accessor_MVA_T<T>::AddMemoryUsage ( MemoryUsage_t & tUsage ) const
+{
+	tUsage.Add ( MemCategory_e::READER_BUFFERS, m_pReader->GetAllocatedBytes() );
+	tUsage.Add ( MemCategory_e::DECODE_SCRATCH, m_tBlockConst.GetAllocatedBytes() + m_tBlockConstLen.GetAllocatedBytes() + m_tBlockTable.GetAllocatedBytes()
+		+ m_tBlockPFOR.GetAllocatedBytes() + m_tBlockDict.GetAllocatedBytes() + m_tBlockFloatVec.GetAllocatedBytes() );
+}
+
 template<typename T>
 void Accessor_MVA_T<T>::SetCurBlock ( uint32_t uBlockId )
 {
@@ -620,6 +1017,20 @@ void Accessor_MVA_T<T>::SetCurBlock ( uint32_t uBlockId )
 		m_tBlockPFOR.ReadHeader ( *m_pReader, m_iNumSubblocks );
 		break;
 
+	case MvaPacking_e::DICT:
+		m_fnReadValue		= &Accessor_MVA_T<T>::ReadValue_Dict<false>;
+		m_fnReadValuePacked = &Accessor_MVA_T<T>::ReadValue_Dict<true>;
+		m_fnGetValueLength	= &Accessor_MVA_T<T>::GetValueLength_Dict;
+		m_tBlockDict.ReadHeader ( *m_pReader, m_iNumSubblocks );
+		break;
+
+	case MvaPacking_e::FLOATVEC:
+		m_fnReadValue		= &Accessor_MVA_T<T>::ReadValue_FloatVec<false>;
+		m_fnReadValuePacked = &Accessor_MVA_T<T>::ReadValue_FloatVec<true>;
+		m_fnGetValueLength	= &Accessor_MVA_T<T>::GetValueLength_FloatVec;
+		m_tBlockFloatVec.ReadHeader ( *m_pReader );
+		break;
+
 	default:
 		assert ( 0 && "Packing not implemented yet" );
 		break;
@@ -651,8 +1062,10 @@ public:
 	int			Get ( uint32_t tRowID, const uint8_t * & pData ) final;
 	uint8_t *	GetPacked ( uint32_t tRowID ) final;
 	int			GetLength ( uint32_t tRowID ) final;
+	int			GetFloatVec ( uint32_t tRowID, Span_T<float> & dValues ) final;
 
 	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { BASE::m_tHeader.GetName(), "iterator" } ); }
+	void		GetMemoryUsage ( MemoryUsage_t & tUsage ) const final { BASE::AddMemoryUsage(tUsage); }
 
 private:
 	FORCE_INLINE void AdvanceTo ( uint32_t tRowID );
@@ -711,6 +1124,23 @@ int Iterator_MVA_T<T>::GetLength ( uint32_t tRowID )
 	return (*this.*BASE::m_fnGetValueLength)();
 }
 
+template <typename T>
+int Iterator_MVA_T<T>::GetFloatVec ( uint32_t tRowID, Span_T<float> & dValues )
+{
+	assert ( BASE::m_tHeader.GetType()==AttrType_e::FLOATVEC );
+
+	AdvanceTo(tRowID);
+
+	if ( BASE::m_ePacking==MvaPacking_e::FLOATVEC )
+		return BASE::m_tBlockFloatVec.Decode ( BASE::ReadSubblock ( BASE::m_tBlockFloatVec ), dValues );
+
+	// float bits stored as MVA values
+	const uint8_t * pData = nullptr;
+	int iLength = Get ( tRowID, pData ) / sizeof(float);
+	memcpy ( dValues.data(), pData, std::min ( iLength, (int)dValues.size() )*sizeof(float) );
+	return iLength;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 class AnalyzerBlock_MVA_c : public Filter_t
@@ -925,6 +1355,106 @@ int AnalyzerBlock_MVA_Values_c::ProcessSubblock_Range ( uint32_t * & pRowID, con
 
 //////////////////////////////////////////////////////////////////////////
 
+class AnalyzerBlock_MVA_Dict_c : public AnalyzerBlock_MVA_c
+{
+	using AnalyzerBlock_MVA_c::AnalyzerBlock_MVA_c;
+
+public:
+	template<typename T, typename T_COMP, typename FUNC>
+	FORCE_INLINE bool	SetupNextBlock ( const StoredBlock_MvaDict_T<T> & tBlock );
+
+	template<typename T, typename FUNC>
+	FORCE_INLINE int	ProcessSubblock ( uint32_t * & pRowID, const StoredBlock_MvaDict_T<T> & tBlock, int iNumValues );
+
+private:
+	uint64_t				m_uMatching = 0;	// dictionary elements that pass the filter
+	bool					m_bNeedElements = true;
+	std::vector<uint64_t>	m_dMatching;		// rows that have any matching element
+	std::vector<uint64_t>	m_dNonMatching;		// rows that have any non-matching element
+};
+
+template<typename T, typename T_COMP, typename FUNC>
+bool AnalyzerBlock_MVA_Dict_c::SetupNextBlock ( const StoredBlock_MvaDict_T<T> & tBlock )
+{
+	// test every dictionary element as a single-value MVA; per-row results are then combined from bitmaps
+	const auto & dDict = tBlock.GetDict();
+	m_uMatching = 0;
+	for ( size_t i = 0; i < dDict.size(); i++ )
+	{
+		Span_T<T_COMP> tCheck ( (T_COMP*)&dDict[i], 1 );
+		bool bMatch = false;
+		switch ( m_eType )
+		{
+		case FilterType_e::VALUES:
+			bMatch = m_dValues.size()==1 ? FUNC::Test ( tCheck, m_iValue ) : FUNC::Test ( tCheck, m_dValues );
+			break;
+
+		case FilterType_e::RANGE:
+			bMatch = FUNC::Test ( tCheck, m_iMinValue, m_iMaxValue );
+			break;
+
+		default:
+			break;
+		}
+
+		if ( bMatch ^ FUNC::EXCLUDE )
+			m_uMatching |= 1ULL << i;
+	}
+
+	// ALL filters match empty MVAs only when testing against a single value
+	m_bNeedElements = !FUNC::IS_ALL || m_eType!=FilterType_e::VALUES || m_dValues.size()!=1;
+
+	// ANY can only match rows that have a matching element
+	return FUNC::IS_ALL || FUNC::EXCLUDE || m_uMatching;
+}
+
+template<typename T, typename FUNC>
+int AnalyzerBlock_MVA_Dict_c::ProcessSubblock ( uint32_t * & pRowID, const StoredBlock_MvaDict_T<T> & tBlock, int iNumValues )
+{
+	int iNumWords = tBlock.GetNumWords();
+	m_dMatching.resize(iNumWords);
+	std::fill ( m_dMatching.begin(), m_dMatching.end(), 0 );
+	if ( FUNC::IS_ALL )
+	{
+		m_dNonMatching.resize(iNumWords);
+		std::fill ( m_dNonMatching.begin(), m_dNonMatching.end(), 0 );
+	}
+
+	for ( int i = 0; i < tBlock.GetNumPresent(); i++ )
+	{
+		bool bMatching = !!( m_uMatching & ( 1ULL << tBlock.GetPresentId(i) ) );
+		if ( !FUNC::IS_ALL && !bMatching )
+			continue;
+
+		uint64_t * pDst = bMatching ? m_dMatching.data() : m_dNonMatching.data();
+		const uint64_t * pBitmap = tBlock.GetBitmap(i);
+		for ( int iWord = 0; iWord < iNumWords; iWord++ )
+			pDst[iWord] |= pBitmap[iWord];
+	}
+
+	uint32_t tRowID = m_tRowID;
+	for ( int iWord = 0; iWord < iNumWords; iWord++, tRowID += 64 )
+	{
+		uint64_t uWord = m_dMatching[iWord];
+		if ( FUNC::IS_ALL )
+			uWord = m_bNeedElements ? ( uWord & ~m_dNonMatching[iWord] ) : ~m_dNonMatching[iWord];
+
+		if ( FUNC::EXCLUDE )
+			uWord = ~uWord;
+
+		int iLeftover = iNumValues - ( iWord<<6 );
+		if ( iLeftover < 64 )
+			uWord &= ( 1ULL << iLeftover ) - 1;
+
+		BitmapWordToRowIDs ( uWord, tRowID, pRowID );
+	}
+
+	m_tRowID += iNumValues;
+	return iNumValues;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 template <typename T, typename T_COMP, typename FUNC, bool HAVE_MATCHING_BLOCKS>
 class Analyzer_MVA_T : public Analyzer_T<HAVE_MATCHING_BLOCKS>, public Accessor_MVA_T<T>
 {
@@ -935,12 +1465,13 @@ public:
 				Analyzer_MVA_T ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader, const Filter_t & tSettings );
 
 	bool		GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) final;
-	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan" } ); }
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan", ANALYZER::m_tStats } ); }
 
 private:
 	AnalyzerBlock_MVA_Const_c	m_tBlockConst;
 	AnalyzerBlock_MVA_Table_c	m_tBlockTable;
 	AnalyzerBlock_MVA_Values_c	m_tBlockValues;
+	AnalyzerBlock_MVA_Dict_c	m_tBlockDict;
 
 	const Filter_t &			m_tSettings;
 
@@ -952,6 +1483,7 @@ private:
 
 	int			ProcessSubblockConst ( uint32_t * & pRowID, int iSubblockIdInBlock );
 	int			ProcessSubblockTable ( uint32_t * & pRowID, int iSubblockIdInBlock );
+	int			ProcessSubblockDict ( uint32_t * & pRowID, int iSubblockIdInBlock );
 
 	int			ProcessSubblockConstLen_SingleValue ( uint32_t * & pRowID, int iSubblockIdInBlock );
 	int			ProcessSubblockDeltaPFOR_SingleValue ( uint32_t * & pRowID, int iSubblockIdInBlock );
@@ -972,11 +1504,13 @@ Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::Analyzer_MVA_T ( const Attri
 	, m_tBlockConst ( ANALYZER::m_tRowID )
 	, m_tBlockTable ( ANALYZER::m_tRowID )
 	, m_tBlockValues ( ANALYZER::m_tRowID )
+	, m_tBlockDict ( ANALYZER::m_tRowID )
 	, m_tSettings ( tSettings )
 {
 	m_tBlockConst.Setup(m_tSettings);
 	m_tBlockTable.Setup(m_tSettings);
 	m_tBlockValues.Setup(m_tSettings);
+	m_tBlockDict.Setup(m_tSettings);
 
 	SetupPackingFuncs();
 }
@@ -1000,6 +1534,9 @@ void Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::SetupPackingFuncs()
 	// doesn't depend on filter type too; work off pre-calculated array
 	dFuncs [ to_underlying ( MvaPacking_e::TABLE ) ] = &Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::ProcessSubblockTable;
 
+	// same as table: per-element results are pre-calculated, rows are collected from bitmaps
+	dFuncs [ to_underlying ( MvaPacking_e::DICT ) ] = &Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::ProcessSubblockDict;
+
 	switch ( m_tSettings.m_eType )
 	{
 	case FilterType_e::VALUES:
@@ -1039,6 +1576,14 @@ int Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::ProcessSubblockTable ( u
 	return m_tBlockTable.ProcessSubblock ( pRowID, ACCESSOR::m_tBlockTable.GetValueIndexes() );
 }
 
+template <typename T, typename T_COMP, typename FUNC, bool HAVE_MATCHING_BLOCKS>
+int Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::ProcessSubblockDict ( uint32_t * & pRowID, int iSubblockIdInBlock )
+{
+	int iNumValues = StoredBlockTraits_t::GetNumSubblockValues(iSubblockIdInBlock);
+	ACCESSOR::m_tBlockDict.ReadSubblock ( iSubblockIdInBlock, iNumValues, *ACCESSOR::m_pReader );
+	return m_tBlockDict.template ProcessSubblock<T,FUNC> ( pRowID, ACCESSOR::m_tBlockDict, iNumValues );
+}
+
 template <typename T, typename T_COMP, typename FUNC, bool HAVE_MATCHING_BLOCKS>
 int Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::ProcessSubblockConstLen_SingleValue ( uint32_t * & pRowID, int iSubblockIdInBlock )
 {
@@ -1088,20 +1633,28 @@ bool Analyzer_MVA_T<T,T_COMP,FUNC,HAVE_MATCHING_BLOCKS>::MoveToBlock ( int iNext
 	{
 		ANALYZER::StartBlockProcessing ( (ACCESSOR&)*this, iNextBlock );
 
-		if ( ACCESSOR::m_ePacking!=MvaPacking_e::CONST && ACCESSOR::m_ePacking!=MvaPacking_e::TABLE )
+		bool bMatches = true;
+		switch ( ACCESSOR::m_ePacking )
+		{
+		case MvaPacking_e::CONST:
+			bMatches = m_tBlockConst.template SetupNextBlock<T,T_COMP,FUNC> ( ACCESSOR::m_tBlockConst );
 			break;
 
-		if ( ACCESSOR::m_ePacking==MvaPacking_e::CONST )
-		{
-			if ( m_tBlockConst.template SetupNextBlock<T,T_COMP,FUNC> ( ACCESSOR::m_tBlockConst ) )
-				break;
-		}
-		else
-		{
-			if ( m_tBlockTable.template SetupNextBlock<T,T_COMP,FUNC> ( ACCESSOR::m_tBlockTable ) )
-				break;
+		case MvaPacking_e::TABLE:
+			bMatches = m_tBlockTable.template SetupNextBlock<T,T_COMP,FUNC> ( ACCESSOR::m_tBlockTable );
+			break;
+
+		case MvaPacking_e::DICT:
+			bMatches = m_tBlockDict.template SetupNextBlock<T,T_COMP,FUNC> ( ACCESSOR::m_tBlockDict );
+			break;
+
+		default:
+			break;
 		}
 
+		if ( bMatches )
+			break;
+
 		if ( !ANALYZER::RewindToNextBlock ( (ACCESSOR&)*this, iNextBlock ) )
 			return false;
 	}
@@ -1179,7 +1732,7 @@ private:
 bool Checker_Mva_c::CheckBlockHeader ( uint32_t uBlockId )
 {
 	uint32_t uPacking = m_pReader->Unpack_uint32();
-	if ( uPacking!=(uint32_t)MvaPacking_e::CONST && uPacking!=(uint32_t)MvaPacking_e::CONSTLEN && uPacking!=(uint32_t)MvaPacking_e::TABLE && uPacking!=(uint32_t)MvaPacking_e::DELTA_PFOR )
+	if ( uPacking!=(uint32_t)MvaPacking_e::CONST && uPacking!=(uint32_t)MvaPacking_e::CONSTLEN && uPacking!=(uint32_t)MvaPacking_e::TABLE && uPacking!=(uint32_t)MvaPacking_e::DELTA_PFOR && uPacking!=(uint32_t)MvaPacking_e::DICT && uPacking!=(uint32_t)MvaPacking_e::FLOATVEC )
 	{
 		m_fnError ( FormatStr ( "Unknown encoding of block %u: %u", uBlockId, uPacking ).c_str() );
 		return false;
@@ -0,0 +1,256 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "accessorpatch.h"
+
+#include "util_private.h"
+#include "interval.h"
+#include <algorithm>
+
+namespace columnar
+{
+
+using namespace util;
+using namespace common;
+
+void AttrPatch_c::Set ( uint32_t tRowID, int64_t tValue )
+{
+	auto tFound = std::lower_bound ( m_dValues.begin(), m_dValues.end(), tRowID, []( const Value_t & tA, uint32_t tB ){ return tA.first < tB; } );
+	if ( tFound!=m_dValues.end() && tFound->first==tRowID )
+		tFound->second = tValue;
+	else
+		m_dValues.insert ( tFound, { tRowID, tValue } );
+}
+
+
+bool AttrPatch_c::Get ( uint32_t tRowID, int64_t & tValue ) const
+{
+	auto tFound = std::lower_bound ( m_dValues.begin(), m_dValues.end(), tRowID, []( const Value_t & tA, uint32_t tB ){ return tA.first < tB; } );
+	if ( tFound==m_dValues.end() || tFound->first!=tRowID )
+		return false;
+
+	tValue = tFound->second;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+class Iterator_Patched_c : public Iterator_i
+{
+public:
+				Iterator_Patched_c ( Iterator_i * pIterator, const AttrPatch_c & tPatch ) : m_pIterator ( pIterator ), m_tPatch ( tPatch ) {}
+
+	int64_t		Get ( uint32_t tRowID ) final;
+	void		Fetch ( const Span_T<uint32_t> & dRowIDs, Span_T<int64_t> & dValues ) final;
+
+	int			Get ( uint32_t tRowID, const uint8_t * & pData ) final			{ return m_pIterator->Get ( tRowID, pData ); }
+	uint8_t *	GetPacked ( uint32_t tRowID ) final								{ return m_pIterator->GetPacked(tRowID); }
+	int			GetLength ( uint32_t tRowID ) final								{ return m_pIterator->GetLength(tRowID); }
+	int			GetFloatVec ( uint32_t tRowID, Span_T<float> & dValues ) final	{ return m_pIterator->GetFloatVec ( tRowID, dValues ); }
+
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final		{ m_pIterator->AddDesc(dDesc); }
+	void		GetMemoryUsage ( MemoryUsage_t & tUsage ) const final		{ m_pIterator->GetMemoryUsage(tUsage); }
+
+private:
+	std::unique_ptr<Iterator_i>	m_pIterator;
+	const AttrPatch_c &			m_tPatch;
+};
+
+
+int64_t Iterator_Patched_c::Get ( uint32_t tRowID )
+{
+	int64_t tValue = 0;
+	if ( m_tPatch.Get ( tRowID, tValue ) )
+		return tValue;
+
+	return m_pIterator->Get(tRowID);
+}
+
+
+void Iterator_Patched_c::Fetch ( const Span_T<uint32_t> & dRowIDs, Span_T<int64_t> & dValues )
+{
+	m_pIterator->Fetch ( dRowIDs, dValues );
+
+	// rowids are sorted, so walk the patch only over the fetched range
+	const auto & dPatched = m_tPatch.GetValues();
+	if ( dRowIDs.empty() || dPatched.empty() || dRowIDs.back() < dPatched.front().first || dRowIDs.front() > dPatched.back().first )
+		return;
+
+	for ( size_t i = 0; i < dRowIDs.size(); i++ )
+		m_tPatch.Get ( dRowIDs[i], dValues[i] );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static bool PatchedValueMatches ( int64_t tValue, AttrType_e eType, const Filter_t & tSettings )
+{
+	bool bMatch = false;
+	switch ( tSettings.m_eType )
+	{
+	case FilterType_e::VALUES:
+		if ( eType==AttrType_e::BOOLEAN )
+			bMatch = std::any_of ( tSettings.m_dValues.begin(), tSettings.m_dValues.end(), [tValue]( int64_t i ){ return ( i!=0 )==( tValue!=0 ); } );
+		else
+			bMatch = std::find ( tSettings.m_dValues.begin(), tSettings.m_dValues.end(), tValue )!=tSettings.m_dValues.end();
+		break;
+
+	case FilterType_e::RANGE:
+		bMatch = ValueInInterval ( tValue, tSettings );
+		break;
+
+	case FilterType_e::FLOATRANGE:
+		bMatch = ValueInInterval ( eType==AttrType_e::FLOAT ? UintToFloat ( (uint32_t)tValue ) : (float)tValue, tSettings );
+		break;
+
+	default:
+		break;
+	}
+
+	return bMatch ^ tSettings.m_bExclude;
+}
+
+
+// merges the rowids of the wrapped analyzer with the patched rows that match the filter
+class Analyzer_Patched_c : public Analyzer_i
+{
+public:
+				Analyzer_Patched_c ( Analyzer_i * pAnalyzer, const AttrPatch_c & tPatch, AttrType_e eType, const Filter_t & tSettings );
+
+	void		Setup ( SharedBlocks_c & pBlocks, uint32_t uTotalDocs ) final	{ m_pAnalyzer->Setup ( pBlocks, uTotalDocs ); }
+	void		SetDeadRows ( const DeadRows_t & tDeadRows ) final;
+
+	bool		HintRowID ( uint32_t tRowID ) final;
+	bool		GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) final;
+	int64_t		GetNumProcessed() const final									{ return m_pAnalyzer->GetNumProcessed(); }
+
+	void		SetCutoff ( int iCutoff ) final									{ m_pAnalyzer->SetCutoff(iCutoff); }
+	bool		WasCutoffHit() const final										{ return m_pAnalyzer->WasCutoffHit(); }
+
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final		{ m_pAnalyzer->AddDesc(dDesc); }
+	void		GetStats ( IteratorStats_t & tStats ) const final				{ m_pAnalyzer->GetStats(tStats); }
+	void		SetCollectTime ( bool bCollect ) final							{ m_pAnalyzer->SetCollectTime(bCollect); }
+
+private:
+	std::unique_ptr<Analyzer_i>	m_pAnalyzer;
+	std::vector<uint32_t>		m_dPatchedRows;		// all patched rows; their stored values are stale
+	std::vector<uint32_t>		m_dMatchingRows;	// patched rows that match the filter
+	std::vector<uint32_t>		m_dRowIDs;
+	size_t						m_iPatchedRow = 0;
+	size_t						m_iMatchingRow = 0;
+	bool						m_bAnalyzerDone = false;
+};
+
+
+Analyzer_Patched_c::Analyzer_Patched_c ( Analyzer_i * pAnalyzer, const AttrPatch_c & tPatch, AttrType_e eType, const Filter_t & tSettings )
+	: m_pAnalyzer ( pAnalyzer )
+{
+	for ( const auto & i : tPatch.GetValues() )
+	{
+		m_dPatchedRows.push_back ( i.first );
+		if ( PatchedValueMatches ( i.second, eType, tSettings ) )
+			m_dMatchingRows.push_back ( i.first );
+	}
+}
+
+
+void Analyzer_Patched_c::SetDeadRows ( const DeadRows_t & tDeadRows )
+{
+	m_pAnalyzer->SetDeadRows(tDeadRows);
+	if ( !m_dMatchingRows.empty() )
+		m_dMatchingRows.resize ( tDeadRows.RemoveDead ( m_dMatchingRows.data(), m_dMatchingRows.data() + m_dMatchingRows.size() ) - m_dMatchingRows.data() );
+}
+
+
+bool Analyzer_Patched_c::HintRowID ( uint32_t tRowID )
+{
+	if ( !m_bAnalyzerDone && !m_pAnalyzer->HintRowID(tRowID) )
+		m_bAnalyzerDone = true;
+
+	m_iMatchingRow = std::lower_bound ( m_dMatchingRows.begin() + m_iMatchingRow, m_dMatchingRows.end(), tRowID ) - m_dMatchingRows.begin();
+	return !m_bAnalyzerDone || m_iMatchingRow < m_dMatchingRows.size();
+}
+
+
+bool Analyzer_Patched_c::GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock )
+{
+	while ( !m_bAnalyzerDone )
+	{
+		Span_T<uint32_t> dAnalyzed;
+		if ( !m_pAnalyzer->GetNextRowIdBlock(dAnalyzed) )
+		{
+			m_bAnalyzerDone = true;
+			break;
+		}
+
+		if ( dAnalyzed.empty() )
+			continue;
+
+		m_dRowIDs.resize(0);
+		for ( auto tRowID : dAnalyzed )
+		{
+			while ( m_iMatchingRow < m_dMatchingRows.size() && m_dMatchingRows[m_iMatchingRow] < tRowID )
+				m_dRowIDs.push_back ( m_dMatchingRows[m_iMatchingRow++] );
+
+			while ( m_iPatchedRow < m_dPatchedRows.size() && m_dPatchedRows[m_iPatchedRow] < tRowID )
+				m_iPatchedRow++;
+
+			// patched rows come from m_dMatchingRows only
+			if ( m_iPatchedRow < m_dPatchedRows.size() && m_dPatchedRows[m_iPatchedRow]==tRowID )
+				continue;
+
+			m_dRowIDs.push_back(tRowID);
+		}
+
+		uint32_t tLast = dAnalyzed.back();
+		while ( m_iMatchingRow < m_dMatchingRows.size() && m_dMatchingRows[m_iMatchingRow]<=tLast )
+			m_dRowIDs.push_back ( m_dMatchingRows[m_iMatchingRow++] );
+
+		if ( !m_dRowIDs.empty() )
+		{
+			dRowIdBlock = Span_T<uint32_t>(m_dRowIDs);
+			return true;
+		}
+	}
+
+	if ( m_iMatchingRow>=m_dMatchingRows.size() )
+		return false;
+
+	m_dRowIDs.assign ( m_dMatchingRows.begin() + m_iMatchingRow, m_dMatchingRows.end() );
+	m_iMatchingRow = m_dMatchingRows.size();
+	dRowIdBlock = Span_T<uint32_t>(m_dRowIDs);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+Iterator_i * CreatePatchedIterator ( Iterator_i * pIterator, const AttrPatch_c & tPatch )
+{
+	if ( !pIterator || tPatch.IsEmpty() )
+		return pIterator;
+
+	return new Iterator_Patched_c ( pIterator, tPatch );
+}
+
+
+Analyzer_i * CreatePatchedAnalyzer ( Analyzer_i * pAnalyzer, const AttrPatch_c & tPatch, AttrType_e eType, const Filter_t & tSettings )
+{
+	if ( !pAnalyzer || tPatch.IsEmpty() )
+		return pAnalyzer;
+
+	return new Analyzer_Patched_c ( pAnalyzer, tPatch, eType, tSettings );
+}
+
+} // namespace columnar
@@ -0,0 +1,44 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "accessor.h"
+
+namespace columnar
+{
+
+// in-memory updates of a fixed-width attribute; merged on the fly by iterators and analyzers
+class AttrPatch_c
+{
+public:
+	using Value_t = std::pair<uint32_t,int64_t>;
+
+	void	Set ( uint32_t tRowID, int64_t tValue );
+	bool	Get ( uint32_t tRowID, int64_t & tValue ) const;
+	bool	IsEmpty() const { return m_dValues.empty(); }
+
+	const std::vector<Value_t> & GetValues() const { return m_dValues; }
+
+private:
+	std::vector<Value_t>	m_dValues;	// sorted by rowid
+};
+
+// both take ownership of the wrapped iterator/analyzer
+Iterator_i *	CreatePatchedIterator ( Iterator_i * pIterator, const AttrPatch_c & tPatch );
+Analyzer_i *	CreatePatchedAnalyzer ( Analyzer_i * pAnalyzer, const AttrPatch_c & tPatch, common::AttrType_e eType, const common::Filter_t & tSettings );
+
+} // namespace columnar
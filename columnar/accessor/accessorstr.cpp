@@ -33,6 +33,7 @@ public:
 	template <bool PACK>
 	FORCE_INLINE Span_T<uint8_t> GetValue();
 	FORCE_INLINE int		GetValueLength() const { return (int)m_dValue.size(); }
+	size_t					GetAllocatedBytes() const { return m_dValue.capacity() + m_dValuePacked.capacity(); }
 
 private:
 	std::vector<uint8_t>	m_dValue;
@@ -77,6 +78,7 @@ public:
 	FORCE_INLINE void				ReadSubblock ( int iSubblockIdInBlock, int iSubblockValues, FileReader_c & tReader ) {}
 	FORCE_INLINE Span_T<uint64_t>	GetAllValueLengths() { return m_dLengths; }
 	FORCE_INLINE Span_T<Span_T<uint8_t>> & ReadAllSubblockValues ( int iSubblockIdInBlock, int iSubblockValues, FileReader_c & tReader );
+	size_t							GetAllocatedBytes() const { return m_dValue.capacity() + m_dLengths.GetAllocatedBytes() + m_dAllValues.GetAllocatedBytes() + m_dAllValuePtrs.GetAllocatedBytes(); }
 
 private:
 	int							m_iSubblockSize = 0;
@@ -192,6 +194,7 @@ public:
 	FORCE_INLINE int		GetTableValueLength ( int iId ) const		{ return m_dTableValueLengths[iId]; }
 	FORCE_INLINE Span_T<const uint8_t> GetTableValue ( int iId ) const	{ return Span_T<const uint8_t> ( m_dTableValues[iId].data(), m_dTableValues[iId].size() ); }
 	FORCE_INLINE Span_T<uint32_t> GetValueIndexes()						{ return m_tValuesRead; }
+	size_t					GetAllocatedBytes() const;
 
 private:
 	std::unique_ptr<IntCodec_i>			m_pCodec;
@@ -209,6 +212,16 @@ private:
 };
 
 
+size_t StoredBlock_StrTable_c::GetAllocatedBytes() const
+{
+	size_t tBytes = m_dTableValues.capacity()*sizeof(m_dTableValues[0]);
+	for ( const auto & i : m_dTableValues )
+		tBytes += i.capacity();
+
+	return tBytes + m_dTableValueLengths.GetAllocatedBytes() + m_dTmp.GetAllocatedBytes() + ( m_dValueIndexes.capacity() + m_dEncoded.capacity() )*sizeof(uint32_t);
+}
+
+
 StoredBlock_StrTable_c::StoredBlock_StrTable_c ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion, int iSubblockSize )
 	: m_pCodec ( CreateIntCodec ( sCodec32, sCodec64 ) ) 
 	, m_uVersion ( uVersion )
@@ -277,6 +290,7 @@ public:
 
 	FORCE_INLINE Span_T<uint64_t>	GetAllValueLengths() { return m_dLengths; }
 	FORCE_INLINE Span_T<Span_T<uint8_t>> & ReadAllSubblockValues ( int iSubblockId, FileReader_c & tReader );
+	size_t							GetAllocatedBytes() const;
 
 private:
 	std::unique_ptr<IntCodec_i>	m_pCodec;
@@ -298,6 +312,13 @@ private:
 };
 
 
+size_t StoredBlock_StrGeneric_c::GetAllocatedBytes() const
+{
+	return m_dTmp.GetAllocatedBytes() + m_dOffsets.GetAllocatedBytes() + m_dCumulativeLengths.GetAllocatedBytes() + m_dLengths.GetAllocatedBytes()
+		+ m_dValue.GetAllocatedBytes() + m_dAllValues.GetAllocatedBytes() + m_dAllValuePtrs.GetAllocatedBytes();
+}
+
+
 StoredBlock_StrGeneric_c::StoredBlock_StrGeneric_c ( const std::string & sCodec32, const std::string & sCodec64, uint32_t uVersion )
 	: m_pCodec ( CreateIntCodec ( sCodec32, sCodec64 ) ) 
 	, m_uVersion ( uVersion )
@@ -413,9 +434,13 @@ public:
 									Accessor_String_c ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader );
 
 	FORCE_INLINE void				SetCurBlock ( uint32_t uBlockId );
+	void							AddMemoryUsage ( MemoryUsage_t & tUsage ) const;
+	FORCE_INLINE int				GetPackingId() const	{ return to_underlying(m_ePacking); }
+	int64_t							GetBytesRead() const	{ return m_pReader->GetBytesRead(); }
 
 protected:
 	const AttributeHeader_i &		m_tHeader;
+	std::shared_ptr<const AttributeHeader_i>	m_pHeaderRef;	// keeps an evictable header alive
 	std::unique_ptr<FileReader_c>	m_pReader;
 	StrPacking_e					m_ePacking = StrPacking_e::CONSTLEN;
 
@@ -450,6 +475,7 @@ protected:
 Accessor_String_c::Accessor_String_c ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader )
 	: StoredBlockTraits_t ( tHeader.GetSettings().m_iSubblockSize )
 	, m_tHeader ( tHeader )
+	, m_pHeaderRef ( tHeader.weak_from_this().lock() )
 	, m_pReader ( pReader )
 	, m_tBlockConstLen ( tHeader.GetSettings().m_iSubblockSize )
 	, m_tBlockTable ( tHeader.GetSettings().m_sCompressionUINT32, tHeader.GetSettings().m_sCompressionUINT64, uVersion, tHeader.GetSettings().m_iSubblockSize )
@@ -459,6 +485,13 @@ Accessor_String_c::Accessor_String_c ( const AttributeHeader_i & tHeader, uint32
 }
 
 
+void Accessor_String_c::AddMemoryUsage ( MemoryUsage_t & tUsage ) const
+{
+	tUsage.Add ( MemCategory_e::READER_BUFFERS, m_pReader->GetAllocatedBytes() );
+	tUsage.Add ( MemCategory_e::DECODE_SCRATCH, m_tBlockConst.GetAllocatedBytes() + m_tBlockConstLen.GetAllocatedBytes() + m_tBlockTable.GetAllocatedBytes() + m_tBlockGeneric.GetAllocatedBytes() );
+}
+
+
 void Accessor_String_c::SetCurBlock ( uint32_t uBlockId )
 {
 	m_pReader->Seek ( m_tHeader.GetBlockOffset(uBlockId) );
@@ -529,8 +562,10 @@ public:
 	int			Get ( uint32_t tRowID, const uint8_t * & pData ) final;
 	uint8_t *	GetPacked ( uint32_t tRowID ) final;
 	int			GetLength ( uint32_t tRowID ) final;
+	int			GetFloatVec ( uint32_t tRowID, Span_T<float> & dValues ) final	{ assert ( 0 && "INTERNAL ERROR: requesting float vector from string iterator" ); return 0; }
 
 	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { BASE::m_tHeader.GetName(), "iterator" } ); }
+	void		GetMemoryUsage ( MemoryUsage_t & tUsage ) const final { BASE::AddMemoryUsage(tUsage); }
 
 private:
 	FORCE_INLINE void AdvanceTo ( uint32_t tRowID );
@@ -752,7 +787,7 @@ public:
 				Analyzer_String_T ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader, const Filter_t & tSettings );
 
 	bool		GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) final;
-	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan" } ); }
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final { dDesc.push_back ( { ACCESSOR::m_tHeader.GetName(), "ColumnarScan", ANALYZER::m_tStats } ); }
 
 private:
 	AnalyzerBlock_Str_Const_T<EQ>	m_tBlockConst;
@@ -109,10 +109,13 @@ public:
 
 	int64_t		GetNumProcessed() const final	{ return m_iNumProcessed; }
 	void		Setup ( SharedBlocks_c & pBlocks, uint32_t uTotalDocs ) final;
+	void		SetDeadRows ( const common::DeadRows_t & tDeadRows ) final { m_tDeadRows = tDeadRows; }
 	bool		HintRowID ( uint32_t tRowID ) final;
 
 	void		SetCutoff ( int iCutoff ) final	{ m_iRowsLeft = iCutoff; }
 	bool		WasCutoffHit() const final		{ return !m_iRowsLeft; }
+	void		GetStats ( common::IteratorStats_t & tStats ) const final { tStats = m_tStats; }
+	void		SetCollectTime ( bool bCollect ) final { m_bCollectTime = bCollect; }
 
 protected:
 	int			m_iNumProcessed = 0;
@@ -121,13 +124,19 @@ protected:
 	int			m_iCurBlockId = -1;
 	int			m_iTotalSubblocks = 0;
 	int			m_iRowsLeft = INT_MAX;
+	uint32_t	m_uTotalDocs = 0;
+	bool		m_bCollectTime = false;
 
+	common::DeadRows_t	m_tDeadRows;
 	std::vector<uint32_t> m_dCollected {0};
 	SharedBlocks_c		m_pMatchingSubblocks;
 
 	SubblockCalc_t		m_tSubblockCalc;
+	common::IteratorStats_t m_tStats;
 
 	FORCE_INLINE bool	MoveToSubblock ( int iSubblock );
+	FORCE_INLINE void	CountBlock ( int iPacking );
+	void				SkipDeadSubblocks();
 	virtual bool		MoveToBlock ( int iBlock ) = 0;
 
 	template <typename ACCESSOR, typename PROCESSSUBBLOCK>
@@ -144,12 +153,16 @@ template <bool HAVE_MATCHING_BLOCKS>
 Analyzer_T<HAVE_MATCHING_BLOCKS>::Analyzer_T ( int iSubblockSize )
 	: m_tSubblockCalc ( iSubblockSize )
 {
-	m_dCollected.resize ( iSubblockSize*2 );
+	// extra space for bitmap expansion that may write past the last rowid
+	const int EXPAND_GAP = 8;
+	m_dCollected.resize ( iSubblockSize*2 + EXPAND_GAP );
 }
 
 template <bool HAVE_MATCHING_BLOCKS>
 void Analyzer_T<HAVE_MATCHING_BLOCKS>::Setup ( SharedBlocks_c & pBlocks, uint32_t uTotalDocs )
 {
+	m_uTotalDocs = uTotalDocs;
+
 	if ( HAVE_MATCHING_BLOCKS )
 	{
 		m_pMatchingSubblocks = pBlocks;
@@ -158,6 +171,9 @@ void Analyzer_T<HAVE_MATCHING_BLOCKS>::Setup ( SharedBlocks_c & pBlocks, uint32_
 	else
 		m_iTotalSubblocks = ( uTotalDocs+m_tSubblockCalc.m_iSubblockSize-1 ) / m_tSubblockCalc.m_iSubblockSize;
 
+	if ( HAVE_MATCHING_BLOCKS )
+		m_tStats.m_iSubblocksMinMax = ( uTotalDocs+m_tSubblockCalc.m_iSubblockSize-1 ) / m_tSubblockCalc.m_iSubblockSize - m_iTotalSubblocks;
+
 	// reject everything? signal the end
 	if ( !MoveToSubblock(0) )
 		m_iCurSubblock = m_iTotalSubblocks;
@@ -167,8 +183,10 @@ template <bool HAVE_MATCHING_BLOCKS>
 bool Analyzer_T<HAVE_MATCHING_BLOCKS>::MoveToSubblock ( int iSubblock )
 {
 	m_iCurSubblock = iSubblock;
+	if ( m_tDeadRows.m_pBitmap )
+		SkipDeadSubblocks();
 
-	if ( iSubblock>=m_iTotalSubblocks )
+	if ( m_iCurSubblock>=m_iTotalSubblocks )
 		return false;
 
 	int iNextSubblockId;
@@ -195,6 +213,29 @@ bool Analyzer_T<HAVE_MATCHING_BLOCKS>::MoveToSubblock ( int iSubblock )
 	return true;
 }
 
+template <bool HAVE_MATCHING_BLOCKS>
+void Analyzer_T<HAVE_MATCHING_BLOCKS>::CountBlock ( int iPacking )
+{
+	m_tStats.m_iBlocks++;
+	m_tStats.CountPacking(iPacking);
+}
+
+template <bool HAVE_MATCHING_BLOCKS>
+void Analyzer_T<HAVE_MATCHING_BLOCKS>::SkipDeadSubblocks()
+{
+	while ( m_iCurSubblock<m_iTotalSubblocks )
+	{
+		int iSubblockId = HAVE_MATCHING_BLOCKS ? m_pMatchingSubblocks->GetBlock(m_iCurSubblock) : m_iCurSubblock;
+		uint32_t tStart = m_tSubblockCalc.SubblockId2RowId(iSubblockId);
+		uint32_t tEnd = std::min ( tStart + m_tSubblockCalc.m_iSubblockSize, m_uTotalDocs );
+		if ( !m_tDeadRows.AllDead ( tStart, tEnd ) )
+			return;
+
+		m_iCurSubblock++;
+		m_tStats.m_iSubblocksDead++;
+	}
+}
+
 template <bool HAVE_MATCHING_BLOCKS>
 bool Analyzer_T<HAVE_MATCHING_BLOCKS>::HintRowID ( uint32_t tRowID )
 {
@@ -218,6 +259,7 @@ bool Analyzer_T<HAVE_MATCHING_BLOCKS>::GetNextRowIdBlock ( ACCESSOR & tAccessor,
 	if ( m_iCurSubblock>=m_iTotalSubblocks )
 		return false;
 
+	int64_t iStartTime = m_bCollectTime ? util::GetTimeNs() : 0;
 	uint32_t * pRowIdStart = m_dCollected.data();
 	uint32_t * pRowID = pRowIdStart;
 	uint32_t * pRowIdMax = pRowIdStart + std::min ( m_iRowsLeft, tAccessor.m_iSubblockSize );
@@ -234,13 +276,23 @@ bool Analyzer_T<HAVE_MATCHING_BLOCKS>::GetNextRowIdBlock ( ACCESSOR & tAccessor,
 		else
 			iSubblockIdInBlock = tAccessor.GetSubblockIdInBlock ( m_iCurSubblock );
 
+		uint32_t * pSubblockStart = pRowID;
 		m_iNumProcessed += fnProcessSubblock ( pRowID, iSubblockIdInBlock );
+		m_tStats.m_iSubblocks++;
+		if ( m_tDeadRows.m_pBitmap )
+			pRowID = m_tDeadRows.RemoveDead ( pSubblockStart, pRowID );
 
 		if ( !MoveToSubblock ( m_iCurSubblock+1 ) )
 			break;
 	}
 
 	m_iRowsLeft = std::max ( m_iRowsLeft - int(pRowID-pRowIdStart), 0 );
+
+	m_tStats.m_iRowsEmitted += pRowID-pRowIdStart;
+	m_tStats.m_iBytesRead = tAccessor.GetBytesRead();
+	if ( m_bCollectTime )
+		m_tStats.m_iTimeNs += util::GetTimeNs()-iStartTime;
+
 	return CheckEmptySpan ( pRowID, pRowIdStart, dRowIdBlock );
 }
 
@@ -250,12 +302,16 @@ void Analyzer_T<HAVE_MATCHING_BLOCKS>::StartBlockProcessing ( ACCESSOR & tAccess
 {
 	m_iCurBlockId = iNextBlock;
 	tAccessor.SetCurBlock ( m_iCurBlockId );
+	CountBlock ( tAccessor.GetPackingId() );
 }
 
 template <bool HAVE_MATCHING_BLOCKS>
 template <typename ACCESSOR>
 bool Analyzer_T<HAVE_MATCHING_BLOCKS>::RewindToNextBlock ( ACCESSOR & tAccessor, int & iNextBlock )
 {
+	// only called when the current block was rejected by its header
+	m_tStats.m_iBlocksSkipped++;
+
 	if ( !HAVE_MATCHING_BLOCKS )
 	{
 		iNextBlock = m_iCurBlockId+1;
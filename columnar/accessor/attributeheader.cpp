@@ -35,9 +35,11 @@ public:
 	inline int			GetNumLevels() const					{ return (int)m_dTreeLevels.size(); }
 	inline int			GetNumBlocks ( int iLevel ) const		{ return m_dTreeLevels[iLevel].first; }
 	inline Element_t	Get ( int iLevel, int iBlock ) const	{ return m_dTreeLevels[iLevel].second[iBlock]; }
+	void				Widen ( int iLeaf, T tValue );
+	size_t				GetAllocatedBytes() const;
 
-	bool				Load ( FileReader_c & tReader, std::string & sError );
-	bool				Check ( FileReader_c & tReader, Reporter_fn & fnError );
+	bool				Load ( FileReader_c & tReader, bool bMapped, const uint8_t * pMappedFile, std::string & sError );
+	bool				Check ( FileReader_c & tReader, bool bMapped, Reporter_fn & fnError );
 
 private:
 	using TreeLevel_t = std::pair<int,Element_t*>;
@@ -47,38 +49,40 @@ private:
 	Span_T<TreeLevel_t>				m_dTreeLevels;
 
 	void				LoadTreeLevels ( FileReader_c & tReader );
+	bool				LoadMappedTree ( FileReader_c & tReader, const uint8_t * pMappedFile, std::string & sError );
+	void				SetupTreeLevels();
 };
 
 
 template <typename T>
-bool MinMax_T<T>::Load ( FileReader_c & tReader, std::string & sError )
+bool MinMax_T<T>::Load ( FileReader_c & tReader, bool bMapped, const uint8_t * pMappedFile, std::string & sError )
 {
-	int iTreeLevels = tReader.Unpack_uint32();
+	int iTreeLevels = bMapped ? tReader.Read_uint32() : tReader.Unpack_uint32();
 	m_pTreeLevels = std::unique_ptr<TreeLevel_t[]> ( new TreeLevel_t[iTreeLevels] );
 	m_dTreeLevels = Span_T<TreeLevel_t>( m_pTreeLevels.get(), iTreeLevels );
 
 	int iTreeElements = 0;
 	for ( auto & i : m_dTreeLevels )
 	{
-		i.first = tReader.Unpack_uint32();
+		i.first = bMapped ? tReader.Read_uint32() : tReader.Unpack_uint32();
 		iTreeElements += i.first;
 	}
 
-	m_pMinMaxTree = std::unique_ptr<Element_t[]> ( new Element_t[iTreeElements] );
-	m_dMinMaxTree = Span_T<Element_t> ( m_pMinMaxTree.get(), iTreeElements );
-
-	LoadTreeLevels(tReader);
-
-	if ( iTreeElements )
+	if ( bMapped )
 	{
-		int iCumulativeBlocks = 0;
-		for ( auto & i : m_dTreeLevels )
-		{
-			i.second = &m_dMinMaxTree[iCumulativeBlocks];
-			iCumulativeBlocks += i.first;
-		}
+		m_dMinMaxTree = Span_T<Element_t> ( nullptr, iTreeElements );
+		if ( !LoadMappedTree ( tReader, pMappedFile, sError ) )
+			return false;
+	}
+	else
+	{
+		m_pMinMaxTree = std::unique_ptr<Element_t[]> ( new Element_t[iTreeElements] );
+		m_dMinMaxTree = Span_T<Element_t> ( m_pMinMaxTree.get(), iTreeElements );
+		LoadTreeLevels(tReader);
 	}
 
+	SetupTreeLevels();
+
 	if ( tReader.IsError() )
 	{
 		sError = tReader.GetError();
@@ -89,16 +93,101 @@ bool MinMax_T<T>::Load ( FileReader_c & tReader, std::string & sError )
 }
 
 template <typename T>
-bool MinMax_T<T>::Check ( FileReader_c & tReader, Reporter_fn & fnError )
+bool MinMax_T<T>::LoadMappedTree ( FileReader_c & tReader, const uint8_t * pMappedFile, std::string & sError )
+{
+	static_assert ( sizeof(Element_t)==2*sizeof(T), "mapped minmax pairs must have no padding" );
+
+	int64_t iTreeOffset = AlignMapped ( tReader.GetPos() );
+	size_t tTreeSize = m_dMinMaxTree.size()*sizeof(Element_t);
+
+	// without a mapping (merge, checks) the tree is read to memory
+	if ( pMappedFile )
+	{
+		int64_t iFileSize = tReader.GetFileSize();
+		if ( iTreeOffset>iFileSize || tTreeSize>uint64_t ( iFileSize-iTreeOffset ) )
+		{
+			sError = "minmax tree is out of file bounds";
+			return false;
+		}
+
+		m_dMinMaxTree = Span_T<Element_t> ( (Element_t*)( pMappedFile + iTreeOffset ), m_dMinMaxTree.size() );
+	}
+	else
+	{
+		m_pMinMaxTree = std::unique_ptr<Element_t[]> ( new Element_t[m_dMinMaxTree.size()] );
+		m_dMinMaxTree = Span_T<Element_t> ( m_pMinMaxTree.get(), m_dMinMaxTree.size() );
+		tReader.Seek(iTreeOffset);
+		tReader.Read ( (uint8_t*)m_dMinMaxTree.data(), tTreeSize );
+	}
+
+	tReader.Seek ( iTreeOffset + (int64_t)tTreeSize );
+	return true;
+}
+
+template <typename T>
+void MinMax_T<T>::SetupTreeLevels()
+{
+	if ( m_dMinMaxTree.empty() )
+		return;
+
+	int iCumulativeBlocks = 0;
+	for ( auto & i : m_dTreeLevels )
+	{
+		i.second = &m_dMinMaxTree[iCumulativeBlocks];
+		iCumulativeBlocks += i.first;
+	}
+}
+
+template <typename T>
+size_t MinMax_T<T>::GetAllocatedBytes() const
+{
+	size_t tBytes = m_dTreeLevels.size()*sizeof(TreeLevel_t);
+	if ( m_pMinMaxTree )
+		tBytes += m_dMinMaxTree.size()*sizeof(Element_t);
+
+	return tBytes;
+}
+
+template <typename T>
+void MinMax_T<T>::Widen ( int iLeaf, T tValue )
+{
+	// a mapped tree is read-only; updates go to a private copy
+	if ( !m_pMinMaxTree && !m_dMinMaxTree.empty() )
+	{
+		m_pMinMaxTree = std::unique_ptr<Element_t[]> ( new Element_t[m_dMinMaxTree.size()] );
+		std::copy ( m_dMinMaxTree.begin(), m_dMinMaxTree.end(), m_pMinMaxTree.get() );
+		m_dMinMaxTree = Span_T<Element_t> ( m_pMinMaxTree.get(), m_dMinMaxTree.size() );
+		SetupTreeLevels();
+	}
+
+	// the last level holds the leaves; every level above merges pairs of blocks
+	for ( int iLevel = GetNumLevels()-1; iLevel>=0; iLevel-- )
+	{
+		Element_t & tMinMax = m_dTreeLevels[iLevel].second[iLeaf];
+		tMinMax.first = std::min ( tMinMax.first, tValue );
+		tMinMax.second = std::max ( tMinMax.second, tValue );
+		iLeaf >>= 1;
+	}
+}
+
+template <typename T>
+bool MinMax_T<T>::Check ( FileReader_c & tReader, bool bMapped, Reporter_fn & fnError )
 {
 	int iTreeLevels = 0;
-	if ( !CheckInt32Packed ( tReader, 0, 128, "Number of minmax tree levels", iTreeLevels, fnError ) ) return false;
+	if ( bMapped )
+	{
+		if ( !CheckInt32 ( tReader, 0, 128, "Number of minmax tree levels", iTreeLevels, fnError ) ) return false;
+	}
+	else
+	{
+		if ( !CheckInt32Packed ( tReader, 0, 128, "Number of minmax tree levels", iTreeLevels, fnError ) ) return false;
+	}
 
 	int iTotalElements = 0;
 	int iLastElements = 0;
 	for ( int i = 0; i < iTreeLevels; i++ )
 	{
-		int iElementsOnLevel = (int)tReader.Unpack_uint32();
+		int iElementsOnLevel = bMapped ? (int)tReader.Read_uint32() : (int)tReader.Unpack_uint32();
 		if ( iElementsOnLevel < iLastElements )
 		{
 			fnError ( "Decreasing number of elements on minmax tree levels" );
@@ -109,6 +198,19 @@ bool MinMax_T<T>::Check ( FileReader_c & tReader, Reporter_fn & fnError )
 		iTotalElements += iElementsOnLevel;
 	}
 
+	if ( bMapped )
+	{
+		int64_t iTreeEnd = AlignMapped ( tReader.GetPos() ) + int64_t(iTotalElements)*sizeof(Element_t);
+		if ( iTreeEnd>tReader.GetFileSize() )
+		{
+			fnError ( FormatStr ( "Minmax tree ends beyond EOF: %lld", iTreeEnd ).c_str() );
+			return false;
+		}
+
+		tReader.Seek(iTreeEnd);
+		return true;
+	}
+
 	// fixme: maybe add minmax tree verification (opposite of construction process)
 	for ( int i = 0; i < iTotalElements; i++ )
 	{
@@ -158,7 +260,7 @@ void MinMax_T<float>::LoadTreeLevels ( FileReader_c & tReader )
 class AttributeHeader_c : public AttributeHeader_i, public Settings_t
 {
 public:
-							AttributeHeader_c ( AttrType_e eType, uint32_t uTotalDocs );
+							AttributeHeader_c ( AttrType_e eType, uint32_t uTotalDocs, bool bMapped, const uint8_t * pMappedFile );
 
 	const std::string &		GetName() const override			{ return m_sName; }
 	AttrType_e				GetType() const override			{ return m_eType; }
@@ -173,9 +275,15 @@ public:
 	int						GetNumMinMaxLevels() const override	{ return 0; }
 	int						GetNumMinMaxBlocks ( int iLevel ) const override { return 0; }
 	std::pair<int64_t,int64_t> GetMinMax ( int iLevel, int iBlock ) const override { return {0, 0}; }
+	void					WidenMinMax ( uint32_t tRowID, int64_t tValue ) override {}
 
 	bool					Load ( FileReader_c & tReader, std::string & sError ) override;
 	bool					Check ( FileReader_c & tReader, Reporter_fn & fnError ) override;
+	void					AddMemoryUsage ( MemoryUsage_t & tUsage ) const override;
+
+protected:
+	bool					m_bMapped = false;
+	const uint8_t *			m_pMappedFile = nullptr;
 
 private:
 	std::string				m_sName;
@@ -184,16 +292,22 @@ private:
 	uint32_t				m_uTotalDocs = 0;
 	Settings_t				m_tSettings;
 
-	std::vector<uint64_t>	m_dBlocks;
+	std::vector<uint64_t>	m_dBlockStorage;
+	Span_T<const uint64_t>	m_dBlocks;		// points either to m_dBlockStorage or to the mapped file
 	std::vector<uint32_t>	m_dPackings;
 
+	bool					LoadMappedBlocks ( FileReader_c & tReader, std::string & sError );
+	bool					CheckMappedBlocks ( FileReader_c & tReader, Reporter_fn & fnError );
+
 	float					CalcComplexity() const;
 	float					CalcIntComplexity() const;
 };
 
 
-AttributeHeader_c::AttributeHeader_c ( AttrType_e eType, uint32_t uTotalDocs )
-	: m_eType ( eType )
+AttributeHeader_c::AttributeHeader_c ( AttrType_e eType, uint32_t uTotalDocs, bool bMapped, const uint8_t * pMappedFile )
+	: m_bMapped ( bMapped )
+	, m_pMappedFile ( pMappedFile )
+	, m_eType ( eType )
 	, m_uTotalDocs ( uTotalDocs )
 {}
 
@@ -213,21 +327,32 @@ uint32_t AttributeHeader_c::GetNumDocs ( int iBlock ) const
 bool AttributeHeader_c::Load ( FileReader_c & tReader, std::string & sError )
 {
 	m_tSettings.Load(tReader);
+	m_tSettings.m_bMappedHeader = m_bMapped;
 
 	m_sName = tReader.Read_string();
-	uint64_t uOffset = tReader.Read_uint64();
+	if ( m_bMapped )
+	{
+		if ( !LoadMappedBlocks ( tReader, sError ) )
+			return false;
+	}
+	else
+	{
+		uint64_t uOffset = tReader.Read_uint64();
 
-	m_dBlocks.resize ( tReader.Unpack_uint32() );
+		m_dBlockStorage.resize ( tReader.Unpack_uint32() );
 
-	if ( !m_dBlocks.empty() )
-		m_dBlocks[0] = uOffset;
+		if ( !m_dBlockStorage.empty() )
+			m_dBlockStorage[0] = uOffset;
 
-	for ( size_t i=1; i < m_dBlocks.size(); i++ )
-		m_dBlocks[i] = tReader.Unpack_uint64() + m_dBlocks[i-1];
+		for ( size_t i=1; i < m_dBlockStorage.size(); i++ )
+			m_dBlockStorage[i] = tReader.Unpack_uint64() + m_dBlockStorage[i-1];
 
-	m_dPackings.resize ( tReader.Unpack_uint32() );
-	for ( auto & i : m_dPackings )
-		i = tReader.Unpack_uint32();
+		m_dBlocks = Span_T<const uint64_t> ( m_dBlockStorage.data(), m_dBlockStorage.size() );
+
+		m_dPackings.resize ( tReader.Unpack_uint32() );
+		for ( auto & i : m_dPackings )
+			i = tReader.Unpack_uint32();
+	}
 
 	m_fComplexity = CalcComplexity();
 
@@ -241,6 +366,56 @@ bool AttributeHeader_c::Load ( FileReader_c & tReader, std::string & sError )
 }
 
 
+bool AttributeHeader_c::LoadMappedBlocks ( FileReader_c & tReader, std::string & sError )
+{
+	size_t tNumBlocks = tReader.Read_uint32();
+	m_dPackings.resize ( tReader.Read_uint32() );
+	for ( auto & i : m_dPackings )
+		i = tReader.Read_uint32();
+
+	int64_t iOffsetsStart = AlignMapped ( tReader.GetPos() );
+	if ( m_pMappedFile )
+	{
+		int64_t iFileSize = tReader.GetFileSize();
+		if ( iOffsetsStart>iFileSize || tNumBlocks*sizeof(uint64_t)>uint64_t ( iFileSize-iOffsetsStart ) )
+		{
+			sError = "block offsets are out of file bounds";
+			return false;
+		}
+
+		m_dBlocks = Span_T<const uint64_t> ( (const uint64_t*)( m_pMappedFile + iOffsetsStart ), tNumBlocks );
+	}
+	else
+	{
+		m_dBlockStorage.resize(tNumBlocks);
+		tReader.Seek(iOffsetsStart);
+		tReader.Read ( (uint8_t*)m_dBlockStorage.data(), tNumBlocks*sizeof(uint64_t) );
+		m_dBlocks = Span_T<const uint64_t> ( m_dBlockStorage.data(), m_dBlockStorage.size() );
+	}
+
+	tReader.Seek ( iOffsetsStart + int64_t ( tNumBlocks*sizeof(uint64_t) ) );
+	return true;
+}
+
+
+bool AttributeHeader_c::CheckMappedBlocks ( FileReader_c & tReader, Reporter_fn & fnError )
+{
+	int iBlocks = 0;
+	int iNumPackings = 0;
+	if ( !CheckInt32 ( tReader, 0, int ( m_uTotalDocs/65536 )+1, "Number of blocks", iBlocks, fnError ) ) return false;
+	if ( !CheckInt32 ( tReader, 0, 256, "Number of packing stats", iNumPackings, fnError ) ) return false;
+	for ( int i = 0; i < iNumPackings; i++ )
+		if ( !CheckInt32 ( tReader, 0, iBlocks, "Packing stats", fnError ) ) return false;
+
+	int64_t iFileSize = tReader.GetFileSize();
+	tReader.Seek ( AlignMapped ( tReader.GetPos() ) );
+	for ( int i = 0; i < iBlocks; i++ )
+		if ( !CheckInt64 ( tReader, 0, iFileSize, "Block offset", fnError ) ) return false;
+
+	return true;
+}
+
+
 bool AttributeHeader_c::Check ( FileReader_c & tReader, Reporter_fn & fnError )
 {
 	int iBlocks = 0;
@@ -248,6 +423,9 @@ bool AttributeHeader_c::Check ( FileReader_c & tReader, Reporter_fn & fnError )
 	int64_t iFileSize = tReader.GetFileSize();
 	if ( !m_tSettings.Check ( tReader, fnError ) ) return false;
 	if ( !CheckString ( tReader, 0, 1024, "Attribute name", fnError ) ) return false;
+	if ( m_bMapped )
+		return CheckMappedBlocks ( tReader, fnError );
+
 	if ( !CheckInt64 ( tReader, 0, iFileSize, "Header offset", iOffset, fnError ) ) return false;
 	if ( !CheckInt32Packed ( tReader, 0, int ( m_uTotalDocs/65536 )+1, "Number of blocks", iBlocks, fnError ) ) return false;
 
@@ -271,6 +449,16 @@ bool AttributeHeader_c::Check ( FileReader_c & tReader, Reporter_fn & fnError )
 }
 
 
+void AttributeHeader_c::AddMemoryUsage ( MemoryUsage_t & tUsage ) const
+{
+	size_t tHeader = sizeof(*this) + m_sName.capacity() + m_tSettings.m_sCompressionUINT32.capacity() + m_tSettings.m_sCompressionUINT64.capacity();
+	tHeader += m_dPackings.capacity()*sizeof(m_dPackings[0]);
+
+	tUsage.Add ( MemCategory_e::HEADERS, tHeader );
+	tUsage.Add ( MemCategory_e::BLOCK_OFFSETS, m_dBlockStorage.capacity()*sizeof(m_dBlockStorage[0]) );
+}
+
+
 float AttributeHeader_c::CalcIntComplexity() const
 {
 	static const float dPackingComplexity[] =
@@ -322,10 +510,17 @@ public:
 	int				GetNumMinMaxLevels() const override					{ return m_tMinMax.GetNumLevels(); }
 	int				GetNumMinMaxBlocks ( int iLevel ) const override	{ return m_tMinMax.GetNumBlocks(iLevel); }
 	std::pair<int64_t,int64_t> GetMinMax ( int iLevel, int iBlock ) const override;
+	void			WidenMinMax ( uint32_t tRowID, int64_t tValue ) override;
 
 	bool			Load ( FileReader_c & tReader, std::string & sError ) override;
 	bool			Check ( FileReader_c & tReader, Reporter_fn & fnError ) override;
 
+	void			AddMemoryUsage ( MemoryUsage_t & tUsage ) const override
+	{
+		BASE::AddMemoryUsage(tUsage);
+		tUsage.Add ( MemCategory_e::MINMAX, m_tMinMax.GetAllocatedBytes() );
+	}
+
 private:
 	MinMax_T<T>		m_tMinMax;
 };
@@ -338,7 +533,7 @@ bool AttributeHeader_Int_T<T>::Load ( FileReader_c & tReader, std::string & sErr
 
 	bool bHaveMinMax = !!tReader.Read_uint8();
 	if ( bHaveMinMax )
-		return m_tMinMax.Load ( tReader, sError );
+		return m_tMinMax.Load ( tReader, BASE::m_bMapped, BASE::m_pMappedFile, sError );
 
 	return !tReader.IsError();
 }
@@ -354,7 +549,7 @@ bool AttributeHeader_Int_T<T>::Check ( FileReader_c & tReader, Reporter_fn & fnE
 		return false;
 
 	if ( uFlag )
-		return m_tMinMax.Check ( tReader, fnError );
+		return m_tMinMax.Check ( tReader, BASE::m_bMapped, fnError );
 
 	return true;
 }
@@ -373,37 +568,52 @@ std::pair<int64_t,int64_t> AttributeHeader_Int_T<float>::GetMinMax ( int iLevel,
 	return { FloatToUint ( tMinMax.first ), FloatToUint ( tMinMax.second ) };
 }
 
+template <typename T>
+void AttributeHeader_Int_T<T>::WidenMinMax ( uint32_t tRowID, int64_t tValue )
+{
+	m_tMinMax.Widen ( tRowID / BASE::GetSettings().m_iSubblockSize, (T)tValue );
+}
+
+template <>
+void AttributeHeader_Int_T<float>::WidenMinMax ( uint32_t tRowID, int64_t tValue )
+{
+	m_tMinMax.Widen ( tRowID / BASE::GetSettings().m_iSubblockSize, UintToFloat ( (uint32_t)tValue ) );
+}
+
 //////////////////////////////////////////////////////////////////////////
 
-AttributeHeader_i * CreateAttributeHeader ( AttrType_e eType, uint32_t uTotalDocs, std::string & sError )
+AttributeHeader_i * CreateAttributeHeader ( uint32_t uTypeWord, uint32_t uTotalDocs, const uint8_t * pMappedFile, std::string & sError )
 {
+	bool bMapped = !!( uTypeWord & MAPPED_HEADER_FLAG );
+	AttrType_e eType = AttrType_e ( uTypeWord & ~MAPPED_HEADER_FLAG );
+
 	switch ( eType )
 	{
 	case AttrType_e::UINT32:
 	case AttrType_e::TIMESTAMP:
-		return new AttributeHeader_Int_T<uint32_t> ( eType, uTotalDocs );
+		return new AttributeHeader_Int_T<uint32_t> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	case AttrType_e::INT64:
-		return new AttributeHeader_Int_T<int64_t> ( eType, uTotalDocs );
+		return new AttributeHeader_Int_T<int64_t> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	case AttrType_e::UINT64:
-		return new AttributeHeader_Int_T<uint64_t> ( eType, uTotalDocs );
+		return new AttributeHeader_Int_T<uint64_t> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	case AttrType_e::BOOLEAN:
-		return new AttributeHeader_Int_T<uint8_t> ( eType, uTotalDocs );
+		return new AttributeHeader_Int_T<uint8_t> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	case AttrType_e::FLOAT:
 	case AttrType_e::FLOATVEC:
-		return new AttributeHeader_Int_T<float> ( eType, uTotalDocs );
+		return new AttributeHeader_Int_T<float> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	case AttrType_e::STRING:
-		return new AttributeHeader_Int_T<uint32_t> (eType, uTotalDocs);
+		return new AttributeHeader_Int_T<uint32_t> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	case AttrType_e::UINT32SET:
-		return new AttributeHeader_Int_T<uint32_t> ( eType, uTotalDocs );
+		return new AttributeHeader_Int_T<uint32_t> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	case AttrType_e::INT64SET:
-		return new AttributeHeader_Int_T<int64_t> ( eType, uTotalDocs );
+		return new AttributeHeader_Int_T<int64_t> ( eType, uTotalDocs, bMapped, pMappedFile );
 
 	default:
 		sError = "unknown data type";
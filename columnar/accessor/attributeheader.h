@@ -17,6 +17,9 @@
 #pragma once
 
 #include "columnar.h"
+#include "common/memusage.h"
+
+#include <memory>
 
 namespace util
 {
@@ -28,7 +31,8 @@ namespace columnar
 
 struct Settings_t;
 
-class AttributeHeader_i
+// headers cached by Columnar_c are owned by shared_ptr; accessors take their own reference so that eviction can't free them
+class AttributeHeader_i : public std::enable_shared_from_this<AttributeHeader_i>
 {
 public:
 	virtual						~AttributeHeader_i() = default;
@@ -46,12 +50,16 @@ public:
 	virtual int					GetNumMinMaxLevels() const = 0;
 	virtual int					GetNumMinMaxBlocks ( int iLevel ) const = 0;
 	virtual std::pair<int64_t,int64_t> GetMinMax ( int iLevel, int iBlock ) const = 0;
+	virtual void				WidenMinMax ( uint32_t tRowID, int64_t tValue ) = 0;	// makes the minmax tree cover an updated value
 
 	virtual bool				Load ( util::FileReader_c & tReader, std::string & sError ) = 0;
 	virtual bool				Check ( util::FileReader_c & tReader, Reporter_fn & fnError ) = 0;
+
+	virtual void				AddMemoryUsage ( common::MemoryUsage_t & tUsage ) const = 0;	// heap only; mapped arrays are not counted
 };
 
 
-AttributeHeader_i * CreateAttributeHeader ( common::AttrType_e eType, uint32_t uTotalDocs, std::string & sError );
+// uTypeWord is the word that precedes every header; pMappedFile (optional) lets mapped headers point right into the file
+AttributeHeader_i * CreateAttributeHeader ( uint32_t uTypeWord, uint32_t uTotalDocs, const uint8_t * pMappedFile, std::string & sError );
 
 } // namespace columnar
@@ -78,8 +78,10 @@ private:
 	Reporter_fn &		m_fnProgress;
 	FileReader_c		m_tReader;
 	std::vector<std::unique_ptr<AttributeHeader_i>>	m_dHeaders;
+	std::vector<int64_t>	m_dHeaderOffsets;
 
 	bool				CheckHeaders ( int iNumAttrs );
+	bool				CheckDirectory();
 	Checker_i *			CreateChecker ( const AttributeHeader_i & tHeader ) const;
 };
 
@@ -109,9 +111,21 @@ bool StorageChecker_c::Check()
 	}
 
 	int iNumAttrs = (int)m_tReader.Read_uint32();
+	if ( iNumAttrs && uStorageVersion>=14 )
+	{
+		int64_t iHeadersOffset = 0;
+		if ( !CheckInt64 ( m_tReader, 0, m_tReader.GetFileSize(), "Headers offset", iHeadersOffset, m_fnError ) )
+			return false;
+
+		m_tReader.Seek(iHeadersOffset);
+	}
+
 	if ( iNumAttrs && !CheckHeaders(iNumAttrs) )
 		return false;
 
+	if ( iNumAttrs && uStorageVersion>=15 && !CheckDirectory() )
+		return false;
+
 	// headers are ok and loaded, time to run checks
 	for ( const auto & i : m_dHeaders )
 	{
@@ -168,11 +182,14 @@ Checker_i * StorageChecker_c::CreateChecker ( const AttributeHeader_i & tHeader
 bool StorageChecker_c::CheckHeaders ( int iNumAttrs )
 {
 	m_dHeaders.resize(iNumAttrs);
+	m_dHeaderOffsets.resize(iNumAttrs);
 	int64_t iFileSize = m_tReader.GetFileSize();
 
 	for ( size_t i = 0; i < m_dHeaders.size(); i++ )
 	{
-		AttrType_e eType = AttrType_e ( m_tReader.Read_uint32() );
+		m_dHeaderOffsets[i] = m_tReader.GetPos();
+		uint32_t uTypeWord = m_tReader.Read_uint32();
+		AttrType_e eType = AttrType_e ( uTypeWord & ~MAPPED_HEADER_FLAG );
 		if ( eType>=AttrType_e::TOTAL )
 		{
 			m_fnError ( FormatStr ( "Unknown attribute type in header: %u", to_underlying(eType) ).c_str() );
@@ -180,7 +197,7 @@ bool StorageChecker_c::CheckHeaders ( int iNumAttrs )
 		}
 
 		std::string sError;
-		std::unique_ptr<AttributeHeader_i> pHeader ( CreateAttributeHeader ( eType, m_uTotalDocs, sError ) );
+		std::unique_ptr<AttributeHeader_i> pHeader ( CreateAttributeHeader ( uTypeWord, m_uTotalDocs, nullptr, sError ) );
 		if ( !pHeader )
 		{
 			m_fnError ( sError.c_str() );
@@ -215,6 +232,33 @@ bool StorageChecker_c::CheckHeaders ( int iNumAttrs )
 	return true;
 }
 
+
+bool StorageChecker_c::CheckDirectory()
+{
+	int64_t iFileSize = m_tReader.GetFileSize();
+	m_tReader.Seek ( iFileSize - (int64_t)sizeof(uint64_t) );
+
+	int64_t iDirectoryOffset = 0;
+	if ( !CheckInt64 ( m_tReader, 0, iFileSize, "Header directory offset", iDirectoryOffset, m_fnError ) )
+		return false;
+
+	m_tReader.Seek(iDirectoryOffset);
+	for ( size_t i = 0; i < m_dHeaders.size(); i++ )
+	{
+		const auto & pHeader = m_dHeaders[i];
+		std::string sName = m_tReader.Read_string();
+		AttrType_e eType = AttrType_e ( m_tReader.Read_uint32() & ~MAPPED_HEADER_FLAG );
+		int64_t iOffset = (int64_t)m_tReader.Read_uint64();
+		if ( sName!=pHeader->GetName() || eType!=pHeader->GetType() || iOffset!=m_dHeaderOffsets[i] )
+		{
+			m_fnError ( FormatStr ( "Header directory entry %d does not match attribute '%s'", (int)i, pHeader->GetName().c_str() ).c_str() );
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /////////////////////////////////////////////////////////////////////
 
 bool CheckString ( FileReader_c & tReader, int iMinLength, int iMaxLength, const std::string & sMessage, Reporter_fn & fnError )
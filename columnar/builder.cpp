@@ -20,6 +20,7 @@
 #include "builderbool.h"
 #include "builderint.h"
 #include "buildermva.h"
+#include "threadpool.h"
 
 #include <memory>
 #include <algorithm>
@@ -31,36 +32,225 @@ using namespace util;
 using namespace common;
 
 
+// values of one attribute collected on the caller thread and later fed to its packers by a worker thread
+class AttrBatch_c
+{
+public:
+	void	Add ( int64_t tAttr );
+	void	Add ( const uint8_t * pData, int iLength );
+	void	Add ( const int64_t * pData, int iLength );
+	void	Add ( const Span_T<int64_t> & dValues );
+	void	Add ( const uint8_t * pData, const Span_T<int64_t> & dOffsets );
+	void	Add ( const int64_t * pData, const Span_T<int64_t> & dOffsets );
+
+	int		GetNumDocs() const { return m_iDocs; }
+	void	Replay ( std::vector<std::shared_ptr<Packer_i>> & dPackers );
+
+private:
+	enum class Kind_e
+	{
+		SCALAR,
+		STRING,
+		MVA
+	};
+
+	Kind_e					m_eKind = Kind_e::SCALAR;
+	int						m_iDocs = 0;
+	std::vector<int64_t>	m_dValues;
+	std::vector<uint8_t>	m_dBytes;
+	std::vector<int64_t>	m_dOffsets { 0 };
+
+	template <typename T>
+	void	AddRange ( std::vector<T> & dDst, const T * pData, const Span_T<int64_t> & dOffsets );
+};
+
+
+void AttrBatch_c::Add ( int64_t tAttr )
+{
+	m_eKind = Kind_e::SCALAR;
+	m_dValues.push_back(tAttr);
+	m_iDocs++;
+}
+
+
+void AttrBatch_c::Add ( const uint8_t * pData, int iLength )
+{
+	m_eKind = Kind_e::STRING;
+	m_dBytes.insert ( m_dBytes.end(), pData, pData+iLength );
+	m_dOffsets.push_back ( m_dBytes.size() );
+	m_iDocs++;
+}
+
+
+void AttrBatch_c::Add ( const int64_t * pData, int iLength )
+{
+	m_eKind = Kind_e::MVA;
+	m_dValues.insert ( m_dValues.end(), pData, pData+iLength );
+	m_dOffsets.push_back ( m_dValues.size() );
+	m_iDocs++;
+}
+
+
+void AttrBatch_c::Add ( const Span_T<int64_t> & dValues )
+{
+	m_eKind = Kind_e::SCALAR;
+	m_dValues.insert ( m_dValues.end(), dValues.begin(), dValues.end() );
+	m_iDocs += (int)dValues.size();
+}
+
+
+template <typename T>
+void AttrBatch_c::AddRange ( std::vector<T> & dDst, const T * pData, const Span_T<int64_t> & dOffsets )
+{
+	if ( dOffsets.size()<2 )
+		return;
+
+	// offsets are rebased to the start of our own buffer
+	int64_t iDelta = (int64_t)dDst.size() - dOffsets[0];
+	dDst.insert ( dDst.end(), pData + dOffsets[0], pData + dOffsets.back() );
+	for ( size_t i = 1; i < dOffsets.size(); i++ )
+		m_dOffsets.push_back ( dOffsets[i] + iDelta );
+
+	m_iDocs += int ( dOffsets.size()-1 );
+}
+
+
+void AttrBatch_c::Add ( const uint8_t * pData, const Span_T<int64_t> & dOffsets )
+{
+	m_eKind = Kind_e::STRING;
+	AddRange ( m_dBytes, pData, dOffsets );
+}
+
+
+void AttrBatch_c::Add ( const int64_t * pData, const Span_T<int64_t> & dOffsets )
+{
+	m_eKind = Kind_e::MVA;
+	AddRange ( m_dValues, pData, dOffsets );
+}
+
+
+void AttrBatch_c::Replay ( std::vector<std::shared_ptr<Packer_i>> & dPackers )
+{
+	for ( auto & pPacker : dPackers )
+		switch ( m_eKind )
+		{
+		case Kind_e::SCALAR:	pPacker->AddDocs ( Span_T<int64_t>(m_dValues) ); break;
+		case Kind_e::STRING:	pPacker->AddDocs ( m_dBytes.data(), Span_T<int64_t>(m_dOffsets) ); break;
+		case Kind_e::MVA:		pPacker->AddDocs ( m_dValues.data(), Span_T<int64_t>(m_dOffsets) ); break;
+		}
+
+	m_iDocs = 0;
+	m_dValues.resize(0);
+	m_dBytes.resize(0);
+	m_dOffsets.resize(1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 class Builder_c final : public Builder_i
 {
 public:
-	bool	Setup ( const Settings_t & tSettings, const Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, std::string & sError );
+	bool	Setup ( const Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, int iThreads, std::string & sError );
 	void	SetAttr ( int iAttr, int64_t tAttr ) final;
 	void	SetAttr ( int iAttr, const uint8_t * pData, int iLength ) final;
 	void	SetAttr ( int iAttr, const int64_t * pData, int iLength ) final;
+	void	SetColumn ( int iAttr, const Span_T<int64_t> & dValues ) final;
+	void	SetColumn ( int iAttr, const uint8_t * pData, const Span_T<int64_t> & dOffsets ) final;
+	void	SetColumn ( int iAttr, const int64_t * pData, const Span_T<int64_t> & dOffsets ) final;
 	bool	Done ( std::string & sError ) final;
 
 private:
+	// docs collected per attribute before the batch is handed over to the workers
+	static const int BATCH_DOCS = DOCS_PER_BLOCK/8;
+
 	std::string	m_sFile;
+	size_t		m_tBufferSize = 0;
+	FileWriterExtents_c	m_tBodyWriter;
 	std::vector<std::vector<std::shared_ptr<Packer_i>>> m_dPackers;
 	std::vector<std::shared_ptr<Packer_i>> m_dFlatPackers;
 
-	bool	WriteHeaders ( FileWriter_c & tWriter, std::string & sError );
-	bool	WriteBodies ( std::string & sError );
-	void	Cleanup();
+	// multi-threaded mode: one batch is being collected while the other one is being encoded
+	std::vector<AttrBatch_c>		m_dBatches[2];
+	int								m_iCollecting = 0;
+	int								m_iFullBatches = 0;
+	std::unique_ptr<ThreadPool_c>	m_pPool;	// declared last so that workers are stopped before batches and packers are destroyed
+
+	template <typename... ARGS>
+	FORCE_INLINE void	AddToBatch ( int iAttr, ARGS... tArgs );
+	void	SubmitBatches();
 };
 
 
-bool Builder_c::Setup ( const Settings_t & tSettings, const Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, std::string & sError )
+static bool CheckSubblockSize ( int iSubblockSize, std::string & sError )
 {
-	m_sFile = sFile;
+	const int MIN_SUBBLOCK_SIZE = 128;
+
+	if ( iSubblockSize < MIN_SUBBLOCK_SIZE )
+	{
+		sError = FormatStr ( "Subblock sizes less than %d are not supported (%d specified)", MIN_SUBBLOCK_SIZE, iSubblockSize );
+		return false;
+	}
+
+	if ( iSubblockSize > DOCS_PER_BLOCK )
+	{
+		sError = FormatStr ( "Subblock sizes greater than %d are not supported (%d specified)", DOCS_PER_BLOCK, iSubblockSize );
+		return false;
+	}
+
+	// subblock/rowid calculations in accessors are shift-based
+	if ( iSubblockSize & ( iSubblockSize-1 ) )
+	{
+		sError = FormatStr ( "Subblock size should be a power of 2 (%d specified)", iSubblockSize );
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool SetupAttrSettings ( const AttrWithSettings_t & tAttr, Settings_t & tSettings, std::string & sError )
+{
+	if ( tAttr.m_iSubblockSize )
+		tSettings.m_iSubblockSize = tAttr.m_iSubblockSize;
+
+	if ( !tAttr.m_sCompressionUINT32.empty() )
+		tSettings.m_sCompressionUINT32 = tAttr.m_sCompressionUINT32;
+
+	if ( !tAttr.m_sCompressionUINT64.empty() )
+		tSettings.m_sCompressionUINT64 = tAttr.m_sCompressionUINT64;
+
+	tSettings.m_bMappedHeader = tAttr.m_bMappedHeader;
+
+	std::string sAttrError;
+	if ( !CheckSubblockSize ( tSettings.m_iSubblockSize, sAttrError ) || !CheckIntCodec ( tSettings.m_sCompressionUINT32, tSettings.m_sCompressionUINT64, sAttrError ) )
+	{
+		sError = FormatStr ( "attribute '%s': %s", tAttr.m_sName.c_str(), sAttrError.c_str() );
+		return false;
+	}
 
-	int iPackers = 0;
+	if ( tAttr.m_eFloatVecStorage>=FloatVecStorage_e::TOTAL )
+	{
+		sError = FormatStr ( "attribute '%s': unknown float vector storage %u", tAttr.m_sName.c_str(), to_underlying ( tAttr.m_eFloatVecStorage ) );
+		return false;
+	}
+
+	return true;
+}
+
+
+bool Builder_c::Setup ( const Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, int iThreads, std::string & sError )
+{
+	m_sFile = sFile;
+	m_tBufferSize = tBufferSize;
 
 	for ( const auto & i : tSchema )
 	{
 		std::vector<std::shared_ptr<Packer_i>> dPackers;
 
+		Settings_t tSettings;
+		if ( !SetupAttrSettings ( i, tSettings, sError ) )
+			return false;
+
 		switch ( i.m_eType )
 		{
 		case AttrType_e::UINT32:
@@ -96,7 +286,7 @@ bool Builder_c::Setup ( const Settings_t & tSettings, const Schema_t & tSchema,
 			break;
 
 		case AttrType_e::FLOATVEC:
-			dPackers.push_back ( std::shared_ptr<Packer_i> ( CreatePackerFloatVec ( tSettings, i.m_sName ) ) );
+			dPackers.push_back ( std::shared_ptr<Packer_i> ( CreatePackerFloatVec ( tSettings, i.m_sName, i.m_eFloatVecStorage ) ) );
 			break;
 
 		default:
@@ -106,11 +296,7 @@ bool Builder_c::Setup ( const Settings_t & tSettings, const Schema_t & tSchema,
 		if ( !dPackers.empty() )
 		{
 			for ( auto & i : dPackers )
-			{
-				std::string sFilename = FormatStr ( "%s.%d", sFile.c_str(), iPackers++ );
-				if ( !i->Setup ( sFilename, tBufferSize, sError ) )
-					return false;
-			}
+				i->Setup(m_tBodyWriter);
 
 			m_dPackers.push_back ( std::move(dPackers) );
 		}
@@ -125,12 +311,62 @@ bool Builder_c::Setup ( const Settings_t & tSettings, const Schema_t & tSchema,
 		for ( auto & j : i )
 			m_dFlatPackers.push_back(j);
 
+	// open (and truncate) the output only once the whole schema is known to be storable
+	// blocks are appended right after [version][N][headers_offset]
+	if ( !m_tBodyWriter.Open ( sFile, sizeof(uint32_t)*2 + sizeof(uint64_t), sError ) )
+		return false;
+
+	if ( iThreads<=0 )
+		iThreads = ThreadPool_c::GetDefaultThreads();
+
+	// no point in running more threads than attributes
+	iThreads = std::min ( iThreads, (int)m_dPackers.size() );
+	if ( iThreads>1 )
+	{
+		m_pPool = std::make_unique<ThreadPool_c>(iThreads);
+		for ( auto & i : m_dBatches )
+			i.resize ( m_dPackers.size() );
+	}
+
 	return true;
 }
 
 
+template <typename... ARGS>
+void Builder_c::AddToBatch ( int iAttr, ARGS... tArgs )
+{
+	auto & tBatch = m_dBatches[m_iCollecting][iAttr];
+	bool bWasFull = tBatch.GetNumDocs()>=BATCH_DOCS;
+	tBatch.Add ( tArgs... );
+
+	// all attributes have a full batch (normally this happens on the last attribute of a row)
+	if ( !bWasFull && tBatch.GetNumDocs()>=BATCH_DOCS && ++m_iFullBatches==(int)m_dPackers.size() )
+		SubmitBatches();
+}
+
+
+void Builder_c::SubmitBatches()
+{
+	// packers are not thread-safe, so previous batches should be fully processed first
+	m_pPool->Wait();
+
+	auto & dBatches = m_dBatches[m_iCollecting];
+	for ( size_t i = 0; i < dBatches.size(); i++ )
+		m_pPool->Enqueue ( [this, &dBatches, i]{ dBatches[i].Replay ( m_dPackers[i] ); } );
+
+	m_iCollecting ^= 1;
+	m_iFullBatches = 0;
+}
+
+
 void Builder_c::SetAttr ( int iAttr, int64_t tAttr )
 {
+	if ( m_pPool )
+	{
+		AddToBatch ( iAttr, tAttr );
+		return;
+	}
+
 	for ( auto & i : m_dPackers[iAttr] )
 		i->AddDoc(tAttr);
 }
@@ -138,6 +374,12 @@ void Builder_c::SetAttr ( int iAttr, int64_t tAttr )
 
 void Builder_c::SetAttr ( int iAttr, const uint8_t * pData, int iLength )
 {
+	if ( m_pPool )
+	{
+		AddToBatch ( iAttr, pData, iLength );
+		return;
+	}
+
 	for ( auto & i : m_dPackers[iAttr] )
 		i->AddDoc ( pData, iLength );
 }
@@ -145,102 +387,83 @@ void Builder_c::SetAttr ( int iAttr, const uint8_t * pData, int iLength )
 
 void Builder_c::SetAttr ( int iAttr, const int64_t * pData, int iLength )
 {
+	if ( m_pPool )
+	{
+		AddToBatch ( iAttr, pData, iLength );
+		return;
+	}
+
 	for ( auto & i : m_dPackers[iAttr] )
 		i->AddDoc ( pData, iLength );
 }
 
 
-bool Builder_c::WriteHeaders ( FileWriter_c & tWriter, std::string & sError )
+void Builder_c::SetColumn ( int iAttr, const Span_T<int64_t> & dValues )
 {
-	tWriter.Write_uint32 ( STORAGE_VERSION );
-	tWriter.Write_uint32 ( (uint32_t)m_dFlatPackers.size() );
-	for ( size_t i=0; i < m_dFlatPackers.size(); i++ )
+	if ( m_pPool )
 	{
-		auto & pPacker = m_dFlatPackers[i];
-		if ( !pPacker->WriteHeader ( tWriter, sError ) )
-			return false;
-
-		int64_t tNextOffset = i<m_dFlatPackers.size()-1 ? tWriter.GetPos() : 0;
-		tWriter.Write_uint64 ( tNextOffset + sizeof(int64_t) );
+		AddToBatch ( iAttr, dValues );
+		return;
 	}
 
-	return true;
+	for ( auto & i : m_dPackers[iAttr] )
+		i->AddDocs(dValues);
 }
 
 
-bool Builder_c::WriteBodies ( std::string & sError )
+void Builder_c::SetColumn ( int iAttr, const uint8_t * pData, const Span_T<int64_t> & dOffsets )
 {
-	return std::all_of ( m_dFlatPackers.cbegin(), m_dFlatPackers.cend(), [this, &sError]( auto & i ){ return i->WriteBody ( m_sFile, sError ); } );
-}
-
+	if ( m_pPool )
+	{
+		AddToBatch ( iAttr, pData, dOffsets );
+		return;
+	}
 
-void Builder_c::Cleanup()
-{
-	std::for_each ( m_dFlatPackers.cbegin(), m_dFlatPackers.cend(), []( auto & i ){ return i->Cleanup(); } );
+	for ( auto & i : m_dPackers[iAttr] )
+		i->AddDocs ( pData, dOffsets );
 }
 
 
-bool Builder_c::Done ( std::string & sError )
+void Builder_c::SetColumn ( int iAttr, const int64_t * pData, const Span_T<int64_t> & dOffsets )
 {
-	std::for_each ( m_dFlatPackers.cbegin(), m_dFlatPackers.cend(), []( auto & i ){ i->Done(); } );
-
-	// [N][header0][offset_of_header1]...[body0]...
-
+	if ( m_pPool )
 	{
-		FileWriter_c tWriter;
-		if ( !tWriter.Open ( m_sFile, sError ) )
-			return false;
-
-		if ( !WriteHeaders ( tWriter, sError) )
-			return false;
-
-		int64_t tBodyOffset = tWriter.GetPos();
-		for ( auto & i : m_dFlatPackers )
-		{
-			i->CorrectOffset ( tWriter, tBodyOffset );
-			tBodyOffset += i->GetBodySize();
-		}
+		AddToBatch ( iAttr, pData, dOffsets );
+		return;
 	}
 
-	if ( !WriteBodies(sError) )
-		return false;
-
-	Cleanup();
-
-	return true;
+	for ( auto & i : m_dPackers[iAttr] )
+		i->AddDocs ( pData, dOffsets );
 }
 
 
-bool CheckSubblockSize ( int iSubblockSize, std::string & sError )
+bool Builder_c::Done ( std::string & sError )
 {
-	const int MIN_SUBBLOCK_SIZE = 128;
-
-	if ( iSubblockSize < MIN_SUBBLOCK_SIZE )
+	if ( m_pPool )
 	{
-		FormatStr ( "Subblock sizes less than %d are not supported (%d specified)", MIN_SUBBLOCK_SIZE, iSubblockSize );
-		return false;
-	}
+		// feed the leftovers and flush the last blocks in parallel
+		SubmitBatches();
+		m_pPool->Wait();
 
-	if ( iSubblockSize & ( MIN_SUBBLOCK_SIZE-1 ) )
-	{
-		FormatStr ( "Subblock size should be a multiple of %d (%d specified)", MIN_SUBBLOCK_SIZE, iSubblockSize );
-		return false;
+		for ( auto & i : m_dFlatPackers )
+			m_pPool->Enqueue ( [&i]{ i->Done(); } );
+
+		m_pPool->Wait();
+		m_pPool.reset();
 	}
+	else
+		std::for_each ( m_dFlatPackers.cbegin(), m_dFlatPackers.cend(), []( auto & i ){ i->Done(); } );
 
-	return true;
+	return WriteHeaders ( m_dFlatPackers, m_tBodyWriter, m_sFile, m_tBufferSize, sError );
 }
 
 } // namespace columnar
 
 
-columnar::Builder_i * CreateColumnarBuilder ( const columnar::Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, std::string & sError )
+columnar::Builder_i * CreateColumnarBuilder ( const columnar::Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, int iThreads, std::string & sError )
 {
-	columnar::Settings_t tSettings;
-	if ( !columnar::CheckSubblockSize ( tSettings.m_iSubblockSize, sError ) )
-		return nullptr;
-
 	std::unique_ptr<columnar::Builder_c> pBuilder ( new columnar::Builder_c );
-	if ( !pBuilder->Setup ( tSettings, tSchema, sFile, tBufferSize, sError ) )
+	if ( !pBuilder->Setup ( tSchema, sFile, tBufferSize, iThreads, sError ) )
 		return nullptr;
 
 	return pBuilder.release();
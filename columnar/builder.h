@@ -25,7 +25,33 @@
 namespace columnar
 {
 
-static const uint32_t STORAGE_VERSION = 12;
+static const uint32_t STORAGE_VERSION = 16;
+
+// element storage of FLOATVEC attributes
+enum class FloatVecStorage_e : uint32_t
+{
+	DEFAULT,		// float32, compressed like MVA values
+	FLOAT32,		// raw float32; fixed-length vectors are read without copying
+	FLOAT16,
+	BFLOAT16,
+	INT8_VECTOR,	// int8 with a scale per vector
+	INT8_BLOCK,		// int8 with a scale per block
+
+	TOTAL
+};
+
+// per-attribute encoding overrides; zero/empty values mean "use library defaults"
+struct EncodingSettings_t
+{
+	int					m_iSubblockSize = 0;
+	std::string			m_sCompressionUINT32;
+	std::string			m_sCompressionUINT64;
+	FloatVecStorage_e	m_eFloatVecStorage = FloatVecStorage_e::DEFAULT;
+	bool				m_bMappedHeader = false;	// fixed-width header arrays that are used straight from an mmap of the file
+};
+
+struct AttrWithSettings_t : public common::SchemaAttr_t, public EncodingSettings_t {};
+using Schema_t = std::vector<AttrWithSettings_t>;
 
 class Builder_i
 {
@@ -35,12 +61,60 @@ public:
 	virtual void	SetAttr ( int iAttr, int64_t tAttr ) = 0;
 	virtual void	SetAttr ( int iAttr, const uint8_t * pData, int iLength ) = 0;
 	virtual void	SetAttr ( int iAttr, const int64_t * pData, int iLength ) = 0;
+
+	// column chunks (Arrow-like); doc i of a string/MVA chunk spans [dOffsets[i], dOffsets[i+1]), so dOffsets holds docs+1 entries
+	// chunks of different attributes may differ in size, but with iThreads!=1 they are buffered until every attribute has enough docs
+	virtual void	SetColumn ( int iAttr, const util::Span_T<int64_t> & dValues ) = 0;
+	virtual void	SetColumn ( int iAttr, const uint8_t * pData, const util::Span_T<int64_t> & dOffsets ) = 0;
+	virtual void	SetColumn ( int iAttr, const int64_t * pData, const util::Span_T<int64_t> & dOffsets ) = 0;
+
 	virtual bool	Done ( std::string & sError ) = 0;
 };
 
+// one of the storages to merge; rows are renumbered in source order with dead rows removed
+struct MergeSource_t
+{
+	std::string				m_sFile;
+	uint32_t				m_uTotalDocs = 0;
+	std::vector<uint32_t>	m_dDeadRowIDs;	// sorted
+};
+
+// codec auto-tuning: sampled blocks of integer attributes are compressed with every available codec on this CPU
+struct CodecTuneSettings_t
+{
+	int		m_iSampleBlocks = 16;			// evenly spaced blocks sampled per attribute
+	int		m_iRounds = 5;					// timings are the best of this many runs
+	float	m_fMinDecodeSpeed = 0.5f;		// the codec with the best ratio is picked among those that decode at least this fraction as fast as the fastest one
+	bool	m_bApply = false;				// write recommended codecs to the schema
+};
+
+struct CodecStats_t
+{
+	std::string	m_sCodec;
+	int64_t		m_iUncompressedBytes = 0;
+	int64_t		m_iCompressedBytes = 0;
+	double		m_fEncodeMBs = 0.0;			// MB/s of uncompressed data
+	double		m_fDecodeMBs = 0.0;
+};
+
+struct CodecTuneResult_t
+{
+	std::string					m_sAttr;
+	bool						m_bUINT64 = false;	// whether m_sCompressionUINT64 or m_sCompressionUINT32 is tuned
+	std::vector<CodecStats_t>	m_dStats;
+	std::string					m_sRecommended;
+};
+
 } // namespace columnar
 
 extern "C"
 {
-	DLLEXPORT columnar::Builder_i * CreateColumnarBuilder ( const common::Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, std::string & sError );
+	// iThreads: 1 encodes on the caller thread; 0 uses all cores
+	DLLEXPORT columnar::Builder_i * CreateColumnarBuilder ( const columnar::Schema_t & tSchema, const std::string & sFile, size_t tBufferSize, int iThreads, std::string & sError );
+
+	// merges storages with identical schemas; whole blocks without dead rows are copied as is, everything else is re-encoded
+	DLLEXPORT bool MergeColumnarStorages ( const std::vector<columnar::MergeSource_t> & dSources, const std::string & sFile, size_t tBufferSize, int iThreads, std::string & sError );
+	// benchmarks codecs on the integer/float/MVA attributes of tSchema (others are skipped) using data from an existing storage
+	// with m_bApply, recommended codecs are written to tSchema so the next build (or rebuild) of the storage uses them
+	DLLEXPORT bool TuneColumnarCodecs ( const std::string & sFile, uint32_t uTotalDocs, columnar::Schema_t & tSchema, const columnar::CodecTuneSettings_t & tSettings, std::vector<columnar::CodecTuneResult_t> & dResults, std::string & sError );
 }
@@ -33,7 +33,8 @@ public:
 
 			AttributeHeaderBuilder_Bool_c ( const Settings_t & tSettings, const std::string & sName, AttrType_e eType );
 
-	bool	Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError );
+	bool	Save ( FileWriter_c & tWriter, std::string & sError );
+	void	AddMinMax ( const MinMaxVec_t & dSubblockMinMax ) { m_tMinMax.AddSubblocks(dSubblockMinMax); }
 };
 
 
@@ -43,9 +44,9 @@ AttributeHeaderBuilder_Bool_c::AttributeHeaderBuilder_Bool_c ( const Settings_t
 {}
 
 
-bool AttributeHeaderBuilder_Bool_c::Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError )
+bool AttributeHeaderBuilder_Bool_c::Save ( FileWriter_c & tWriter, std::string & sError )
 {
-	if ( !BASE::Save ( tWriter, tBaseOffset, sError ) )
+	if ( !BASE::Save ( tWriter, sError ) )
 		return false;
 
 	tWriter.Write_uint8(1); // minmax presence flag
@@ -173,8 +174,8 @@ void Packer_Bool_c::Flush()
 		return;
 
 	auto ePacking = ChoosePacking();
-	m_tHeader.AddBlock ( m_tWriter.GetPos(), to_underlying(ePacking) );
 	WriteToFile(ePacking);
+	WriteBlock ( to_underlying(ePacking) );
 
 	m_dCollected.resize(0);
 	m_bFirst = true;
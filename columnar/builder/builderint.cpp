@@ -18,7 +18,6 @@
 #include "buildertraits.h"
 #include "builderminmax.h"
 
-#include <unordered_map>
 #include <algorithm>
 
 namespace columnar
@@ -27,6 +26,75 @@ namespace columnar
 using namespace util;
 using namespace common;
 
+// open-addressing table for the (up to 256) unique values of a block; no allocations, no node hashing
+template <typename T>
+class UniqueTable_T
+{
+public:
+	static const int MAX_KEYS = 256;
+
+			UniqueTable_T() { Clear(); }
+
+	FORCE_INLINE bool	Add ( T tKey );
+	FORCE_INLINE int	GetOrdinal ( T tKey ) const;
+	FORCE_INLINE void	SetOrdinal ( T tKey, int iOrdinal );
+	void	Clear()								{ memset ( m_dSlots, 0, sizeof(m_dSlots) ); m_iKeys = 0; }
+	Span_T<const T>	GetKeys() const				{ return Span_T<const T> ( m_dKeys, m_iKeys ); }
+
+private:
+	static const int SLOT_BITS = 9;
+	static const int NUM_SLOTS = 1 << SLOT_BITS;	// load factor stays at or below 0.5
+
+	uint16_t	m_dSlots[NUM_SLOTS];	// 1-based key index; 0 means empty
+	T			m_dKeys[MAX_KEYS];
+	uint8_t		m_dOrdinals[MAX_KEYS];
+	int			m_iKeys = 0;
+
+	static FORCE_INLINE uint32_t Hash ( T tKey )	{ return uint32_t ( ( (uint64_t)tKey * 0x9E3779B97F4A7C15ULL ) >> ( 64-SLOT_BITS ) ); }
+	FORCE_INLINE int	FindSlot ( T tKey ) const;
+};
+
+template <typename T>
+int UniqueTable_T<T>::FindSlot ( T tKey ) const
+{
+	uint32_t uSlot = Hash(tKey);
+	while ( m_dSlots[uSlot] && m_dKeys[m_dSlots[uSlot]-1]!=tKey )
+		uSlot = ( uSlot+1 ) & ( NUM_SLOTS-1 );
+
+	return (int)uSlot;
+}
+
+template <typename T>
+bool UniqueTable_T<T>::Add ( T tKey )
+{
+	int iSlot = FindSlot(tKey);
+	if ( m_dSlots[iSlot] )
+		return false;
+
+	assert ( m_iKeys<MAX_KEYS );
+	m_dKeys[m_iKeys++] = tKey;
+	m_dSlots[iSlot] = (uint16_t)m_iKeys;
+	return true;
+}
+
+template <typename T>
+void UniqueTable_T<T>::SetOrdinal ( T tKey, int iOrdinal )
+{
+	int iSlot = FindSlot(tKey);
+	assert ( m_dSlots[iSlot] );
+	m_dOrdinals [ m_dSlots[iSlot]-1 ] = (uint8_t)iOrdinal;
+}
+
+template <typename T>
+int UniqueTable_T<T>::GetOrdinal ( T tKey ) const
+{
+	int iSlot = FindSlot(tKey);
+	assert ( m_dSlots[iSlot] );
+	return m_dOrdinals [ m_dSlots[iSlot]-1 ];
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 template <typename T>
 class AttributeHeaderBuilder_Int_T : public AttributeHeaderBuilder_c
 {
@@ -35,8 +103,10 @@ class AttributeHeaderBuilder_Int_T : public AttributeHeaderBuilder_c
 public:
 			AttributeHeaderBuilder_Int_T ( const Settings_t & tSettings, const std::string & sName, AttrType_e eType );
 
-	bool	Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError );
-	void	Add ( T tValue ) { m_tMinMax.Add(tValue); }
+	bool	Save ( FileWriter_c & tWriter, std::string & sError );
+	void	Add ( int64_t tValue ) { m_tMinMax.Add(tValue); }
+	void	AddDocs ( const int64_t * pValues, size_t tNumDocs ) { m_tMinMax.AddDocs ( pValues, tNumDocs ); }
+	void	AddMinMax ( const MinMaxVec_t & dSubblockMinMax ) { m_tMinMax.AddSubblocks(dSubblockMinMax); }
 
 protected:
 	MinMaxBuilder_T<T>	m_tMinMax;
@@ -49,9 +119,9 @@ AttributeHeaderBuilder_Int_T<T>::AttributeHeaderBuilder_Int_T ( const Settings_t
 {}
 
 template <typename T>
-bool AttributeHeaderBuilder_Int_T<T>::Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError )
+bool AttributeHeaderBuilder_Int_T<T>::Save ( FileWriter_c & tWriter, std::string & sError )
 {
-	if ( !BASE::Save ( tWriter, tBaseOffset, sError ) )
+	if ( !BASE::Save ( tWriter, sError ) )
 		return false;
 
 	tWriter.Write_uint8(1);	// means we have minmax
@@ -66,14 +136,16 @@ class AttributeHeaderBuilder_Hash_c : public AttributeHeaderBuilder_c
 	using BASE::BASE;
 
 public:
-	bool	Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError );
-	void	Add ( uint64_t tValue ) {}
+	bool	Save ( FileWriter_c & tWriter, std::string & sError );
+	void	Add ( int64_t tValue ) {}
+	void	AddDocs ( const int64_t * pValues, size_t tNumDocs ) {}
+	void	AddMinMax ( const MinMaxVec_t & dSubblockMinMax ) {}
 };
 
 
-bool AttributeHeaderBuilder_Hash_c::Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError )
+bool AttributeHeaderBuilder_Hash_c::Save ( FileWriter_c & tWriter, std::string & sError )
 {
-	if ( !BASE::Save ( tWriter, tBaseOffset, sError ) )
+	if ( !BASE::Save ( tWriter, sError ) )
 		return false;
 
 	tWriter.Write_uint8(0);	// no minmax
@@ -89,12 +161,14 @@ public:
 	using BASE = PackerTraits_T<HEADER>;
 	using BASE::m_tWriter;
 	using BASE::m_tHeader;
+	using BASE::AddDocs;
 
 						Packer_Int_T ( const Settings_t & tSettings, const std::string & sName, AttrType_e eType );
 
 	void				AddDoc ( int64_t tAttr ) override;
 	void				AddDoc ( const uint8_t * pData, int iLength ) override;
 	void				AddDoc ( const int64_t * pData, int iLength ) override;
+	void				AddDocs ( const Span_T<int64_t> & dValues ) override;
 	void				Flush() override;
 
 	void				OverridePacking ( IntPacking_e eSrc, IntPacking_e eDst );
@@ -104,7 +178,7 @@ private:
 	T						m_tMax = T(0);
 	T						m_tPrevValue = T(0);
 
-	std::unordered_map<T,int> m_hUnique { DOCS_PER_BLOCK };
+	UniqueTable_T<T>		m_hUnique;
 	std::vector<T>			m_dUniques;
 	int						m_iUniques = 0;
 	std::vector<uint32_t>	m_dTableIndexes;
@@ -125,6 +199,7 @@ private:
 	IntPacking_e			m_dPackingOverrides[to_underlying(IntPacking_e::TOTAL)];
 
 	void				AnalyzeCollected ( int64_t tAttr );
+	void				AnalyzeCollected ( const Span_T<T> & dValues );
 	IntPacking_e		ChoosePacking() const;
 	void				WriteToFile ( IntPacking_e ePacking );
 
@@ -151,6 +226,7 @@ Packer_Int_T<T,HEADER>::Packer_Int_T ( const Settings_t & tSettings, const std::
 {
 	assert ( !(tSettings.m_iSubblockSize & 127) );
 	m_dTableIndexes.resize ( tSettings.m_iSubblockSize );
+	m_dCollected.reserve(DOCS_PER_BLOCK);	// reused by all blocks
 
 	for ( auto i = to_underlying(IntPacking_e::CONST); i < to_underlying(IntPacking_e::TOTAL); i++ )
 		m_dPackingOverrides[i] = IntPacking_e(i);
@@ -178,6 +254,31 @@ void Packer_Int_T<T,HEADER>::AddDoc ( const int64_t * pData, int iLength )
 	assert ( 0 && "INTERNAL ERROR: sending MVA to integer packer" );
 }
 
+template <typename T, typename HEADER>
+void Packer_Int_T<T,HEADER>::AddDocs ( const Span_T<int64_t> & dValues )
+{
+	const int64_t * pValues = dValues.data();
+	size_t tLeft = dValues.size();
+	while ( tLeft )
+	{
+		if ( m_dCollected.size()==DOCS_PER_BLOCK )
+			Flush();
+
+		size_t tStart = m_dCollected.size();
+		size_t tToAdd = std::min ( tLeft, DOCS_PER_BLOCK-tStart );
+		m_dCollected.resize ( tStart+tToAdd );
+		T * pCollected = m_dCollected.data()+tStart;
+		for ( size_t i = 0; i < tToAdd; i++ )
+			pCollected[i] = (T)pValues[i];
+
+		AnalyzeCollected ( Span_T<T> ( pCollected, tToAdd ) );
+		BASE::m_tHeader.AddDocs ( pValues, tToAdd );
+
+		pValues += tToAdd;
+		tLeft -= tToAdd;
+	}
+}
+
 template <typename T, typename HEADER>
 void Packer_Int_T<T,HEADER>::AnalyzeCollected ( int64_t tAttr )
 {
@@ -198,17 +299,61 @@ void Packer_Int_T<T,HEADER>::AnalyzeCollected ( int64_t tAttr )
 	}
 
 	// if we've got over 256 uniques, no point in further checks
-	if ( m_iUniques<256 && !m_hUnique.count(tValue) )
-	{
-		m_hUnique.insert ( { tValue, 0 } );
+	if ( m_iUniques<256 && m_hUnique.Add(tValue) )
 		m_iUniques++;
-	}
 
-	BASE::m_tHeader.Add(tValue);
+	BASE::m_tHeader.Add(tAttr);
 
 	m_tPrevValue = tValue;
 }
 
+template <typename T, typename HEADER>
+void Packer_Int_T<T,HEADER>::AnalyzeCollected ( const Span_T<T> & dValues )
+{
+	assert ( !dValues.empty() );
+
+	// no branches in these loops, so they get vectorized
+	T tMin = dValues[0];
+	T tMax = dValues[0];
+	for ( auto i : dValues )
+	{
+		tMin = std::min ( tMin, i );
+		tMax = std::max ( tMax, i );
+	}
+
+	bool bMonoAsc = true;
+	bool bMonoDesc = true;
+	for ( size_t i = 1; i < dValues.size(); i++ )
+	{
+		bMonoAsc  &= dValues[i]>=dValues[i-1];
+		bMonoDesc &= dValues[i]<=dValues[i-1];
+	}
+
+	if ( !m_iUniques )
+	{
+		m_tMin = tMin;
+		m_tMax = tMax;
+	}
+	else
+	{
+		m_tMin = std::min ( m_tMin, tMin );
+		m_tMax = std::max ( m_tMax, tMax );
+
+		m_bMonoAsc  &= dValues[0]>=m_tPrevValue;
+		m_bMonoDesc &= dValues[0]<=m_tPrevValue;
+	}
+
+	m_bMonoAsc &= bMonoAsc;
+	m_bMonoDesc &= bMonoDesc;
+
+	// only probe the hash when the value changes; runs of equal values are common in columnar input
+	for ( size_t i = 0; i < dValues.size() && m_iUniques<256; i++ )
+		if ( ( !i || dValues[i]!=dValues[i-1] ) && m_hUnique.Add ( dValues[i] ) )
+			m_iUniques++;
+
+	m_tPrevValue = dValues.back();
+}
+
 template <typename T, typename HEADER>
 IntPacking_e Packer_Int_T<T,HEADER>::ChoosePacking() const
 {
@@ -270,11 +415,11 @@ void Packer_Int_T<T,HEADER>::Flush()
 		return;
 
 	auto ePacking = ChoosePacking();
-	m_tHeader.AddBlock ( m_tWriter.GetPos(), to_underlying(ePacking) );
 	WriteToFile ( ePacking );
+	BASE::WriteBlock ( to_underlying(ePacking) );
 
 	m_dCollected.resize(0);
-	m_hUnique.clear();
+	m_hUnique.Clear();
 	m_tPrevValue = 0;
 	m_iUniques = 0;
 	m_bMonoAsc = m_bMonoDesc = true;
@@ -297,23 +442,17 @@ void Packer_Int_T<T,HEADER>::WritePacked_Table()
 {
 	assert ( m_iUniques<256 );
 
-	m_dUniques.resize(0);
-	for ( const auto & i : m_hUnique )
-		m_dUniques.push_back ( i.first );
-
+	auto dKeys = m_hUnique.GetKeys();
+	m_dUniques.assign ( dKeys.begin(), dKeys.end() );
 	std::sort ( m_dUniques.begin(), m_dUniques.end() );
 
 	for ( size_t i = 0; i < m_dUniques.size(); i++ )
-	{
-		auto tFound = m_hUnique.find ( m_dUniques[i] );
-		assert ( tFound!=m_hUnique.end() );
-		tFound->second = (int)i;
-	}
+		m_hUnique.SetOrdinal ( m_dUniques[i], (int)i );
 
 	// write the table
 	m_tWriter.Write_uint8 ( (uint8_t)m_dUniques.size() );
 	WriteValues_Delta_PFOR ( Span_T<T>(m_dUniques), m_dUncompressed, m_dCompressed, m_tWriter, m_pCodec.get() );
-	WriteTableOrdinals ( m_dUniques, m_hUnique, m_dCollected, m_dTableIndexes, m_dTablePacked, m_tHeader.GetSettings().m_iSubblockSize, m_tWriter );
+	WriteTableOrdinals ( m_dUniques, [this]( T tValue ){ return m_hUnique.GetOrdinal(tValue); }, m_dCollected, m_dTableIndexes, m_dTablePacked, m_tHeader.GetSettings().m_iSubblockSize, m_tWriter );
 }
 
 template <typename T, typename HEADER>
@@ -450,11 +589,15 @@ class Packer_Hash_c : public Packer_Int_T<uint64_t,AttributeHeaderBuilder_Hash_c
 public:
 			Packer_Hash_c ( const Settings_t & tSettings, const std::string & sName, StringHash_fn fnCalcHash );
 
-	void	AddDoc ( int64_t tAttr ) override { assert ( 0 && "INTERNAL ERROR: sending int to string hash packer" ); }
+	using BASE::AddDocs;
+
+	void	AddDoc ( int64_t tAttr ) override { BASE::AddDoc(tAttr); }	// precomputed hash (e.g. when merging storages)
 	void	AddDoc ( const uint8_t * pData, int iLength ) override;
+	void	AddDocs ( const uint8_t * pData, const Span_T<int64_t> & dOffsets ) override;
 
 private:
-	StringHash_fn m_fnCalcHash = nullptr;
+	StringHash_fn			m_fnCalcHash = nullptr;
+	std::vector<int64_t>	m_dHashes;
 };
 
 
@@ -462,16 +605,33 @@ Packer_Hash_c::Packer_Hash_c ( const Settings_t & tSettings, const std::string &
 	: BASE ( tSettings, sName, AttrType_e::UINT64 )
 	, m_fnCalcHash ( fnCalcHash )
 {
-	assert(fnCalcHash);
 	OverridePacking ( IntPacking_e::GENERIC, IntPacking_e::HASH );
 }
 
 
 void Packer_Hash_c::AddDoc ( const uint8_t * pData, int iLength )
 {
+	assert(m_fnCalcHash);
 	BASE::AddDoc ( iLength ? m_fnCalcHash ( pData, iLength, STR_HASH_SEED ) : 0 );
 }
 
+
+void Packer_Hash_c::AddDocs ( const uint8_t * pData, const Span_T<int64_t> & dOffsets )
+{
+	if ( dOffsets.size()<2 )
+		return;
+
+	assert(m_fnCalcHash);
+	m_dHashes.resize ( dOffsets.size()-1 );
+	for ( size_t i = 0; i < m_dHashes.size(); i++ )
+	{
+		int iLength = int ( dOffsets[i+1]-dOffsets[i] );
+		m_dHashes[i] = iLength ? m_fnCalcHash ( pData + dOffsets[i], iLength, STR_HASH_SEED ) : 0;
+	}
+
+	BASE::AddDocs ( Span_T<int64_t>(m_dHashes) );
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 Packer_i * CreatePackerUint32 ( const Settings_t & tSettings, const std::string & sName )
@@ -29,6 +29,8 @@ public:
 
 	void		Add ( int64_t tValue );
 	void		Add ( const int64_t * pValues, int iNumValues );
+	void		AddDocs ( const int64_t * pValues, size_t tNumDocs );
+	void		AddSubblocks ( const MinMaxVec_t & dMinMax );
 	bool		Save ( util::FileWriter_c & tWriter, std::string & sError );
 
 private:
@@ -45,6 +47,7 @@ private:
 	void		BuildTree();
 
 	inline bool	SaveTreeLevels ( util::FileWriter_c & tWriter ) const;
+	bool		SaveMapped ( util::FileWriter_c & tWriter ) const;
 };
 
 template<typename T>
@@ -117,6 +120,51 @@ void MinMaxBuilder_T<T>::Add ( const int64_t * pValues, int iNumValues )
 	m_iCollected++;
 }
 
+template<typename T>
+void MinMaxBuilder_T<T>::AddDocs ( const int64_t * pValues, size_t tNumDocs )
+{
+	while ( tNumDocs )
+	{
+		if ( m_iCollected==m_tSettings.m_iSubblockSize )
+			Flush();
+
+		size_t tToAdd = std::min ( tNumDocs, size_t ( m_tSettings.m_iSubblockSize - m_iCollected ) );
+		T tMin = util::to_type<T>(pValues[0]);
+		T tMax = tMin;
+		for ( size_t i = 1; i < tToAdd; i++ )
+		{
+			T tConverted = util::to_type<T>(pValues[i]);
+			tMin = std::min ( tMin, tConverted );
+			tMax = std::max ( tMax, tConverted );
+		}
+
+		if ( !m_iCollected )
+		{
+			m_tMin = tMin;
+			m_tMax = tMax;
+		}
+		else
+		{
+			m_tMin = std::min ( m_tMin, tMin );
+			m_tMax = std::max ( m_tMax, tMax );
+		}
+
+		m_bHaveNonEmpty = true;
+		m_iCollected += (int)tToAdd;
+		pValues += tToAdd;
+		tNumDocs -= tToAdd;
+	}
+}
+
+template<typename T>
+void MinMaxBuilder_T<T>::AddSubblocks ( const MinMaxVec_t & dMinMax )
+{
+	// whole subblocks only; any pending subblock must be complete at this point
+	Flush();
+	for ( const auto & i : dMinMax )
+		m_dTreeLevels[0].push_back ( { util::to_type<T>(i.first), util::to_type<T>(i.second) } );
+}
+
 template<typename T>
 void MinMaxBuilder_T<T>::Flush()
 {
@@ -169,6 +217,9 @@ bool MinMaxBuilder_T<T>::Save ( util::FileWriter_c & tWriter, std::string & sErr
 	Flush();
 	BuildTree();
 
+	if ( m_tSettings.m_bMappedHeader )
+		return SaveMapped(tWriter);
+
 	// now save the tree
 	tWriter.Pack_uint32 ( (uint32_t)m_dTreeLevels.size() );
 	for ( int i = (int)m_dTreeLevels.size()-1; i>=0; i-- )
@@ -177,6 +228,25 @@ bool MinMaxBuilder_T<T>::Save ( util::FileWriter_c & tWriter, std::string & sErr
 	return SaveTreeLevels(tWriter);
 }
 
+template<typename T>
+bool MinMaxBuilder_T<T>::SaveMapped ( util::FileWriter_c & tWriter ) const
+{
+	// same level order as the packed tree, but raw aligned (min,max) pairs that are used right from the mapped file
+	tWriter.Write_uint32 ( (uint32_t)m_dTreeLevels.size() );
+	for ( int i = (int)m_dTreeLevels.size()-1; i>=0; i-- )
+		tWriter.Write_uint32 ( (uint32_t)m_dTreeLevels[i].size() );
+
+	WriteMappedPadding(tWriter);
+	for ( int i = (int)m_dTreeLevels.size()-1; i>=0; i-- )
+		for ( auto & tMinMax : m_dTreeLevels[i] )
+		{
+			tWriter.Write ( tMinMax.first );
+			tWriter.Write ( tMinMax.second );
+		}
+
+	return !tWriter.IsError();
+}
+
 template<typename T>
 inline bool MinMaxBuilder_T<T>::SaveTreeLevels ( util::FileWriter_c & tWriter ) const
 {
@@ -19,6 +19,8 @@
 #include "builderminmax.h"
 
 #include <unordered_map>
+#include <algorithm>
+#include <cmath>
 
 namespace columnar
 {
@@ -26,6 +28,9 @@ namespace columnar
 using namespace util;
 using namespace common;
 
+// max distinct elements in a block for DICT packing (one bit per element in the subblock presence mask)
+static const int MAX_MVA_DICT_SIZE = 64;
+
 
 template <typename T>
 class AttributeHeaderBuilder_MVA_T : public AttributeHeaderBuilder_c
@@ -37,7 +42,8 @@ public:
 
 			AttributeHeaderBuilder_MVA_T ( const Settings_t & tSettings, const std::string & sName, AttrType_e eType );
 
-	bool	Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError );
+	bool	Save ( FileWriter_c & tWriter, std::string & sError );
+	void	AddMinMax ( const MinMaxVec_t & dSubblockMinMax ) { m_tMinMax.AddSubblocks(dSubblockMinMax); }
 };
 
 template <typename T>
@@ -47,9 +53,9 @@ AttributeHeaderBuilder_MVA_T<T>::AttributeHeaderBuilder_MVA_T ( const Settings_t
 {}
 
 template <typename T>
-bool AttributeHeaderBuilder_MVA_T<T>::Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError )
+bool AttributeHeaderBuilder_MVA_T<T>::Save ( FileWriter_c & tWriter, std::string & sError )
 {
-	if ( !BASE::Save ( tWriter, tBaseOffset, sError ) )
+	if ( !BASE::Save ( tWriter, sError ) )
 		return false;
 
 	tWriter.Write_uint8(1); // minmax presence flag
@@ -108,15 +114,25 @@ private:
 	std::vector<uint32_t>		m_dTableIndexes;
 	std::vector<uint32_t>		m_dTablePacked;
 
+	// temp arrays for dictionary encoding
+	std::vector<T>				m_dDictValues;
+	std::vector<uint64_t>		m_dDictBitmaps;
+
 	std::unordered_map<std::vector<T>, int, HashFunc_Vec_T<T>> m_hUnique;
 	int				m_iUniques = 0;
 	int				m_iConstLength = -1;
 	bool			m_bValuesSortedAsc = true;
+	bool			m_bValuesStrictAsc = true;
+	bool			m_bDictOverflow = false;
+
+	void			AddToDict ( T tValue );
+	bool			IsDictPackingBetter() const;
 
 	void			WritePacked_Const();
 	void			WritePacked_ConstLen();
 	void			WritePacked_Table();
 	void			WritePacked_DeltaPFOR ( bool bWriteLengths );
+	void			WritePacked_Dict();
 
 	void			WriteSubblockSizes();
 	void			PrepareValues ( Span_T<T> & dValues, const Span_T<uint32_t> & dLengths );
@@ -180,8 +196,58 @@ void Packer_MVA_T<T,HEADER_T>::AnalyzeCollected ( const int64_t * pData, int iLe
 				m_bValuesSortedAsc = false;
 				break;
 			}
+
+			if ( tValue==tPrev )
+				m_bValuesStrictAsc = false;
+
+			tPrev = tValue;
 		}
 	}
+
+	m_bValuesStrictAsc &= m_bValuesSortedAsc;
+
+	// dictionary packing rebuilds MVAs from per-element bitmaps, so it needs sorted values without duplicates
+	for ( int i=0; i < iLength && m_bValuesStrictAsc && !m_bDictOverflow; i++ )
+		AddToDict ( (T)pData[i] );
+}
+
+template <typename T, typename HEADER_T>
+void Packer_MVA_T<T,HEADER_T>::AddToDict ( T tValue )
+{
+	auto tFound = std::lower_bound ( m_dDictValues.begin(), m_dDictValues.end(), tValue );
+	if ( tFound!=m_dDictValues.end() && *tFound==tValue )
+		return;
+
+	if ( (int)m_dDictValues.size()==MAX_MVA_DICT_SIZE )
+	{
+		m_bDictOverflow = true;
+		return;
+	}
+
+	m_dDictValues.insert ( tFound, tValue );
+}
+
+template <typename T, typename HEADER_T>
+bool Packer_MVA_T<T,HEADER_T>::IsDictPackingBetter() const
+{
+	if ( !m_bValuesStrictAsc || m_bDictOverflow || m_dDictValues.empty() )
+		return false;
+
+	// worst case for the dictionary: every element is present in every subblock
+	uint64_t uDocs = m_dCollectedLengths.size();
+	uint64_t uValues = m_dCollectedValues.size();
+	uint64_t uSubblockSize = BASE::m_tHeader.GetSettings().m_iSubblockSize;
+	uint64_t uSubblocks = ( uDocs + uSubblockSize - 1 ) / uSubblockSize;
+	uint64_t uDictBits = uSubblocks * ( 64 + m_dDictValues.size()*uSubblockSize );
+
+	// rough estimate for PFOR: lengths, first value of each MVA and the deltas between values
+	uint64_t uAvgLength = std::max<uint64_t> ( uValues/uDocs, 1 );
+	uint64_t uAvgDelta = uint64_t ( m_dDictValues.back()-m_dDictValues.front() ) / uAvgLength;
+	uint64_t uPforBits = uDocs * ( CalcNumBits(uAvgLength) + CalcNumBits ( (uint64_t)m_dDictValues.back() ) );
+	if ( uValues > uDocs )
+		uPforBits += ( uValues-uDocs ) * std::max ( CalcNumBits(uAvgDelta), 1 );
+
+	return uDictBits <= uPforBits;
 }
 
 template <typename T, typename HEADER_T>
@@ -193,6 +259,9 @@ MvaPacking_e Packer_MVA_T<T,HEADER_T>::ChoosePacking() const
 	if ( m_iUniques<256 )
 		return MvaPacking_e::TABLE;
 
+	if ( IsDictPackingBetter() )
+		return MvaPacking_e::DICT;
+
 	if ( m_iConstLength!=-1 )
 		return MvaPacking_e::CONSTLEN;
 
@@ -206,8 +275,8 @@ void Packer_MVA_T<T,HEADER_T>::Flush()
 		return;
 	
 	auto ePacking = ChoosePacking();
-	BASE::m_tHeader.AddBlock ( BASE::m_tWriter.GetPos(), to_underlying(ePacking) );
 	WriteToFile(ePacking);
+	BASE::WriteBlock ( to_underlying(ePacking) );
 
 	m_dCollectedLengths.resize(0);
 	m_dCollectedValues.resize(0);
@@ -216,6 +285,9 @@ void Packer_MVA_T<T,HEADER_T>::Flush()
 	m_iUniques = 0;
 	m_hUnique.clear();
 	m_bValuesSortedAsc = true;
+	m_bValuesStrictAsc = true;
+	m_bDictOverflow = false;
+	m_dDictValues.resize(0);
 }
 
 template <typename T, typename HEADER_T>
@@ -242,6 +314,10 @@ void Packer_MVA_T<T,HEADER_T>::WriteToFile ( MvaPacking_e ePacking )
 		WritePacked_DeltaPFOR(true);
 		break;
 
+	case MvaPacking_e::DICT:
+		WritePacked_Dict();
+		break;
+
 	default:
 		assert ( 0 && "Unknown packing" );
 		break;
@@ -391,6 +467,65 @@ void Packer_MVA_T<T,HEADER_T>::WritePacked_DeltaPFOR ( bool bWriteLengths )
 	BASE::m_tWriter.Write ( m_dTmpBuffer.data(), m_dTmpBuffer.size()*sizeof ( m_dTmpBuffer[0] ) );
 }
 
+template <typename T, typename HEADER_T>
+void Packer_MVA_T<T,HEADER_T>::WritePacked_Dict()
+{
+	assert ( m_bValuesStrictAsc && !m_dDictValues.empty() && (int)m_dDictValues.size()<=MAX_MVA_DICT_SIZE );
+
+	// sorted dictionary of block elements
+	BASE::m_tWriter.Pack_uint32 ( (uint32_t)m_dDictValues.size() );
+	WriteValues_Delta_PFOR ( Span_T<T>(m_dDictValues), m_dUncompressed, m_dCompressed, BASE::m_tWriter, m_pCodec.get() );
+
+	int iSubblockSize = BASE::m_tHeader.GetSettings().m_iSubblockSize;
+	int iBlocks = ( (int)m_dCollectedLengths.size() + iSubblockSize - 1 ) / iSubblockSize;
+	int iWordsPerBitmap = iSubblockSize >> 6;
+
+	m_dSubblockSizes.resize(iBlocks);
+	m_dDictBitmaps.resize ( m_dDictValues.size()*iWordsPerBitmap );
+
+	m_dTmpBuffer.resize(0);
+	MemWriter_c tMemWriter ( m_dTmpBuffer );
+
+	// each subblock is a mask of present elements followed by a bitmap of rows for every present element
+	int iBlockStart = 0;
+	uint32_t uOffset = 0;
+	for ( int iBlock=0; iBlock < iBlocks; iBlock++ )
+	{
+		int iBlockValues = GetSubblockSize ( iBlock, iBlocks, (int)m_dCollectedLengths.size(), iSubblockSize );
+		int64_t tSubblockStart = tMemWriter.GetPos();
+
+		std::fill ( m_dDictBitmaps.begin(), m_dDictBitmaps.end(), 0 );
+		uint64_t uMask = 0;
+		for ( int iRow = 0; iRow < iBlockValues; iRow++ )
+		{
+			uint32_t uLength = m_dCollectedLengths[iBlockStart+iRow];
+			for ( uint32_t i = 0; i < uLength; i++ )
+			{
+				int iElement = int ( std::lower_bound ( m_dDictValues.begin(), m_dDictValues.end(), m_dCollectedValues[uOffset+i] ) - m_dDictValues.begin() );
+				assert ( iElement < (int)m_dDictValues.size() && m_dDictValues[iElement]==m_dCollectedValues[uOffset+i] );
+				m_dDictBitmaps[iElement*iWordsPerBitmap + (iRow>>6)] |= 1ULL << (iRow & 63);
+				uMask |= 1ULL << iElement;
+			}
+
+			uOffset += uLength;
+		}
+
+		tMemWriter.Write_uint64(uMask);
+
+		int iUsedWords = ( iBlockValues+63 ) >> 6;
+		for ( int iElement = 0; iElement < (int)m_dDictValues.size(); iElement++ )
+			if ( uMask & ( 1ULL << iElement ) )
+				tMemWriter.Write ( (const uint8_t*)&m_dDictBitmaps[iElement*iWordsPerBitmap], iUsedWords*sizeof ( m_dDictBitmaps[0] ) );
+
+		m_dSubblockSizes[iBlock] = uint32_t ( tMemWriter.GetPos()-tSubblockStart );
+		iBlockStart += iBlockValues;
+	}
+
+	WriteSubblockSizes();
+
+	BASE::m_tWriter.Write ( m_dTmpBuffer.data(), m_dTmpBuffer.size()*sizeof ( m_dTmpBuffer[0] ) );
+}
+
 template <typename T, typename HEADER_T>
 void Packer_MVA_T<T,HEADER_T>::PrepareValues ( Span_T<T> & dValues, const Span_T<uint32_t> & dLengths )
 {
@@ -422,6 +557,169 @@ void Packer_MVA_T<T,HEADER_T>::WriteSubblockSizes()
 
 //////////////////////////////////////////////////////////////////////////
 
+// stores float vectors as raw or quantized elements instead of compressing float bits as MVA values
+class Packer_FloatVec_c : public PackerTraits_T<AttributeHeaderBuilder_MVA_T<float>>
+{
+	using BASE = PackerTraits_T<AttributeHeaderBuilder_MVA_T<float>>;
+
+public:
+					Packer_FloatVec_c ( const Settings_t & tSettings, const std::string & sName, FloatVecStorage_e eStorage );
+
+protected:
+	void			AddDoc ( int64_t tAttr ) final						{ assert ( 0 && "INTERNAL ERROR: sending integers to float vector packer" ); }
+	void			AddDoc ( const uint8_t * pData, int iLength ) final	{ assert ( 0 && "INTERNAL ERROR: sending strings to float vector packer" ); }
+	void			AddDoc ( const int64_t * pData, int iLength ) final;
+	void			Flush() final;
+
+private:
+	FloatVecStorage_e			m_eStorage = FloatVecStorage_e::FLOAT32;
+	std::vector<uint32_t>		m_dCollectedLengths;
+	std::vector<float>			m_dCollectedValues;
+	int							m_iConstLength = -1;
+
+	std::unique_ptr<IntCodec_i>	m_pCodec;
+	std::vector<uint32_t>		m_dUncompressed32;
+	std::vector<uint32_t>		m_dCompressed;
+	std::vector<uint8_t>		m_dEncoded;
+
+	float			CalcBlockScale() const;
+	void			WriteVector ( const float * pValues, int iLength, float fBlockScale );
+};
+
+
+Packer_FloatVec_c::Packer_FloatVec_c ( const Settings_t & tSettings, const std::string & sName, FloatVecStorage_e eStorage )
+	: BASE ( tSettings, sName, AttrType_e::FLOATVEC )
+	, m_eStorage ( eStorage )
+	, m_pCodec ( CreateIntCodec ( tSettings.m_sCompressionUINT32, tSettings.m_sCompressionUINT64 ) )
+{
+	assert ( eStorage!=FloatVecStorage_e::DEFAULT && eStorage<FloatVecStorage_e::TOTAL );
+}
+
+
+void Packer_FloatVec_c::AddDoc ( const int64_t * pData, int iLength )
+{
+	if ( m_dCollectedLengths.size()==DOCS_PER_BLOCK )
+		Flush();
+
+	if ( m_dCollectedLengths.empty() )
+		m_iConstLength = iLength;
+	else if ( iLength!=m_iConstLength )
+		m_iConstLength = -1;
+
+	m_dCollectedLengths.push_back(iLength);
+	for ( int i = 0; i < iLength; i++ )
+		m_dCollectedValues.push_back ( to_type<float> ( pData[i] ) );
+
+	BASE::m_tHeader.m_tMinMax.Add ( pData, iLength );
+}
+
+
+void Packer_FloatVec_c::Flush()
+{
+	if ( m_dCollectedLengths.empty() )
+		return;
+
+	BASE::m_tWriter.Pack_uint32 ( to_underlying ( MvaPacking_e::FLOATVEC ) );
+	BASE::m_tWriter.Write_uint8(0); // values are not sorted
+	BASE::m_tWriter.Write_uint8 ( (uint8_t)to_underlying(m_eStorage) );
+
+	// 0 means variable length; lengths follow
+	BASE::m_tWriter.Pack_uint32 ( m_iConstLength>=0 ? m_iConstLength+1 : 0 );
+	if ( m_iConstLength<0 )
+	{
+		BASE::m_tWriter.Pack_uint32 ( (uint32_t)m_dCollectedLengths.size() );
+		WriteValues_PFOR ( Span_T<uint32_t>(m_dCollectedLengths), m_dUncompressed32, m_dCompressed, BASE::m_tWriter, m_pCodec.get(), true );
+	}
+
+	float fBlockScale = 0.0f;
+	if ( m_eStorage==FloatVecStorage_e::INT8_BLOCK )
+	{
+		fBlockScale = CalcBlockScale();
+		BASE::m_tWriter.Write_uint32 ( FloatToUint(fBlockScale) );
+	}
+
+	// vectors are stored uncompressed so that any row can be located from its length and decoded in place
+	const float * pValues = m_dCollectedValues.data();
+	for ( auto i : m_dCollectedLengths )
+	{
+		WriteVector ( pValues, i, fBlockScale );
+		pValues += i;
+	}
+
+	BASE::WriteBlock ( to_underlying ( MvaPacking_e::FLOATVEC ) );
+
+	m_dCollectedLengths.resize(0);
+	m_dCollectedValues.resize(0);
+	m_iConstLength = -1;
+}
+
+
+static float CalcInt8Scale ( const float * pValues, size_t tLength )
+{
+	float fMax = 0.0f;
+	for ( size_t i = 0; i < tLength; i++ )
+		fMax = std::max ( fMax, std::abs ( pValues[i] ) );
+
+	return fMax / 127.0f;
+}
+
+
+float Packer_FloatVec_c::CalcBlockScale() const
+{
+	return CalcInt8Scale ( m_dCollectedValues.data(), m_dCollectedValues.size() );
+}
+
+
+template <typename T>
+static FORCE_INLINE void EncodeElements ( const float * pValues, int iLength, std::vector<uint8_t> & dEncoded, T && fnEncode )
+{
+	using ELEMENT = decltype ( fnEncode(0.0f) );
+	dEncoded.resize ( iLength*sizeof(ELEMENT) );
+	ELEMENT * pEncoded = (ELEMENT*)dEncoded.data();
+	for ( int i = 0; i < iLength; i++ )
+		pEncoded[i] = fnEncode ( pValues[i] );
+}
+
+
+void Packer_FloatVec_c::WriteVector ( const float * pValues, int iLength, float fBlockScale )
+{
+	float fScale = fBlockScale;
+	switch ( m_eStorage )
+	{
+	case FloatVecStorage_e::FLOAT32:
+		BASE::m_tWriter.Write ( (const uint8_t*)pValues, iLength*sizeof(float) );
+		return;
+
+	case FloatVecStorage_e::FLOAT16:
+		EncodeElements ( pValues, iLength, m_dEncoded, []( float fValue ){ return FloatToHalf(fValue); } );
+		break;
+
+	case FloatVecStorage_e::BFLOAT16:
+		EncodeElements ( pValues, iLength, m_dEncoded, []( float fValue ){ return FloatToBFloat16(fValue); } );
+		break;
+
+	case FloatVecStorage_e::INT8_VECTOR:
+		fScale = CalcInt8Scale ( pValues, iLength );
+		BASE::m_tWriter.Write_uint32 ( FloatToUint(fScale) );
+		// fall through
+
+	case FloatVecStorage_e::INT8_BLOCK:
+	{
+		float fInvScale = fScale>0.0f ? 1.0f/fScale : 0.0f;
+		EncodeElements ( pValues, iLength, m_dEncoded, [fInvScale]( float fValue ){ return (int8_t)std::max ( -127.0f, std::min ( 127.0f, std::round ( fValue*fInvScale ) ) ); } );
+	}
+	break;
+
+	default:
+		assert ( 0 && "Unknown float vector storage" );
+		return;
+	}
+
+	BASE::m_tWriter.Write ( m_dEncoded.data(), m_dEncoded.size() );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 Packer_i * CreatePackerMva32 ( const Settings_t & tSettings, const std::string & sName )
 {
 	return new Packer_MVA_T<uint32_t,uint32_t> ( tSettings, sName, AttrType_e::UINT32SET );
@@ -434,9 +732,12 @@ Packer_i * CreatePackerMva64 ( const Settings_t & tSettings, const std::string &
 }
 
 
-Packer_i * CreatePackerFloatVec ( const Settings_t & tSettings, const std::string & sName )
+Packer_i * CreatePackerFloatVec ( const Settings_t & tSettings, const std::string & sName, FloatVecStorage_e eStorage )
 {
-	return new Packer_MVA_T<uint32_t,float> ( tSettings, sName, AttrType_e::FLOATVEC );
+	if ( eStorage==FloatVecStorage_e::DEFAULT )
+		return new Packer_MVA_T<uint32_t,float> ( tSettings, sName, AttrType_e::FLOATVEC );
+
+	return new Packer_FloatVec_c ( tSettings, sName, eStorage );
 }
 
 } // namespace columnar
\ No newline at end of file
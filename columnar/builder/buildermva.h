@@ -27,6 +27,8 @@ enum class MvaPacking_e : uint32_t
 	CONSTLEN,
 	TABLE,
 	DELTA_PFOR,
+	DICT,
+	FLOATVEC,
 
 	TOTAL
 };
@@ -34,9 +36,10 @@ enum class MvaPacking_e : uint32_t
 
 class Packer_i;
 struct Settings_t;
+enum class FloatVecStorage_e : uint32_t;
 
 Packer_i * CreatePackerMva32 ( const Settings_t & tSettings, const std::string & sName );
 Packer_i * CreatePackerMva64 ( const Settings_t & tSettings, const std::string & sName );
-Packer_i * CreatePackerFloatVec ( const Settings_t & tSettings, const std::string & sName );
+Packer_i * CreatePackerFloatVec ( const Settings_t & tSettings, const std::string & sName, FloatVecStorage_e eStorage );
 
 } // namespace columnar
@@ -38,7 +38,8 @@ public:
 
 			AttributeHeaderBuilder_String_c ( const Settings_t & tSettings, const std::string & sName, AttrType_e eType );
 
-	bool	Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError );
+	bool	Save ( FileWriter_c & tWriter, std::string & sError );
+	void	AddMinMax ( const MinMaxVec_t & dSubblockMinMax ) { m_tMinMax.AddSubblocks(dSubblockMinMax); }
 };
 
 
@@ -48,9 +49,9 @@ AttributeHeaderBuilder_String_c::AttributeHeaderBuilder_String_c ( const Setting
 {}
 
 
-bool AttributeHeaderBuilder_String_c::Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError )
+bool AttributeHeaderBuilder_String_c::Save ( FileWriter_c & tWriter, std::string & sError )
 {
-	if ( !BASE::Save ( tWriter, tBaseOffset, sError ) )
+	if ( !BASE::Save ( tWriter, sError ) )
 		return false;
 
 	tWriter.Write_uint8(1); // minmax presence flag
@@ -145,8 +146,8 @@ void Packer_String_c::Flush()
 		return;
 
 	auto ePacking = ChoosePacking();
-	m_tHeader.AddBlock ( m_tWriter.GetPos(), to_underlying(ePacking) );
 	WriteToFile(ePacking);
+	WriteBlock ( to_underlying(ePacking) );
 
 	m_dCollected.resize(0);
 
@@ -261,7 +262,14 @@ void Packer_String_c::WritePacked_Table()
 	for ( const auto & i : m_dUniques )
 		m_tWriter.Write ( (const uint8_t*)i.c_str(), i.length() );
 
-	WriteTableOrdinals ( m_dUniques, m_hUnique, m_dCollected, m_dTableIndexes, m_dCompressed, m_tHeader.GetSettings().m_iSubblockSize, m_tWriter );
+	auto fnGetOrdinal = [this]( const std::string & sValue )
+		{
+			auto tFound = m_hUnique.find(sValue);
+			assert ( tFound!=m_hUnique.end() );
+			return tFound->second;
+		};
+
+	WriteTableOrdinals ( m_dUniques, fnGetOrdinal, m_dCollected, m_dTableIndexes, m_dCompressed, m_tHeader.GetSettings().m_iSubblockSize, m_tWriter );
 }
 
 
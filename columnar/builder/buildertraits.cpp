@@ -30,18 +30,39 @@ AttributeHeaderBuilder_c::AttributeHeaderBuilder_c ( const Settings_t & tSetting
 {}
 
 
-bool AttributeHeaderBuilder_c::Save ( FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError )
+bool AttributeHeaderBuilder_c::Save ( FileWriter_c & tWriter, std::string & sError )
 {
 	m_tSettings.Save(tWriter);
 
 	tWriter.Write_string(m_sName);
 
-	// store base offset to correct it later
-	tBaseOffset = tWriter.GetPos();
+	uint32_t uMaxPacking = 0;
+	for ( const auto & i : m_dBlocks )
+		uMaxPacking = std::max ( i.second, uMaxPacking );
 
-	tWriter.Write_uint64 ( 0 ); // stub
+	std::vector<uint32_t> dPackings ( uMaxPacking+1, 0 );
+	for ( const auto & i : m_dBlocks )
+		dPackings[i.second]++;
+
+	if ( m_tSettings.m_bMappedHeader )
+	{
+		// [blocks][packings][packing stats]...[padding][block offsets]
+		tWriter.Write_uint32 ( (uint32_t)m_dBlocks.size() );
+		tWriter.Write_uint32 ( (uint32_t)dPackings.size() );
+		for ( auto i : dPackings )
+			tWriter.Write_uint32(i);
+
+		WriteMappedPadding(tWriter);
+		for ( const auto & i : m_dBlocks )
+			tWriter.Write_uint64 ( i.first );
+
+		return !tWriter.IsError();
+	}
+
+	// blocks were written directly to the final file, so offsets are already absolute
+	int64_t tPrevOffset = m_dBlocks.empty() ? 0 : m_dBlocks[0].first;
+	tWriter.Write_uint64 ( tPrevOffset );
 	tWriter.Pack_uint32 ( (uint32_t)m_dBlocks.size() );
-	int64_t tPrevOffset = 0;
 
 	// no offset for 1st block
 	for ( size_t i=1; i < m_dBlocks.size(); i++ )
@@ -50,14 +71,6 @@ bool AttributeHeaderBuilder_c::Save ( FileWriter_c & tWriter, int64_t & tBaseOff
 		tPrevOffset = m_dBlocks[i].first;
 	}
 
-	uint32_t uMaxPacking = 0;
-	for ( const auto & i : m_dBlocks )
-		uMaxPacking = std::max ( i.second, uMaxPacking );
-
-	std::vector<uint32_t> dPackings ( uMaxPacking+1, 0 );
-	for ( const auto & i : m_dBlocks )
-		dPackings[i.second]++;
-
 	tWriter.Pack_uint32 ( dPackings.size() );
 	for ( auto i : dPackings )
 		tWriter.Pack_uint32(i);
@@ -65,4 +78,60 @@ bool AttributeHeaderBuilder_c::Save ( FileWriter_c & tWriter, int64_t & tBaseOff
 	return !tWriter.IsError();
 }
 
+
+bool WriteHeaders ( const std::vector<std::shared_ptr<Packer_i>> & dPackers, FileWriterExtents_c & tBodyWriter, const std::string & sFile, size_t tBufferSize, std::string & sError )
+{
+	// [version][N][headers_offset][blocks of all attributes]...[header0][offset_of_header1]...[headerN][directory][directory_offset]
+	if ( tBodyWriter.IsError() )
+	{
+		sError = tBodyWriter.GetError();
+		return false;
+	}
+
+	int64_t iHeadersOffset = tBodyWriter.GetPos();
+	tBodyWriter.Close();
+
+	FileWriter_c tWriter;
+	tWriter.SetBufferSize(tBufferSize);
+	if ( !tWriter.Open ( sFile, false, false, false, sError ) )
+		return false;
+
+	tWriter.Write_uint32 ( STORAGE_VERSION );
+	tWriter.Write_uint32 ( (uint32_t)dPackers.size() );
+	tWriter.Write_uint64 ( iHeadersOffset );
+
+	tWriter.Seek(iHeadersOffset);
+	std::vector<int64_t> dHeaderOffsets;
+	for ( size_t i=0; i < dPackers.size(); i++ )
+	{
+		auto & pPacker = dPackers[i];
+		dHeaderOffsets.push_back ( tWriter.GetPos() );
+		if ( !pPacker->WriteHeader ( tWriter, sError ) )
+			return false;
+
+		int64_t tNextOffset = i<dPackers.size()-1 ? tWriter.GetPos() : 0;
+		tWriter.Write_uint64 ( tNextOffset + sizeof(int64_t) );
+	}
+
+	// the directory lets readers load headers on demand without parsing all of them
+	int64_t iDirectoryOffset = tWriter.GetPos();
+	for ( size_t i=0; i < dPackers.size(); i++ )
+	{
+		tWriter.Write_string ( dPackers[i]->GetName() );
+		tWriter.Write_uint32 ( dPackers[i]->GetTypeWord() );
+		tWriter.Write_uint64 ( dHeaderOffsets[i] );
+	}
+
+	tWriter.Write_uint64(iDirectoryOffset);
+
+	tWriter.Close();
+	if ( tWriter.IsError() )
+	{
+		sError = tWriter.GetError();
+		return false;
+	}
+
+	return true;
+}
+
 } // namespace columnar
\ No newline at end of file
@@ -34,11 +34,28 @@ namespace columnar
 static const uint32_t	BLOCK_ID_BITS = 16;
 static const int		DOCS_PER_BLOCK = 1 << BLOCK_ID_BITS;
 
+// headers whose arrays are used straight from an mmap of the file (v.16+) set this flag in the type word
+static const uint32_t	MAPPED_HEADER_FLAG = 0x80000000;
+static const int		MAPPED_HEADER_ALIGN = 8;
+
+inline int64_t AlignMapped ( int64_t iOffset )
+{
+	return ( iOffset + MAPPED_HEADER_ALIGN - 1 ) & ~int64_t ( MAPPED_HEADER_ALIGN - 1 );
+}
+
+inline void WriteMappedPadding ( util::FileWriter_c & tWriter )
+{
+	while ( tWriter.GetPos()!=AlignMapped ( tWriter.GetPos() ) )
+		tWriter.Write_uint8(0);
+}
+
+
 struct Settings_t
 {
 	int			m_iSubblockSize = 1024;
 	std::string	m_sCompressionUINT32 = "libstreamvbyte";
 	std::string	m_sCompressionUINT64 = "fastpfor256";
+	bool		m_bMappedHeader = false;	// not saved with the settings; stored as MAPPED_HEADER_FLAG
 
 	void		Load ( util::FileReader_c & tReader );
 	void		Save ( util::FileWriter_c & tWriter );
@@ -51,10 +68,12 @@ class AttributeHeaderBuilder_c
 public:
 						AttributeHeaderBuilder_c ( const Settings_t & tSettings, const std::string & sName, common::AttrType_e eType );
 
+	const std::string &	GetName() const { return m_sName; }
 	common::AttrType_e	GetType() const { return m_eType; }
+	uint32_t			GetTypeWord() const { return util::to_underlying(m_eType) | ( m_tSettings.m_bMappedHeader ? MAPPED_HEADER_FLAG : 0 ); }
 	const Settings_t &	GetSettings() const { return m_tSettings; }
 	void				AddBlock ( uint64_t uOffset, uint32_t uPacking ) { m_dBlocks.push_back ( { uOffset, uPacking } ); }
-	bool				Save ( util::FileWriter_c & tWriter, int64_t & tBaseOffset, std::string & sError );
+	bool				Save ( util::FileWriter_c & tWriter, std::string & sError );
 
 private:
 	std::string			m_sName;
@@ -69,17 +88,23 @@ class Packer_i
 public:
 	virtual				~Packer_i(){}
 
-	virtual bool		Setup ( const std::string & sFilename, size_t tBufferSize, std::string & sError ) = 0;
+	virtual void		Setup ( util::FileWriterExtents_c & tBodyWriter ) = 0;
 	virtual void		AddDoc ( int64_t tAttr ) = 0;
 	virtual void		AddDoc ( const uint8_t * pData, int iLength ) = 0;
 	virtual void		AddDoc ( const int64_t * pData, int iLength ) = 0;
-	virtual void		CorrectOffset ( util::FileWriter_c & tWriter, int64_t tBodyOffset ) = 0;
-	virtual int64_t		GetBodySize() const = 0;
+
+	// batches of documents; doc i of a string/MVA batch spans [dOffsets[i], dOffsets[i+1])
+	virtual void		AddDocs ( const util::Span_T<int64_t> & dValues ) = 0;
+	virtual void		AddDocs ( const uint8_t * pData, const util::Span_T<int64_t> & dOffsets ) = 0;
+	virtual void		AddDocs ( const int64_t * pData, const util::Span_T<int64_t> & dOffsets ) = 0;
 	virtual void		Done() = 0;
-	virtual void		Cleanup() = 0;
+
+	// appends an already encoded block; only valid on block boundaries
+	virtual void		CopyBlock ( const util::Span_T<uint8_t> & dBlock, uint32_t uPacking, const MinMaxVec_t & dSubblockMinMax ) = 0;
 
 	virtual bool		WriteHeader ( util::FileWriter_c & tWriter, std::string & sError ) = 0;
-	virtual bool		WriteBody ( const std::string & sDest, std::string & sError ) const = 0;
+	virtual const std::string & GetName() const = 0;
+	virtual uint32_t	GetTypeWord() const = 0;
 };
 
 template <typename HEADER>
@@ -88,71 +113,87 @@ class PackerTraits_T : public Packer_i
 public:
 					PackerTraits_T ( const Settings_t & tSettings, const std::string & sName, common::AttrType_e eType );
 
-	bool			Setup ( const std::string & sFilename, size_t tBufferSize, std::string & sError ) override;
-	void			CorrectOffset ( util::FileWriter_c & tWriter, int64_t tBodyOffset ) override;
-	int64_t			GetBodySize() const override { return m_iBodySize; }
-	void			Done() override;
+	void			Setup ( util::FileWriterExtents_c & tBodyWriter ) override { m_pBodyWriter = &tBodyWriter; }
+	void			AddDocs ( const util::Span_T<int64_t> & dValues ) override;
+	void			AddDocs ( const uint8_t * pData, const util::Span_T<int64_t> & dOffsets ) override;
+	void			AddDocs ( const int64_t * pData, const util::Span_T<int64_t> & dOffsets ) override;
+	void			Done() override { Flush(); }
+	void			CopyBlock ( const util::Span_T<uint8_t> & dBlock, uint32_t uPacking, const MinMaxVec_t & dSubblockMinMax ) override;
 	bool			WriteHeader ( util::FileWriter_c & tWriter, std::string & sError ) override;
-	bool			WriteBody ( const std::string & sDest, std::string & sError ) const override;
-	void			Cleanup() override;
+	const std::string & GetName() const override { return m_tHeader.GetName(); }
+	uint32_t		GetTypeWord() const override { return m_tHeader.GetTypeWord(); }
 
 	virtual void	Flush() = 0;
 
 protected:
-	util::FileWriter_c	m_tWriter;
-	int64_t				m_iBaseOffset = 0;
-	int64_t				m_iBodySize = 0;
-	size_t				m_tBufferSize = 0;
+	std::vector<uint8_t>	m_dBlock;
+	util::MemWriter_c		m_tWriter;
+
+	HEADER					m_tHeader;
 
-	HEADER				m_tHeader;
+	void			WriteBlock ( uint32_t uPacking );
+
+private:
+	util::FileWriterExtents_c * m_pBodyWriter = nullptr;
 };
 
 template <typename HEADER>
 PackerTraits_T<HEADER>::PackerTraits_T ( const Settings_t & tSettings, const std::string & sName, common::AttrType_e eType )
-	: m_tHeader ( tSettings, sName, eType )
+	: m_tWriter ( m_dBlock )
+	, m_tHeader ( tSettings, sName, eType )
 {}
 
 template <typename HEADER>
-bool PackerTraits_T<HEADER>::Setup ( const std::string & sFilename, size_t tBufferSize, std::string & sError )
+void PackerTraits_T<HEADER>::AddDocs ( const util::Span_T<int64_t> & dValues )
 {
-	m_tBufferSize = tBufferSize;
-	m_tWriter.SetBufferSize(tBufferSize);
-	return m_tWriter.Open ( sFilename, sError );
+	for ( auto i : dValues )
+		AddDoc(i);
 }
 
 template <typename HEADER>
-void PackerTraits_T<HEADER>::CorrectOffset ( util::FileWriter_c & tWriter, int64_t iBodyOffset )
+void PackerTraits_T<HEADER>::AddDocs ( const uint8_t * pData, const util::Span_T<int64_t> & dOffsets )
 {
-	tWriter.SeekAndWrite ( m_iBaseOffset, iBodyOffset );
+	for ( size_t i = 1; i < dOffsets.size(); i++ )
+		AddDoc ( pData + dOffsets[i-1], int ( dOffsets[i]-dOffsets[i-1] ) );
 }
 
 template <typename HEADER>
-void PackerTraits_T<HEADER>::Done()
+void PackerTraits_T<HEADER>::AddDocs ( const int64_t * pData, const util::Span_T<int64_t> & dOffsets )
 {
-	Flush();
-	m_iBodySize = m_tWriter.GetPos();
-	m_tWriter.Close();
+	for ( size_t i = 1; i < dOffsets.size(); i++ )
+		AddDoc ( pData + dOffsets[i-1], int ( dOffsets[i]-dOffsets[i-1] ) );
 }
 
 template <typename HEADER>
 bool PackerTraits_T<HEADER>::WriteHeader ( util::FileWriter_c & tWriter, std::string & sError )
 {
-	tWriter.Write_uint32 ( util::to_underlying ( m_tHeader.GetType() ) );
-	return m_tHeader.Save ( tWriter, m_iBaseOffset, sError );
+	tWriter.Write_uint32 ( m_tHeader.GetTypeWord() );
+	return m_tHeader.Save ( tWriter, sError );
 }
 
 template <typename HEADER>
-bool PackerTraits_T<HEADER>::WriteBody ( const std::string & sDest, std::string & sError ) const
+void PackerTraits_T<HEADER>::CopyBlock ( const util::Span_T<uint8_t> & dBlock, uint32_t uPacking, const MinMaxVec_t & dSubblockMinMax )
 {
-	return util::CopySingleFile ( m_tWriter.GetFilename(), sDest, sError, O_CREAT | O_RDWR | O_APPEND | O_BINARY, m_tBufferSize );
+	// the previous block may be complete but not flushed yet
+	Flush();
+
+	assert(m_pBodyWriter);
+	m_tHeader.AddBlock ( m_pBodyWriter->Append ( dBlock.data(), dBlock.size() ), uPacking );
+	m_tHeader.AddMinMax(dSubblockMinMax);
 }
 
 template <typename HEADER>
-void PackerTraits_T<HEADER>::Cleanup()
+void PackerTraits_T<HEADER>::WriteBlock ( uint32_t uPacking )
 {
-	m_tWriter.Unlink();
+	// the block was encoded to memory; now it goes straight to its final place in the file
+	assert(m_pBodyWriter);
+	m_tHeader.AddBlock ( m_pBodyWriter->Append ( m_dBlock.data(), m_dBlock.size() ), uPacking );
+	m_dBlock.resize(0);
 }
 
+// writes the storage prologue and all packer headers once the bodies are done
+bool	WriteHeaders ( const std::vector<std::shared_ptr<Packer_i>> & dPackers, util::FileWriterExtents_c & tBodyWriter, const std::string & sFile, size_t tBufferSize, std::string & sError );
+
 //////////////////////////////////////////////////////////////////////////
 
 FORCE_INLINE int GetSubblockSize ( int iSubblock, int iNumSubblocks, int iNumValues, int iSubblockSize )
@@ -205,8 +246,8 @@ static void WriteValues_PFOR ( const util::Span_T<T> & dValues, std::vector<T> &
 	tWriter.Write ( (const uint8_t*)dTmpCompressed.data(), dTmpCompressed.size()*sizeof ( dTmpCompressed[0] ) );
 }
 
-template <typename UNIQ_VEC, typename UNIQ_HASH, typename COLLECTED>
-void WriteTableOrdinals ( UNIQ_VEC & dUniques, UNIQ_HASH & hUnique, COLLECTED & dCollected, std::vector<uint32_t> & dTableIndexes, std::vector<uint32_t> & dCompressed, int iSubblockSize, util::FileWriter_c & tWriter )
+template <typename UNIQ_VEC, typename GET_ORDINAL, typename COLLECTED, typename WRITER>
+void WriteTableOrdinals ( UNIQ_VEC & dUniques, GET_ORDINAL && fnGetOrdinal, COLLECTED & dCollected, std::vector<uint32_t> & dTableIndexes, std::vector<uint32_t> & dCompressed, int iSubblockSize, WRITER & tWriter )
 {
 	// write the ordinals
 	int iBits = util::CalcNumBits ( dUniques.size() );
@@ -215,11 +256,10 @@ void WriteTableOrdinals ( UNIQ_VEC & dUniques, UNIQ_HASH & hUnique, COLLECTED &
 	int iId = 0;
 	for ( auto i : dCollected )
 	{
-		auto tFound = hUnique.find(i);
-		assert ( tFound!=hUnique.end() );
-		assert ( tFound->second<256 );
+		int iOrdinal = fnGetOrdinal(i);
+		assert ( iOrdinal>=0 && iOrdinal<256 );
 
-		dTableIndexes[iId++] = tFound->second;
+		dTableIndexes[iId++] = iOrdinal;
 		if ( iId==iSubblockSize )
 		{
 			util::BitPack ( dTableIndexes, dCompressed, iBits );
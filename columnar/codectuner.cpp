@@ -0,0 +1,247 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "builder.h"
+#include "buildertraits.h"
+#include "codec.h"
+
+#include <algorithm>
+
+namespace columnar
+{
+
+using namespace util;
+using namespace common;
+
+enum class TuneKind_e
+{
+	NONE,
+	INT32,
+	INT64,
+	MVA32,
+	MVA64
+};
+
+
+static TuneKind_e GetTuneKind ( AttrType_e eType )
+{
+	switch ( eType )
+	{
+	case AttrType_e::UINT32:
+	case AttrType_e::TIMESTAMP:
+	case AttrType_e::FLOAT:		return TuneKind_e::INT32;
+	case AttrType_e::INT64:
+	case AttrType_e::UINT64:	return TuneKind_e::INT64;
+	case AttrType_e::UINT32SET:	return TuneKind_e::MVA32;
+	case AttrType_e::INT64SET:	return TuneKind_e::MVA64;
+	default:					return TuneKind_e::NONE;
+	}
+}
+
+// same transform as in the int packers: monotonic subblocks are delta-encoded, other ones are stored relative to their minimum
+template <typename T>
+static void PrepareSubblock ( std::vector<T> & dValues )
+{
+	if ( dValues.empty() )
+		return;
+
+	if ( std::is_sorted ( dValues.begin(), dValues.end() ) )
+	{
+		for ( size_t i = dValues.size()-1; i > 0; i-- )
+			dValues[i] -= dValues[i-1];
+
+		return;
+	}
+
+	T tMin = *std::min_element ( dValues.begin(), dValues.end() );
+	for ( auto & i : dValues )
+		i -= tMin;
+}
+
+
+template <typename T>
+static void AddMva ( const uint8_t * pData, int iLength, bool b64, std::vector<T> & dValues )
+{
+	// values of a document are sorted, so they are stored as deltas like DELTA_PFOR does
+	int iValues = iLength / ( b64 ? sizeof(int64_t) : sizeof(uint32_t) );
+	T tPrev = 0;
+	for ( int i = 0; i < iValues; i++ )
+	{
+		T tValue = b64 ? (T)( (const int64_t*)pData )[i] : (T)( (const uint32_t*)pData )[i];
+		dValues.push_back ( tValue-tPrev );
+		tPrev = tValue;
+	}
+}
+
+
+template <typename T>
+static bool SampleAttr ( const Columnar_i & tColumnar, const std::string & sAttr, TuneKind_e eKind, uint32_t uTotalDocs, int iSubblockSize, int iSampleBlocks, std::vector<std::vector<T>> & dChunks, std::string & sError )
+{
+	std::unique_ptr<Iterator_i> pIterator ( tColumnar.CreateIterator ( sAttr, IteratorHints_t(), nullptr, sError ) );
+	if ( !pIterator )
+		return false;
+
+	bool bMva = eKind==TuneKind_e::MVA32 || eKind==TuneKind_e::MVA64;
+	int iBlocks = ( uTotalDocs + DOCS_PER_BLOCK - 1 ) / DOCS_PER_BLOCK;
+	int iSamples = std::min ( iBlocks, std::max ( iSampleBlocks, 1 ) );
+
+	std::vector<uint32_t> dRowIDs;
+	std::vector<int64_t> dValues;
+	std::vector<T> dChunk;
+	for ( int iSample = 0; iSample < iSamples; iSample++ )
+	{
+		uint32_t tStart = uint32_t ( int64_t(iSample)*iBlocks/iSamples ) * DOCS_PER_BLOCK;
+		uint32_t tEnd = (uint32_t)std::min<int64_t> ( (int64_t)tStart + DOCS_PER_BLOCK, uTotalDocs );
+
+		for ( uint32_t tSubblock = tStart; tSubblock < tEnd; tSubblock += iSubblockSize )
+		{
+			uint32_t tSubblockEnd = std::min ( tSubblock + iSubblockSize, tEnd );
+			dChunk.resize(0);
+
+			if ( bMva )
+			{
+				for ( uint32_t tRowID = tSubblock; tRowID < tSubblockEnd; tRowID++ )
+				{
+					const uint8_t * pData = nullptr;
+					int iLength = pIterator->Get ( tRowID, pData );
+					AddMva ( pData, iLength, eKind==TuneKind_e::MVA64, dChunk );
+				}
+			}
+			else
+			{
+				dRowIDs.resize ( tSubblockEnd-tSubblock );
+				for ( size_t i = 0; i < dRowIDs.size(); i++ )
+					dRowIDs[i] = tSubblock + (uint32_t)i;
+
+				dValues.resize ( dRowIDs.size() );
+				Span_T<int64_t> dValueSpan(dValues);
+				pIterator->Fetch ( Span_T<uint32_t>(dRowIDs), dValueSpan );
+				for ( auto i : dValues )
+					dChunk.push_back ( (T)i );
+
+				PrepareSubblock(dChunk);
+			}
+
+			if ( !dChunk.empty() )
+				dChunks.push_back(dChunk);
+		}
+	}
+
+	return true;
+}
+
+
+template <typename T>
+static void BenchmarkCodecs ( const std::vector<std::string> & dCodecs, std::vector<std::vector<T>> & dChunks, const CodecTuneSettings_t & tSettings, CodecTuneResult_t & tResult )
+{
+	for ( const auto & sCodec : dCodecs )
+	{
+		IntCodecBench_t tBench;
+		if ( !BenchmarkIntCodec ( sCodec, dChunks, tSettings.m_iRounds, tBench ) )
+			continue;
+
+		CodecStats_t tStats;
+		tStats.m_sCodec = sCodec;
+		tStats.m_iUncompressedBytes = tBench.m_iUncompressedBytes;
+		tStats.m_iCompressedBytes = tBench.m_iCompressedBytes;
+		tStats.m_fEncodeMBs = double(tBench.m_iUncompressedBytes)*1000.0 / std::max<int64_t> ( tBench.m_iEncodeTimeNs, 1 );
+		tStats.m_fDecodeMBs = double(tBench.m_iUncompressedBytes)*1000.0 / std::max<int64_t> ( tBench.m_iDecodeTimeNs, 1 );
+		tResult.m_dStats.push_back(tStats);
+	}
+}
+
+
+static void ChooseCodec ( CodecTuneResult_t & tResult, float fMinDecodeSpeed )
+{
+	double fFastest = 0.0;
+	for ( const auto & i : tResult.m_dStats )
+		fFastest = std::max ( fFastest, i.m_fDecodeMBs );
+
+	const CodecStats_t * pBest = nullptr;
+	for ( const auto & i : tResult.m_dStats )
+	{
+		if ( i.m_fDecodeMBs < fFastest*fMinDecodeSpeed )
+			continue;
+
+		if ( !pBest || i.m_iCompressedBytes<pBest->m_iCompressedBytes || ( i.m_iCompressedBytes==pBest->m_iCompressedBytes && i.m_fDecodeMBs>pBest->m_fDecodeMBs ) )
+			pBest = &i;
+	}
+
+	if ( pBest )
+		tResult.m_sRecommended = pBest->m_sCodec;
+}
+
+
+static bool TuneCodecs ( const std::string & sFile, uint32_t uTotalDocs, Schema_t & tSchema, const CodecTuneSettings_t & tSettings, std::vector<CodecTuneResult_t> & dResults, std::string & sError )
+{
+	std::unique_ptr<Columnar_i> pColumnar ( CreateColumnarStorageReader ( sFile, uTotalDocs, sError ) );
+	if ( !pColumnar )
+		return false;
+
+	dResults.resize(0);
+	for ( auto & tAttr : tSchema )
+	{
+		AttrInfo_t tInfo;
+		if ( !pColumnar->GetAttrInfo ( tAttr.m_sName, tInfo ) )
+		{
+			sError = FormatStr ( "attribute '%s' not found in '%s'", tAttr.m_sName.c_str(), sFile.c_str() );
+			return false;
+		}
+
+		TuneKind_e eKind = GetTuneKind ( tInfo.m_eType );
+		if ( eKind==TuneKind_e::NONE )
+			continue;
+
+		int iSubblockSize = tAttr.m_iSubblockSize ? tAttr.m_iSubblockSize : Settings_t().m_iSubblockSize;
+
+		CodecTuneResult_t tResult;
+		tResult.m_sAttr = tAttr.m_sName;
+		tResult.m_bUINT64 = eKind==TuneKind_e::INT64 || eKind==TuneKind_e::MVA64;
+
+		if ( tResult.m_bUINT64 )
+		{
+			std::vector<std::vector<uint64_t>> dChunks;
+			if ( !SampleAttr ( *pColumnar, tAttr.m_sName, eKind, uTotalDocs, iSubblockSize, tSettings.m_iSampleBlocks, dChunks, sError ) )
+				return false;
+
+			BenchmarkCodecs ( GetIntCodecs64(), dChunks, tSettings, tResult );
+		}
+		else
+		{
+			std::vector<std::vector<uint32_t>> dChunks;
+			if ( !SampleAttr ( *pColumnar, tAttr.m_sName, eKind, uTotalDocs, iSubblockSize, tSettings.m_iSampleBlocks, dChunks, sError ) )
+				return false;
+
+			BenchmarkCodecs ( GetIntCodecs32(), dChunks, tSettings, tResult );
+		}
+
+		ChooseCodec ( tResult, tSettings.m_fMinDecodeSpeed );
+		if ( tSettings.m_bApply && !tResult.m_sRecommended.empty() )
+			( tResult.m_bUINT64 ? tAttr.m_sCompressionUINT64 : tAttr.m_sCompressionUINT32 ) = tResult.m_sRecommended;
+
+		dResults.push_back(tResult);
+	}
+
+	return true;
+}
+
+} // namespace columnar
+
+
+bool TuneColumnarCodecs ( const std::string & sFile, uint32_t uTotalDocs, columnar::Schema_t & tSchema, const columnar::CodecTuneSettings_t & tSettings, std::vector<columnar::CodecTuneResult_t> & dResults, std::string & sError )
+{
+	return columnar::TuneCodecs ( sFile, uTotalDocs, tSchema, tSettings, dResults, sError );
+}
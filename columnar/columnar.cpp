@@ -20,11 +20,14 @@
 #include "accessorint.h"
 #include "accessorstr.h"
 #include "accessormva.h"
+#include "accessorpatch.h"
 #include "check.h"
 #include "reader.h"
 
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 namespace columnar
 {
@@ -32,7 +35,7 @@ namespace columnar
 using namespace util;
 using namespace common;
 
-using HeaderWithLocator_t = std::pair<const AttributeHeader_i*, int>;
+using HeaderWithLocator_t = std::pair<std::shared_ptr<const AttributeHeader_i>, int>;
 
 template <bool ROWID_LIMITS, bool COUNT>
 class MinMaxEval_T
@@ -224,7 +227,10 @@ public:
 	bool			GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) final;
 	int64_t			GetNumProcessed() const final;
 	bool			Setup ( const std::vector<HeaderWithLocator_t> & dHeaders, SharedBlocks_c & pMatchingBlocks );
+	void			SetDeadRows ( const DeadRows_t & tDeadRows )	{ m_tDeadRows = tDeadRows; }
 	void			AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const final;
+	void			GetStats ( IteratorStats_t & tStats ) const final;
+	void			SetCollectTime ( bool bCollect ) final	{ m_bCollectTime = bCollect; }
 
 	void			SetCutoff ( int iCutoff ) final	{}
 	bool			WasCutoffHit() const final		{ return false; }
@@ -236,6 +242,7 @@ private:
 	std::array<uint32_t,MAX_COLLECTED>	m_dCollected;
 
 	std::vector<std::string>			m_dAttrs;
+	DeadRows_t							m_tDeadRows;
 
 	int64_t		m_iTotalDocs = 0;
 	int			m_iDoc = 0;
@@ -243,6 +250,8 @@ private:
 	int			m_iDocsInBlock = 0;
 	uint32_t	m_tRowID = 0;
 	int			m_iProcessed = 0;
+	int64_t		m_iTimeNs = 0;
+	bool		m_bCollectTime = false;
 
 	int			m_iNumBlocks = 0;
 	int			m_iDocsPerBlock = 0;
@@ -264,7 +273,7 @@ bool BlockIterator_c::Setup ( const std::vector<HeaderWithLocator_t> & dHeaders,
 	for ( const auto & i : dHeaders )
 		m_dAttrs.push_back ( i.first->GetName() );
 
-	const AttributeHeader_i * pFirstAttr = dHeaders[0].first;
+	const AttributeHeader_i * pFirstAttr = dHeaders[0].first.get();
 	m_iTotalDocs = pFirstAttr->GetNumDocs();
 	m_iNumLevels = pFirstAttr->GetNumMinMaxLevels();
 	m_iNumBlocks = pFirstAttr->GetNumMinMaxBlocks ( m_iNumLevels-1 );
@@ -288,8 +297,23 @@ bool BlockIterator_c::Setup ( const std::vector<HeaderWithLocator_t> & dHeaders,
 
 void BlockIterator_c::AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const
 {
+	// one prefilter evaluates all its attributes, so its stats go to the first one only
+	size_t tFirst = dDesc.size();
 	for ( const auto & i : m_dAttrs )
 		dDesc.push_back ( { i, "prefilter" } );
+
+	if ( tFirst<dDesc.size() )
+		GetStats ( dDesc[tFirst].m_tStats );
+}
+
+
+void BlockIterator_c::GetStats ( IteratorStats_t & tStats ) const
+{
+	// minmax leaves are subblock-sized; no data is read from disk
+	tStats.m_iSubblocks = std::min ( m_iBlock+1, m_pMatchingBlocks->GetNumBlocks() );
+	tStats.m_iSubblocksMinMax = m_iNumBlocks - m_pMatchingBlocks->GetNumBlocks();
+	tStats.m_iRowsEmitted = m_iProcessed;
+	tStats.m_iTimeNs = m_iTimeNs;
 }
 
 
@@ -308,6 +332,7 @@ bool BlockIterator_c::HintRowID ( uint32_t tRowID )
 
 bool BlockIterator_c::GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock )
 {
+	int64_t iStartTime = m_bCollectTime ? GetTimeNs() : 0;
 	uint32_t * pRowIdStart = m_dCollected.data();
 	uint32_t * pRowIdMax = pRowIdStart + m_dCollected.size() - 1;
 	uint32_t * pRowID = pRowIdStart;
@@ -318,19 +343,28 @@ bool BlockIterator_c::GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock )
 		{
 			// this means that we don't have any more docs
 			if ( !m_iDocsInBlock )
+			{
+				if ( m_bCollectTime )
+					m_iTimeNs += GetTimeNs()-iStartTime;
+
 				return false;
+			}
 
 			if ( !SetCurBlock ( m_iBlock+1 ) )
 				break;
 		}
 
-		*pRowID++ = m_tRowID;
+		*pRowID = m_tRowID;
+		pRowID += !m_tDeadRows.IsDead(m_tRowID);
 
 		m_iDoc++;
 		m_tRowID++;
 	}
 
 	m_iProcessed += (int)(pRowID-pRowIdStart);
+	if ( m_bCollectTime )
+		m_iTimeNs += GetTimeNs()-iStartTime;
+
 	return CheckEmptySpan ( pRowID, pRowIdStart, dRowIdBlock );
 }
 
@@ -373,34 +407,56 @@ class Columnar_c final : public Columnar_i
 {
 public:
 										Columnar_c ( const std::string & sFilename, uint32_t uTotalDocs );
+										~Columnar_c() override;
 
 	bool								Setup ( std::string & sError );
 
 	Iterator_i *						CreateIterator ( const std::string & sName, const IteratorHints_t & tHints, columnar::IteratorCapabilities_t * pCapabilities, std::string & sError ) const final;
-	std::vector<BlockIterator_i *>		CreateAnalyzerOrPrefilter ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, const BlockTester_i & tBlockTester ) const final;
+	std::vector<BlockIterator_i *>		CreateAnalyzerOrPrefilter ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, const BlockTester_i & tBlockTester, const DeadRows_t * pDeadRows, std::string & sError ) const final;
 	int64_t								EstimateMinMax ( const Filter_t & tFilter, const BlockTester_i & tBlockTester ) const final;
 	bool								GetAttrInfo ( const std::string & sName, AttrInfo_t & tInfo ) const final;
 
 	bool								EarlyReject ( const std::vector<Filter_t> & dFilters, const BlockTester_i & tBlockTester ) const final;
 	bool								IsFilterDegenerate ( const Filter_t & tFilter ) const final;
+	bool								UpdateAttr ( const std::string & sName, uint32_t tRowID, int64_t tValue, std::string & sError ) final;
+	int									EvictHeaders ( int iMaxIdleRounds ) final;
+	void								GetMemoryUsage ( std::vector<MemoryUsage_t> & dUsage ) const final;
 
 private:
+	// headers are loaded on first use; the directory only keeps what is needed to find them
+	struct HeaderEntry_t
+	{
+		std::string									m_sName;
+		AttrType_e									m_eType = AttrType_e::NONE;
+		int64_t										m_iOffset = 0;
+		mutable std::shared_ptr<AttributeHeader_i>	m_pHeader;		// accessed atomically; iterators keep their own references
+		mutable std::atomic<uint32_t>				m_uLastUsed { 0 };
+	};
+
 	std::string							m_sFilename;
 	uint32_t							m_uTotalDocs = 0;
 	uint32_t							m_uVersion = 0;
-	std::vector<std::unique_ptr<AttributeHeader_i>>	m_dHeaders;
-	std::unordered_map<std::string, HeaderWithLocator_t> m_hHeaders;
+	std::vector<HeaderEntry_t>			m_dHeaders;
+	std::unordered_map<std::string, int> m_hHeaders;
+	std::vector<std::unique_ptr<AttrPatch_c>>		m_dPatches;
 	FileReader_c						m_tReader;
-
-	const AttributeHeader_i *			GetHeader ( const std::string & sName ) const;
+	MappedBuffer_T<uint8_t>				m_tMappedFile;	// only when some headers use the mapped layout
+	mutable std::mutex					m_tHeaderLock;
+	std::atomic<uint32_t>				m_uEvictRound { 0 };
+
+	std::shared_ptr<const AttributeHeader_i>	GetHeader ( const std::string & sName, std::string & sError ) const;
+	std::shared_ptr<AttributeHeader_i>	GetHeader ( int iAttr, std::string & sError ) const;
+	AttributeHeader_i *					LoadHeader ( const HeaderEntry_t & tEntry, std::string & sError ) const;
+	const AttrPatch_c *					GetPatch ( const std::string & sName ) const;
+	bool								LoadDirectory ( int iNumAttrs, std::string & sError );
 	bool								LoadHeaders ( FileReader_c & tReader, int iNumAttrs, std::string & sError );
 	FileReader_c *						CreateFileReader() const;
-	HeaderWithLocator_t					GetHeaderForMinMax ( const Filter_t & tFilter ) const;
-	std::vector<HeaderWithLocator_t>	GetHeadersForMinMax ( const std::vector<Filter_t> & dFilters ) const;
+	HeaderWithLocator_t					GetHeaderForMinMax ( const Filter_t & tFilter, std::string & sError ) const;
+	std::vector<HeaderWithLocator_t>	GetHeadersForMinMax ( const std::vector<Filter_t> & dFilters, std::string & sError ) const;
 
-	Analyzer_i *						CreateAnalyzer ( const Filter_t & tSettings, bool bHaveMatchingBlocks ) const;
-	std::vector<BlockIterator_i *>		TryToCreatePrefilter ( const std::vector<HeaderWithLocator_t> & dHeaders, SharedBlocks_c pMatchingBlocks ) const;
-	std::vector<BlockIterator_i *>		TryToCreateAnalyzers ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, SharedBlocks_c & pMatchingBlocks ) const;
+	Analyzer_i *						CreateAnalyzer ( const Filter_t & tSettings, bool bHaveMatchingBlocks, std::string & sError ) const;
+	std::vector<BlockIterator_i *>		TryToCreatePrefilter ( const std::vector<HeaderWithLocator_t> & dHeaders, SharedBlocks_c pMatchingBlocks, const DeadRows_t * pDeadRows ) const;
+	std::vector<BlockIterator_i *>		TryToCreateAnalyzers ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, SharedBlocks_c & pMatchingBlocks, int iSubblockSize, const DeadRows_t * pDeadRows, std::string & sError ) const;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -411,6 +467,9 @@ Columnar_c::Columnar_c ( const std::string & sFilename, uint32_t uTotalDocs )
 {}
 
 
+Columnar_c::~Columnar_c() = default;
+
+
 bool Columnar_c::Setup ( std::string & sError )
 {
 	if ( !m_tReader.Open ( m_sFilename, sError ) )
@@ -427,8 +486,21 @@ bool Columnar_c::Setup ( std::string & sError )
 	if ( !iNumAttrs )
 		return true;
 
-	if ( !LoadHeaders ( m_tReader, iNumAttrs, sError ) )
-		return false;
+	// since v.15 there's a directory of headers at the end of the file; older storages load all headers right away
+	if ( m_uVersion>=15 )
+	{
+		if ( !LoadDirectory ( iNumAttrs, sError ) )
+			return false;
+	}
+	else
+	{
+		// since v.14 headers are stored after the blocks
+		if ( m_uVersion>=14 )
+			m_tReader.Seek ( m_tReader.Read_uint64() );
+
+		if ( !LoadHeaders ( m_tReader, iNumAttrs, sError ) )
+			return false;
+	}
 
 	if ( m_tReader.IsError() )
 	{
@@ -442,7 +514,11 @@ bool Columnar_c::Setup ( std::string & sError )
 
 Iterator_i * Columnar_c::CreateIterator ( const std::string & sName, const IteratorHints_t & tHints, columnar::IteratorCapabilities_t * pCapabilities, std::string & sError ) const
 {
-	const AttributeHeader_i * pHeader = GetHeader(sName);
+	const auto & tFound = m_hHeaders.find(sName);
+	if ( tFound==m_hHeaders.end() )
+		return nullptr;
+
+	auto pHeader = GetHeader ( tFound->second, sError );
 	if ( !pHeader )
 		return nullptr;
 
@@ -450,19 +526,37 @@ Iterator_i * Columnar_c::CreateIterator ( const std::string & sName, const Itera
 	if ( !pReader )
 		return nullptr;
 
+	const AttrPatch_c * pPatch = GetPatch(sName);
 	switch ( pHeader->GetType() )
 	{
 	case AttrType_e::UINT32:
 	case AttrType_e::TIMESTAMP:
 	case AttrType_e::FLOAT:
+		if ( pPatch )
+			return CreatePatchedIterator ( CreateIteratorUint32 ( *pHeader, m_uVersion, pReader.release() ), *pPatch );
+
 		return CreateIteratorUint32 ( *pHeader, m_uVersion, pReader.release() );
 
-	case AttrType_e::INT64:		return CreateIteratorUint64 ( *pHeader, m_uVersion, pReader.release() );
-	case AttrType_e::BOOLEAN:	return CreateIteratorBool ( *pHeader, pReader.release() );
+	case AttrType_e::INT64:
+		if ( pPatch )
+			return CreatePatchedIterator ( CreateIteratorUint64 ( *pHeader, m_uVersion, pReader.release() ), *pPatch );
+
+		return CreateIteratorUint64 ( *pHeader, m_uVersion, pReader.release() );
+
+	case AttrType_e::UINT64:	return CreateIteratorUint64 ( *pHeader, m_uVersion, pReader.release() );
+	case AttrType_e::BOOLEAN:
+		if ( pPatch )
+			return CreatePatchedIterator ( CreateIteratorBool ( *pHeader, pReader.release() ), *pPatch );
+
+		return CreateIteratorBool ( *pHeader, pReader.release() );
+
 	case AttrType_e::STRING:
 		if ( tHints.m_bNeedStringHashes )
 		{
-			const AttributeHeader_i * pHashHeader = GetHeader ( GenerateHashAttrName(sName) );
+			auto pHashHeader = GetHeader ( GenerateHashAttrName(sName), sError );
+			if ( !sError.empty() )
+				return nullptr;
+
 			if ( pHashHeader )
 			{
 				if ( pCapabilities )
@@ -491,9 +585,9 @@ FileReader_c * Columnar_c::CreateFileReader() const
 }
 
 
-Analyzer_i * Columnar_c::CreateAnalyzer ( const Filter_t & tSettings, bool bHaveMatchingBlocks ) const
+Analyzer_i * Columnar_c::CreateAnalyzer ( const Filter_t & tSettings, bool bHaveMatchingBlocks, std::string & sError ) const
 {
-	const AttributeHeader_i * pHeader = GetHeader ( tSettings.m_sName );
+	auto pHeader = GetHeader ( tSettings.m_sName, sError );
 	if ( !pHeader )
 		return nullptr;
 
@@ -501,6 +595,7 @@ Analyzer_i * Columnar_c::CreateAnalyzer ( const Filter_t & tSettings, bool bHave
 	if ( !pReader )
 		return nullptr;
 
+	const AttrPatch_c * pPatch = GetPatch ( tSettings.m_sName );
 	auto eType = pHeader->GetType();
 	switch ( eType )
 	{
@@ -511,10 +606,16 @@ Analyzer_i * Columnar_c::CreateAnalyzer ( const Filter_t & tSettings, bool bHave
 	{
 		Filter_t tFixedSettings = tSettings;
 		FixupFilterSettings ( tFixedSettings, eType );
+		if ( pPatch )
+			return CreatePatchedAnalyzer ( CreateAnalyzerInt ( *pHeader, m_uVersion, pReader.release(), tFixedSettings, bHaveMatchingBlocks ), *pPatch, eType, tFixedSettings );
+
 		return CreateAnalyzerInt ( *pHeader, m_uVersion, pReader.release(), tFixedSettings, bHaveMatchingBlocks );
 	}
 
 	case AttrType_e::BOOLEAN:
+		if ( pPatch )
+			return CreatePatchedAnalyzer ( CreateAnalyzerBool ( *pHeader, pReader.release(), tSettings, bHaveMatchingBlocks ), *pPatch, eType, tSettings );
+
 		return CreateAnalyzerBool ( *pHeader, pReader.release(), tSettings, bHaveMatchingBlocks );
 
 	case AttrType_e::UINT32SET:
@@ -524,7 +625,10 @@ Analyzer_i * Columnar_c::CreateAnalyzer ( const Filter_t & tSettings, bool bHave
 	case AttrType_e::STRING:
 		if ( tSettings.m_fnCalcStrHash )
 		{
-			const AttributeHeader_i * pHashHeader = GetHeader ( GenerateHashAttrName ( tSettings.m_sName ) );
+			auto pHashHeader = GetHeader ( GenerateHashAttrName ( tSettings.m_sName ), sError );
+			if ( !sError.empty() )
+				return nullptr;
+
 			if ( pHashHeader )
 				return CreateAnalyzerInt ( *pHashHeader, m_uVersion, pReader.release(), StringFilterToHashFilter ( tSettings, true ), bHaveMatchingBlocks );
 		}
@@ -537,30 +641,37 @@ Analyzer_i * Columnar_c::CreateAnalyzer ( const Filter_t & tSettings, bool bHave
 }
 
 
-HeaderWithLocator_t Columnar_c::GetHeaderForMinMax ( const Filter_t & tFilter ) const
+HeaderWithLocator_t Columnar_c::GetHeaderForMinMax ( const Filter_t & tFilter, std::string & sError ) const
 {
-	AttrInfo_t tAttrInfo;
-	if ( !GetAttrInfo ( tFilter.m_sName, tAttrInfo ) )
+	const auto & tFound = m_hHeaders.find ( tFilter.m_sName );
+	if ( tFound==m_hHeaders.end() )
 		return { nullptr, 0 };
 
-	const AttributeHeader_i * pHeader = GetHeader ( tFilter.m_sName );
+	auto pHeader = GetHeader ( tFound->second, sError );
 	if ( !pHeader || !pHeader->GetNumMinMaxLevels() )
 		return { nullptr, 0 };
 	
-	return { pHeader, tAttrInfo.m_iId };
+	return { pHeader, tFound->second };
 }
 
 
-std::vector<HeaderWithLocator_t> Columnar_c::GetHeadersForMinMax ( const std::vector<Filter_t> & dFilters ) const
+std::vector<HeaderWithLocator_t> Columnar_c::GetHeadersForMinMax ( const std::vector<Filter_t> & dFilters, std::string & sError ) const
 {
 	int iBlocks=0;
 	std::vector<HeaderWithLocator_t> dHeaders;
 	for ( const auto & i : dFilters )
 	{
-		HeaderWithLocator_t tHeader = GetHeaderForMinMax(i);
+		HeaderWithLocator_t tHeader = GetHeaderForMinMax ( i, sError );
+		if ( !sError.empty() )
+			return {};
+
 		if ( !tHeader.first )
 			continue;
 
+		// minmax trees can only be evaluated together if they were built with the same subblock size
+		if ( !dHeaders.empty() && dHeaders[0].first->GetSettings().m_iSubblockSize!=tHeader.first->GetSettings().m_iSubblockSize )
+			continue;
+
 		dHeaders.push_back(tHeader);
 		iBlocks = dHeaders.back().first->GetNumBlocks();
 	}
@@ -591,9 +702,45 @@ static void PopulateMatchingBlocks ( MatchingBlocks_c & tBlocks, int iBlockSize,
 }
 
 
-std::vector<BlockIterator_i *> Columnar_c::CreateAnalyzerOrPrefilter ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, const BlockTester_i & tBlockTester ) const
+static SharedBlocks_c RescaleMatchingBlocks ( const MatchingBlocks_c & tBlocks, int iBlockSize, int iNewBlockSize )
+{
+	SharedBlocks_c pRescaled ( new MatchingBlocks_c );
+	int iLastAdded = -1;
+	for ( int i = 0; i < tBlocks.GetNumBlocks(); i++ )
+	{
+		int64_t iMinRowID = int64_t(tBlocks.GetBlock(i))*iBlockSize;
+		int iStart = int ( iMinRowID / iNewBlockSize );
+		int iEnd = int ( ( iMinRowID + iBlockSize - 1 ) / iNewBlockSize );
+		for ( int iBlock = std::max ( iStart, iLastAdded+1 ); iBlock <= iEnd; iBlock++ )
+			pRescaled->Add(iBlock);
+
+		iLastAdded = std::max ( iLastAdded, iEnd );
+	}
+
+	return pRescaled;
+}
+
+
+static SharedBlocks_c RemoveDeadBlocks ( const MatchingBlocks_c & tBlocks, int iBlockSize, uint32_t uNumDocs, const DeadRows_t & tDeadRows )
+{
+	SharedBlocks_c pAlive ( new MatchingBlocks_c );
+	for ( int i = 0; i < tBlocks.GetNumBlocks(); i++ )
+	{
+		uint32_t tStart = uint32_t ( tBlocks.GetBlock(i) )*iBlockSize;
+		if ( !tDeadRows.AllDead ( tStart, std::min ( tStart + iBlockSize, uNumDocs ) ) )
+			pAlive->Add ( tBlocks.GetBlock(i) );
+	}
+
+	return pAlive;
+}
+
+
+std::vector<BlockIterator_i *> Columnar_c::CreateAnalyzerOrPrefilter ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, const BlockTester_i & tBlockTester, const DeadRows_t * pDeadRows, std::string & sError ) const
 {
-	std::vector<HeaderWithLocator_t> dHeaders = GetHeadersForMinMax(dFilters);
+	std::vector<HeaderWithLocator_t> dHeaders = GetHeadersForMinMax ( dFilters, sError );
+	if ( !sError.empty() )
+		return {};
+
 	SharedBlocks_c pMatchingBlocks ( dHeaders.empty() ? nullptr : new MatchingBlocks_c );
 
 	const Filter_t * pRowIdFilter = nullptr;
@@ -604,13 +751,18 @@ std::vector<BlockIterator_i *> Columnar_c::CreateAnalyzerOrPrefilter ( const std
 			break;
 		}
 
-	uint32_t uNumDocs = m_dHeaders[0]->GetNumDocs();
+	std::shared_ptr<const AttributeHeader_i> pFirstHeader = dHeaders.empty() ? GetHeader ( 0, sError ) : dHeaders[0].first;
+	if ( !pFirstHeader )
+		return {};
+
+	uint32_t uNumDocs = pFirstHeader->GetNumDocs();
 	uint32_t uMinRowID = 0;
 	uint32_t uMaxRowID = INVALID_ROW_ID;
 	if ( pRowIdFilter )
 		FetchRowIdLimits ( *pRowIdFilter, uNumDocs, uMinRowID, uMaxRowID );
 
-	int iSubblockSize = m_dHeaders[0]->GetSettings().m_iSubblockSize;
+	// matching blocks are stored in terms of the minmax leaf size
+	int iSubblockSize = pFirstHeader->GetSettings().m_iSubblockSize;
 	bool bMinMaxBlocks = !!pMatchingBlocks;
 	if ( bMinMaxBlocks )
 	{
@@ -625,6 +777,9 @@ std::vector<BlockIterator_i *> Columnar_c::CreateAnalyzerOrPrefilter ( const std
 			tMinMaxEval.Eval();
 		}
 
+		if ( pDeadRows )
+			pMatchingBlocks = RemoveDeadBlocks ( *pMatchingBlocks, iSubblockSize, uNumDocs, *pDeadRows );
+
 		int iTotalBlocks = ( uNumDocs + iSubblockSize - 1 ) / iSubblockSize;
 		if ( iTotalBlocks==pMatchingBlocks->GetNumBlocks() )
 			pMatchingBlocks = nullptr;
@@ -635,20 +790,25 @@ std::vector<BlockIterator_i *> Columnar_c::CreateAnalyzerOrPrefilter ( const std
 		PopulateMatchingBlocks ( *pMatchingBlocks, iSubblockSize, uMinRowID, uMaxRowID );
 	}
 
-	std::vector<BlockIterator_i *> dAnalyzers = TryToCreateAnalyzers ( dFilters, dDeletedFilters, pMatchingBlocks );
+	std::vector<BlockIterator_i *> dAnalyzers = TryToCreateAnalyzers ( dFilters, dDeletedFilters, pMatchingBlocks, iSubblockSize, pDeadRows, sError );
+	if ( !sError.empty() )
+		return {};
+
 	if ( !dAnalyzers.empty() )
 		return dAnalyzers;
 
 	if ( !bMinMaxBlocks )
 		return {};
 
-	return TryToCreatePrefilter ( dHeaders, pMatchingBlocks );
+	return TryToCreatePrefilter ( dHeaders, pMatchingBlocks, pDeadRows );
 }
 
 
 int64_t Columnar_c::EstimateMinMax ( const Filter_t & tFilter, const BlockTester_i & tBlockTester ) const
 {
-	HeaderWithLocator_t tHeader = GetHeaderForMinMax(tFilter);
+	// estimates only; a header that fails to load reports its error when the query creates its iterators
+	std::string sError;
+	HeaderWithLocator_t tHeader = GetHeaderForMinMax ( tFilter, sError );
 	if ( !tHeader.first )
 		return -1;
 
@@ -681,12 +841,17 @@ bool Columnar_c::GetAttrInfo ( const std::string & sName, AttrInfo_t & tInfo ) c
 	if ( tFound==m_hHeaders.end() )
 		return false;
 	
-	tInfo.m_iId = tFound->second.second;
-	tInfo.m_eType = tFound->second.first->GetType();
+	tInfo.m_iId = tFound->second;
+	tInfo.m_eType = m_dHeaders[tFound->second].m_eType;
 
 	const auto & tHashFound = m_hHeaders.find ( GenerateHashAttrName(sName) );
 	bool bHasHash = tHashFound!=m_hHeaders.end();
-	tInfo.m_fComplexity = bHasHash ? tHashFound->second.first->GetComplexity() : tFound->second.first->GetComplexity();
+
+	// the attribute exists even if its header fails to load; the error is reported when the query creates its iterators
+	std::string sError;
+	auto pHeader = GetHeader ( bHasHash ? tHashFound->second : tFound->second, sError );
+	if ( pHeader )
+		tInfo.m_fComplexity = pHeader->GetComplexity();
 
 	return true;
 }
@@ -694,7 +859,8 @@ bool Columnar_c::GetAttrInfo ( const std::string & sName, AttrInfo_t & tInfo ) c
 
 bool Columnar_c::EarlyReject ( const std::vector<Filter_t> & dFilters, const BlockTester_i & tBlockTester ) const
 {
-	std::vector<HeaderWithLocator_t> dHeaders = GetHeadersForMinMax(dFilters);
+	std::string sError;
+	std::vector<HeaderWithLocator_t> dHeaders = GetHeadersForMinMax ( dFilters, sError );
 	if ( dHeaders.empty() )
 		return false;
 
@@ -706,7 +872,8 @@ bool Columnar_c::EarlyReject ( const std::vector<Filter_t> & dFilters, const Blo
 
 bool Columnar_c::IsFilterDegenerate ( const Filter_t & tFilter ) const
 {
-	const AttributeHeader_i * pHeader = GetHeader ( tFilter.m_sName );
+	std::string sError;
+	auto pHeader = GetHeader ( tFilter.m_sName, sError );
 	if ( !pHeader )
 		return false;
 
@@ -718,40 +885,109 @@ bool Columnar_c::IsFilterDegenerate ( const Filter_t & tFilter ) const
 }
 
 
-std::vector<BlockIterator_i *> Columnar_c::TryToCreateAnalyzers ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, SharedBlocks_c & pMatchingBlocks ) const
+bool Columnar_c::UpdateAttr ( const std::string & sName, uint32_t tRowID, int64_t tValue, std::string & sError )
+{
+	const auto & tFound = m_hHeaders.find(sName);
+	if ( tFound==m_hHeaders.end() )
+	{
+		sError = FormatStr ( "attribute '%s' not found", sName.c_str() );
+		return false;
+	}
+
+	int iAttr = tFound->second;
+	auto pHeader = GetHeader ( iAttr, sError );
+	if ( !pHeader )
+		return false;
+
+	AttributeHeader_i & tHeader = *pHeader;
+	if ( tRowID>=tHeader.GetNumDocs() )
+	{
+		sError = FormatStr ( "rowid %u is out of bounds for attribute '%s'", tRowID, sName.c_str() );
+		return false;
+	}
+
+	switch ( tHeader.GetType() )
+	{
+	case AttrType_e::UINT32:
+	case AttrType_e::TIMESTAMP:
+	case AttrType_e::FLOAT:
+		tValue = (uint32_t)tValue;
+		break;
+
+	case AttrType_e::BOOLEAN:
+		tValue = !!tValue;
+		break;
+
+	case AttrType_e::INT64:
+		break;
+
+	default:
+		sError = FormatStr ( "unable to update attribute '%s': only fixed-width attributes can be updated", sName.c_str() );
+		return false;
+	}
+
+	if ( m_dPatches.empty() )
+		m_dPatches.resize ( m_dHeaders.size() );
+
+	auto & pPatch = m_dPatches[iAttr];
+	if ( !pPatch )
+		pPatch = std::make_unique<AttrPatch_c>();
+
+	pPatch->Set ( tRowID, tValue );
+	tHeader.WidenMinMax ( tRowID, tValue );
+	return true;
+}
+
+
+std::vector<BlockIterator_i *> Columnar_c::TryToCreateAnalyzers ( const std::vector<Filter_t> & dFilters, std::vector<int> & dDeletedFilters, SharedBlocks_c & pMatchingBlocks, int iSubblockSize, const DeadRows_t * pDeadRows, std::string & sError ) const
 {
 	std::vector<BlockIterator_i*> dAnalyzers;
 
 	for ( size_t i = 0; i<dFilters.size(); i++ )
 	{
 		const auto & tFilter = dFilters[i];
-		AttrInfo_t tAttrInfo;
-		if ( !GetAttrInfo ( tFilter.m_sName, tAttrInfo ) )
+		auto pHeader = GetHeader ( tFilter.m_sName, sError );
+		Analyzer_i * pAnalyzer = pHeader ? CreateAnalyzer ( tFilter, !!pMatchingBlocks, sError ) : nullptr;
+		if ( !sError.empty() )
+		{
+			for ( auto pCreated : dAnalyzers )
+				delete pCreated;
+
+			dDeletedFilters.resize ( dDeletedFilters.size()-dAnalyzers.size() );
+			return {};
+		}
+
+		if ( !pAnalyzer )
 			continue;
 
-		const AttributeHeader_i * pHeader = GetHeader ( tFilter.m_sName );
-		if ( pHeader )
+		if ( pDeadRows )
+			pAnalyzer->SetDeadRows(*pDeadRows);
+
+		int iAttrSubblockSize = pHeader->GetSettings().m_iSubblockSize;
+		if ( pMatchingBlocks && iAttrSubblockSize!=iSubblockSize )
 		{
-			Analyzer_i * pAnalyzer = CreateAnalyzer ( tFilter, !!pMatchingBlocks );
-			if ( pAnalyzer )
-			{
-				pAnalyzer->Setup ( pMatchingBlocks, pHeader->GetNumDocs() );
-				dAnalyzers.push_back(pAnalyzer);
-				dDeletedFilters.push_back ( (int)i );
-			}
+			SharedBlocks_c pRescaled = RescaleMatchingBlocks ( *pMatchingBlocks, iSubblockSize, iAttrSubblockSize );
+			pAnalyzer->Setup ( pRescaled, pHeader->GetNumDocs() );
 		}
+		else
+			pAnalyzer->Setup ( pMatchingBlocks, pHeader->GetNumDocs() );
+		dAnalyzers.push_back(pAnalyzer);
+		dDeletedFilters.push_back ( (int)i );
 	}
 
 	return dAnalyzers;
 }
 
 
-std::vector<BlockIterator_i *> Columnar_c::TryToCreatePrefilter ( const std::vector<HeaderWithLocator_t> & dHeaders, SharedBlocks_c pMatchingBlocks ) const
+std::vector<BlockIterator_i *> Columnar_c::TryToCreatePrefilter ( const std::vector<HeaderWithLocator_t> & dHeaders, SharedBlocks_c pMatchingBlocks, const DeadRows_t * pDeadRows ) const
 {
 	if ( !pMatchingBlocks )
 		return {};
 
 	std::unique_ptr<BlockIterator_c> pBlockIterator ( new BlockIterator_c );
+	if ( pDeadRows )
+		pBlockIterator->SetDeadRows(*pDeadRows);
+
 	if ( !pBlockIterator->Setup ( dHeaders, pMatchingBlocks ) )
 		pBlockIterator.reset();
 
@@ -759,29 +995,191 @@ std::vector<BlockIterator_i *> Columnar_c::TryToCreatePrefilter ( const std::vec
 }
 
 
-const AttributeHeader_i * Columnar_c::GetHeader ( const std::string & sName ) const
+int Columnar_c::EvictHeaders ( int iMaxIdleRounds )
+{
+	std::lock_guard<std::mutex> tLock(m_tHeaderLock);
+
+	int iEvicted = 0;
+	for ( size_t i = 0; i < m_dHeaders.size(); i++ )
+	{
+		auto & tEntry = m_dHeaders[i];
+		if ( !std::atomic_load ( &tEntry.m_pHeader ) || m_uEvictRound.load ( std::memory_order_relaxed ) - tEntry.m_uLastUsed.load() <= (uint32_t)iMaxIdleRounds )
+			continue;
+
+		// patched headers carry widened minmax that can't be reloaded from disk
+		if ( !m_dPatches.empty() && m_dPatches[i] )
+			continue;
+
+		// only the cache reference is dropped; live iterators and analyzers keep the header alive
+		std::atomic_store ( &tEntry.m_pHeader, std::shared_ptr<AttributeHeader_i>() );
+		iEvicted++;
+	}
+
+	m_uEvictRound.fetch_add ( 1, std::memory_order_relaxed );
+	return iEvicted;
+}
+
+
+void Columnar_c::GetMemoryUsage ( std::vector<MemoryUsage_t> & dUsage ) const
+{
+	std::lock_guard<std::mutex> tLock(m_tHeaderLock);
+
+	MemoryUsage_t tShared;
+	tShared.Add ( MemCategory_e::READER_BUFFERS, m_tReader.GetAllocatedBytes() );
+	tShared.Add ( MemCategory_e::HEADERS, m_dHeaders.capacity()*sizeof(m_dHeaders[0]) + m_dPatches.capacity()*sizeof(m_dPatches[0]) );
+	for ( const auto & tEntry : m_dHeaders )
+		tShared.Add ( MemCategory_e::HEADERS, tEntry.m_sName.capacity() );
+
+	dUsage.push_back(tShared);
+
+	for ( size_t i = 0; i < m_dHeaders.size(); i++ )
+	{
+		const auto & tEntry = m_dHeaders[i];
+		const AttrPatch_c * pPatch = m_dPatches.empty() ? nullptr : m_dPatches[i].get();
+		auto pHeader = std::atomic_load ( &tEntry.m_pHeader );
+		if ( !pHeader && !pPatch )
+			continue;
+
+		MemoryUsage_t tUsage;
+		tUsage.m_sAttr = tEntry.m_sName;
+		if ( pHeader )
+			pHeader->AddMemoryUsage(tUsage);
+
+		if ( pPatch )
+			tUsage.Add ( MemCategory_e::UPDATES, pPatch->GetValues().capacity()*sizeof(AttrPatch_c::Value_t) );
+
+		dUsage.push_back(tUsage);
+	}
+}
+
+
+std::shared_ptr<const AttributeHeader_i> Columnar_c::GetHeader ( const std::string & sName, std::string & sError ) const
+{
+	const auto & tFound = m_hHeaders.find(sName);
+	if ( tFound==m_hHeaders.end() )
+		return nullptr;
+
+	return GetHeader ( tFound->second, sError );
+}
+
+
+std::shared_ptr<AttributeHeader_i> Columnar_c::GetHeader ( int iAttr, std::string & sError ) const
+{
+	const auto & tEntry = m_dHeaders[iAttr];
+	tEntry.m_uLastUsed.store ( m_uEvictRound.load ( std::memory_order_relaxed ), std::memory_order_relaxed );
+
+	std::shared_ptr<AttributeHeader_i> pHeader = std::atomic_load ( &tEntry.m_pHeader );
+	if ( pHeader )
+		return pHeader;
+
+	std::lock_guard<std::mutex> tLock(m_tHeaderLock);
+	pHeader = std::atomic_load ( &tEntry.m_pHeader );
+	if ( pHeader )
+		return pHeader;
+
+	pHeader.reset ( LoadHeader ( tEntry, sError ) );
+	std::atomic_store ( &tEntry.m_pHeader, pHeader );
+	return pHeader;
+}
+
+
+AttributeHeader_i * Columnar_c::LoadHeader ( const HeaderEntry_t & tEntry, std::string & sError ) const
 {
+	// the shared reader is not thread-safe; a reader on the same fd is cheap
+	FileReader_c tReader ( m_tReader.GetFD() );
+	tReader.Seek ( tEntry.m_iOffset );
+
+	uint32_t uTypeWord = tReader.Read_uint32();
+	std::unique_ptr<AttributeHeader_i> pHeader ( CreateAttributeHeader ( uTypeWord, m_uTotalDocs, m_tMappedFile.begin(), sError ) );
+	if ( !pHeader )
+		return nullptr;
+
+	if ( !pHeader->Load ( tReader, sError ) )
+		return nullptr;
+
+	if ( tReader.IsError() )
+	{
+		sError = tReader.GetError();
+		return nullptr;
+	}
+
+	if ( pHeader->GetType()!=tEntry.m_eType || pHeader->GetName()!=tEntry.m_sName )
+	{
+		sError = FormatStr ( "header of attribute '%s' does not match the directory in %s", tEntry.m_sName.c_str(), m_sFilename.c_str() );
+		return nullptr;
+	}
+
+	return pHeader.release();
+}
+
+
+const AttrPatch_c * Columnar_c::GetPatch ( const std::string & sName ) const
+{
+	if ( m_dPatches.empty() )
+		return nullptr;
+
 	const auto & tFound = m_hHeaders.find(sName);
-	return tFound==m_hHeaders.end() ? nullptr : tFound->second.first;
+	if ( tFound==m_hHeaders.end() )
+		return nullptr;
+
+	return m_dPatches[tFound->second].get();
+}
+
+
+bool Columnar_c::LoadDirectory ( int iNumAttrs, std::string & sError )
+{
+	// [name][type][header_offset] for every attribute, followed by the offset of the directory itself
+	int64_t iFileSize = m_tReader.GetFileSize();
+	m_tReader.Seek ( iFileSize - (int64_t)sizeof(uint64_t) );
+	int64_t iDirectoryOffset = (int64_t)m_tReader.Read_uint64();
+	if ( iDirectoryOffset<=0 || iDirectoryOffset>=iFileSize )
+	{
+		sError = FormatStr ( "bad header directory offset in %s", m_sFilename.c_str() );
+		return false;
+	}
+
+	m_tReader.Seek(iDirectoryOffset);
+	m_dHeaders = std::vector<HeaderEntry_t>(iNumAttrs);
+	bool bHaveMapped = false;
+	for ( size_t i = 0; i < m_dHeaders.size(); i++ )
+	{
+		auto & tEntry = m_dHeaders[i];
+		tEntry.m_sName = m_tReader.Read_string();
+		uint32_t uTypeWord = m_tReader.Read_uint32();
+		tEntry.m_eType = AttrType_e ( uTypeWord & ~MAPPED_HEADER_FLAG );
+		tEntry.m_iOffset = (int64_t)m_tReader.Read_uint64();
+		m_hHeaders.insert ( { tEntry.m_sName, (int)i } );
+		bHaveMapped |= !!( uTypeWord & MAPPED_HEADER_FLAG );
+	}
+
+	// mapped headers point right into the file, so their arrays live in the page cache rather than on the heap
+	if ( bHaveMapped && !m_tMappedFile.Open ( m_sFilename, sError ) )
+		return false;
+
+	return true;
 }
 
 
 bool Columnar_c::LoadHeaders ( FileReader_c & tReader, int iNumAttrs, std::string & sError )
 {
-	m_dHeaders.resize(iNumAttrs);
+	m_dHeaders = std::vector<HeaderEntry_t>(iNumAttrs);
 
 	for ( size_t i = 0; i < m_dHeaders.size(); i++ )
 	{
-		AttrType_e eType = AttrType_e ( tReader.Read_uint32() );
-		std::unique_ptr<AttributeHeader_i> pHeader ( CreateAttributeHeader ( eType, m_uTotalDocs, sError ) );
+		auto & tEntry = m_dHeaders[i];
+		tEntry.m_iOffset = tReader.GetPos();
+		tEntry.m_eType = AttrType_e ( tReader.Read_uint32() );
+		std::unique_ptr<AttributeHeader_i> pHeader ( CreateAttributeHeader ( to_underlying ( tEntry.m_eType ), m_uTotalDocs, nullptr, sError ) );
 		if ( !pHeader )
 			return false;
 
 		if ( !pHeader->Load ( tReader, sError ) )
 			return false;
 
-		m_dHeaders[i] = std::move(pHeader);
-		m_hHeaders.insert ( { m_dHeaders[i]->GetName(), { m_dHeaders[i].get(), (int)i } } );
+		// evicted headers of older storages are reloaded from the same offset
+		tEntry.m_sName = pHeader->GetName();
+		tEntry.m_pHeader = std::move(pHeader);
+		m_hHeaders.insert ( { tEntry.m_sName, (int)i } );
 		tReader.Seek ( tReader.Read_uint64() );
 	}
 
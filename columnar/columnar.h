@@ -23,12 +23,13 @@
 #include "common/blockiterator.h"
 #include "common/filter.h"
 #include "common/schema.h"
+#include "common/memusage.h"
 #include <functional>
 
 namespace columnar
 {
 
-static const int LIB_VERSION = 25;
+static const int LIB_VERSION = 40;
 
 class Iterator_i
 {
@@ -42,7 +43,13 @@ public:
 	virtual	uint8_t *	GetPacked ( uint32_t tRowID ) = 0;
 	virtual	int			GetLength ( uint32_t tRowID ) = 0;
 
+	// decodes a FLOATVEC value into the caller's buffer; returns full vector length (values past the buffer size are not written)
+	virtual	int			GetFloatVec ( uint32_t tRowID, util::Span_T<float> & dValues ) = 0;
+
 	virtual void		AddDesc ( std::vector<common::IteratorDesc_t> & dDesc ) const = 0;
+
+	// adds the iterator's reader buffers and decoder scratch to tUsage
+	virtual void		GetMemoryUsage ( common::MemoryUsage_t & tUsage ) const = 0;
 };
 
 
@@ -84,12 +91,26 @@ public:
 	virtual					~Columnar_i() = default;
 
 	virtual Iterator_i *	CreateIterator ( const std::string & sName, const IteratorHints_t & tHints, columnar::IteratorCapabilities_t * pCapabilities, std::string & sError ) const = 0;
-	virtual std::vector<common::BlockIterator_i *> CreateAnalyzerOrPrefilter ( const std::vector<common::Filter_t> & dFilters, std::vector<int> & dDeletedFilters, const BlockTester_i & tBlockTester ) const = 0;
+	// rows marked in pDeadRows (optional; must outlive the iterators) are never returned
+	// sError is set when an attribute header fails to load; the query should fail rather than fall back to other filters
+	virtual std::vector<common::BlockIterator_i *> CreateAnalyzerOrPrefilter ( const std::vector<common::Filter_t> & dFilters, std::vector<int> & dDeletedFilters, const BlockTester_i & tBlockTester, const common::DeadRows_t * pDeadRows, std::string & sError ) const = 0;
 	virtual int64_t			EstimateMinMax ( const common::Filter_t & tFilter, const BlockTester_i & tBlockTester ) const = 0;
 	virtual bool			GetAttrInfo ( const std::string & sName, AttrInfo_t & tInfo ) const = 0;
 
 	virtual bool			EarlyReject ( const std::vector<common::Filter_t> & dFilters, const BlockTester_i & tBlockTester ) const = 0;
 	virtual bool			IsFilterDegenerate ( const common::Filter_t & tFilter ) const = 0;
+
+	// updates a fixed-width attribute (integers, floats, timestamps, bools) without rewriting the storage; floats are passed as raw bits
+	// updates are kept in memory and must not run concurrently with reads of the same storage
+	virtual bool			UpdateAttr ( const std::string & sName, uint32_t tRowID, int64_t tValue, std::string & sError ) = 0;
+
+	// headers are loaded on first use; this drops the ones not used during the last iMaxIdleRounds calls (0 means since the previous call)
+	// updated attributes are never evicted; must not run concurrently with reads of the same storage. Returns the number of evicted headers
+	virtual int				EvictHeaders ( int iMaxIdleRounds ) = 0;
+
+	// reports heap memory held by the storage: one entry per loaded attribute plus one with an empty name for shared structures
+	// memory of live iterators is reported by the iterators themselves
+	virtual void			GetMemoryUsage ( std::vector<common::MemoryUsage_t> & dUsage ) const = 0;
 };
 
 } // namespace columnar
@@ -0,0 +1,528 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "builder.h"
+#include "buildertraits.h"
+#include "builderstr.h"
+#include "builderbool.h"
+#include "builderint.h"
+#include "buildermva.h"
+#include "accessorint.h"
+#include "accessorbool.h"
+#include "accessorstr.h"
+#include "accessormva.h"
+#include "attributeheader.h"
+#include "reader.h"
+#include "threadpool.h"
+
+#include <memory>
+#include <algorithm>
+
+namespace columnar
+{
+
+using namespace util;
+using namespace common;
+
+// oldest storage version whose blocks are encoded exactly like the blocks we write
+static const uint32_t MIN_COPYABLE_VERSION = 14;
+
+class MergeSource_c
+{
+public:
+	explicit			MergeSource_c ( const MergeSource_t & tSource ) : m_tSource ( tSource ) {}
+
+	bool				Setup ( std::string & sError );
+
+	const std::string &	GetFilename() const						{ return m_tSource.m_sFile; }
+	uint32_t			GetVersion() const						{ return m_uVersion; }
+	int					GetFD() const							{ return m_tReader.GetFD(); }
+	int					GetNumAttrs() const						{ return (int)m_dHeaders.size(); }
+	const AttributeHeader_i & GetHeader ( int iAttr ) const	{ return *m_dHeaders[iAttr]; }
+	uint32_t			GetNumLiveDocs() const					{ return m_tSource.m_uTotalDocs - (uint32_t)m_tSource.m_dDeadRowIDs.size(); }
+
+	uint64_t			GetBlockSize ( uint64_t uOffset ) const;
+	void				GetLiveRows ( uint32_t tStart, uint32_t tEnd, std::vector<uint32_t> & dRowIDs ) const;
+
+private:
+	const MergeSource_t &	m_tSource;
+	FileReader_c			m_tReader;
+	uint32_t				m_uVersion = 0;
+	std::vector<std::unique_ptr<AttributeHeader_i>> m_dHeaders;
+	std::vector<uint64_t>	m_dBlockBounds;		// sorted offsets of all blocks in the file followed by the headers offset
+};
+
+
+bool MergeSource_c::Setup ( std::string & sError )
+{
+	if ( !m_tReader.Open ( m_tSource.m_sFile, sError ) )
+		return false;
+
+	m_uVersion = m_tReader.Read_uint32();
+	if ( m_uVersion > STORAGE_VERSION )
+	{
+		sError = FormatStr ( "Unable to load columnar storage: %s is v.%d, binary is v.%d", m_tSource.m_sFile.c_str(), m_uVersion, STORAGE_VERSION );
+		return false;
+	}
+
+	int iNumAttrs = (int)m_tReader.Read_uint32();
+	uint64_t uHeadersOffset = 0;
+	if ( iNumAttrs && m_uVersion>=14 )
+	{
+		uHeadersOffset = m_tReader.Read_uint64();
+		m_tReader.Seek(uHeadersOffset);
+	}
+
+	m_dHeaders.resize(iNumAttrs);
+	for ( auto & i : m_dHeaders )
+	{
+		uint32_t uTypeWord = m_tReader.Read_uint32();
+		i.reset ( CreateAttributeHeader ( uTypeWord, m_tSource.m_uTotalDocs, nullptr, sError ) );
+		if ( !i || !i->Load ( m_tReader, sError ) )
+			return false;
+
+		m_tReader.Seek ( m_tReader.Read_uint64() );
+	}
+
+	if ( m_tReader.IsError() )
+	{
+		sError = m_tReader.GetError();
+		return false;
+	}
+
+	// blocks of older storages are never copied, so there's no need to know their sizes
+	if ( m_uVersion<MIN_COPYABLE_VERSION )
+		return true;
+
+	for ( const auto & i : m_dHeaders )
+		for ( int iBlock = 0; iBlock < i->GetNumBlocks(); iBlock++ )
+			m_dBlockBounds.push_back ( i->GetBlockOffset(iBlock) );
+
+	m_dBlockBounds.push_back(uHeadersOffset);
+	std::sort ( m_dBlockBounds.begin(), m_dBlockBounds.end() );
+	return true;
+}
+
+
+uint64_t MergeSource_c::GetBlockSize ( uint64_t uOffset ) const
+{
+	// blocks of all attributes are interleaved; each one ends where the next one (or the headers) starts
+	auto tNext = std::upper_bound ( m_dBlockBounds.begin(), m_dBlockBounds.end(), uOffset );
+	assert ( tNext!=m_dBlockBounds.end() );
+	return *tNext - uOffset;
+}
+
+
+void MergeSource_c::GetLiveRows ( uint32_t tStart, uint32_t tEnd, std::vector<uint32_t> & dRowIDs ) const
+{
+	const auto & dDead = m_tSource.m_dDeadRowIDs;
+	auto tDead = std::lower_bound ( dDead.begin(), dDead.end(), tStart );
+
+	dRowIDs.resize(0);
+	for ( uint32_t tRowID = tStart; tRowID < tEnd; tRowID++ )
+	{
+		bool bDead = false;
+		while ( tDead!=dDead.end() && *tDead==tRowID )
+		{
+			bDead = true;
+			tDead++;
+		}
+
+		if ( !bDead )
+			dRowIDs.push_back(tRowID);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+class AttrMerger_c
+{
+public:
+			AttrMerger_c ( const std::vector<std::unique_ptr<MergeSource_c>> & dSources, const std::vector<uint32_t> & dLiveDocsAfter, int iAttr, Packer_i & tPacker );
+
+	bool	Merge ( std::string & sError );
+
+private:
+	const std::vector<std::unique_ptr<MergeSource_c>> & m_dSources;
+	const std::vector<uint32_t> & m_dLiveDocsAfter;
+	int						m_iAttr = 0;
+	Packer_i &				m_tPacker;
+	uint64_t				m_uOutDocs = 0;
+
+	std::vector<uint32_t>	m_dRowIDs;
+	std::vector<int64_t>	m_dValues;
+	std::vector<float>		m_dFloats;
+	std::vector<uint8_t>	m_dBlock;
+	MinMaxVec_t				m_dMinMax;
+
+	bool	CanCopyBlock ( const MergeSource_c & tSource, int iSource, int iBlock, uint32_t uLiveDocs );
+	bool	CopyBlock ( const MergeSource_c & tSource, int iBlock, std::string & sError );
+	void	AddRows ( Iterator_i & tIterator, AttrType_e eType );
+};
+
+
+AttrMerger_c::AttrMerger_c ( const std::vector<std::unique_ptr<MergeSource_c>> & dSources, const std::vector<uint32_t> & dLiveDocsAfter, int iAttr, Packer_i & tPacker )
+	: m_dSources ( dSources )
+	, m_dLiveDocsAfter ( dLiveDocsAfter )
+	, m_iAttr ( iAttr )
+	, m_tPacker ( tPacker )
+{}
+
+
+static bool SameSettings ( const Settings_t & tA, const Settings_t & tB )
+{
+	return tA.m_iSubblockSize==tB.m_iSubblockSize && tA.m_sCompressionUINT32==tB.m_sCompressionUINT32 && tA.m_sCompressionUINT64==tB.m_sCompressionUINT64;
+}
+
+
+static Iterator_i * CreateMergeIterator ( const AttributeHeader_i & tHeader, uint32_t uVersion, FileReader_c * pReader )
+{
+	switch ( tHeader.GetType() )
+	{
+	case AttrType_e::UINT32:
+	case AttrType_e::TIMESTAMP:
+	case AttrType_e::FLOAT:		return CreateIteratorUint32 ( tHeader, uVersion, pReader );
+	case AttrType_e::INT64:
+	case AttrType_e::UINT64:	return CreateIteratorUint64 ( tHeader, uVersion, pReader );
+	case AttrType_e::BOOLEAN:	return CreateIteratorBool ( tHeader, pReader );
+	case AttrType_e::STRING:	return CreateIteratorStr ( tHeader, uVersion, pReader );
+	case AttrType_e::UINT32SET:
+	case AttrType_e::INT64SET:
+	case AttrType_e::FLOATVEC:	return CreateIteratorMVA ( tHeader, uVersion, pReader );
+	default:
+		delete pReader;
+		return nullptr;
+	}
+}
+
+
+bool AttrMerger_c::CanCopyBlock ( const MergeSource_c & tSource, int iSource, int iBlock, uint32_t uLiveDocs )
+{
+	const AttributeHeader_i & tHeader = tSource.GetHeader(m_iAttr);
+	uint32_t uDocs = tHeader.GetNumDocs(iBlock);
+
+	// dead rows need re-encoding; copied blocks must start on a block boundary and only the last block of the result may be partial
+	if ( uLiveDocs!=uDocs || m_uOutDocs % DOCS_PER_BLOCK )
+		return false;
+
+	if ( uDocs!=DOCS_PER_BLOCK && m_dLiveDocsAfter[iSource] )
+		return false;
+
+	if ( tSource.GetVersion()<MIN_COPYABLE_VERSION || !SameSettings ( tHeader.GetSettings(), m_dSources[0]->GetHeader(m_iAttr).GetSettings() ) )
+		return false;
+
+	// the new minmax tree is built from the leaves of the source tree
+	m_dMinMax.resize(0);
+	int iLevels = tHeader.GetNumMinMaxLevels();
+	if ( !iLevels )
+		return tHeader.GetType()==AttrType_e::UINT64;
+
+	int iSubblockSize = tHeader.GetSettings().m_iSubblockSize;
+	int iSubblocksPerBlock = DOCS_PER_BLOCK / iSubblockSize;
+	int iFirst = iBlock*iSubblocksPerBlock;
+	int iLast = std::min ( iFirst + iSubblocksPerBlock, tHeader.GetNumMinMaxBlocks ( iLevels-1 ) );
+	for ( int i = iFirst; i < iLast; i++ )
+		m_dMinMax.push_back ( tHeader.GetMinMax ( iLevels-1, i ) );
+
+	return (int)m_dMinMax.size()==( (int)uDocs + iSubblockSize - 1 ) / iSubblockSize;
+}
+
+
+bool AttrMerger_c::CopyBlock ( const MergeSource_c & tSource, int iBlock, std::string & sError )
+{
+	uint64_t uOffset = tSource.GetHeader(m_iAttr).GetBlockOffset(iBlock);
+	m_dBlock.resize ( tSource.GetBlockSize(uOffset) );
+
+	FileReader_c tReader ( tSource.GetFD() );
+	tReader.Seek(uOffset);
+	tReader.Read ( m_dBlock.data(), m_dBlock.size() );
+	if ( tReader.IsError() )
+	{
+		sError = tReader.GetError();
+		return false;
+	}
+
+	// every block starts with its packing
+	const uint8_t * pBlock = m_dBlock.data();
+	uint32_t uPacking = ByteCodec_c::Unpack_uint32 ( [&pBlock](){ return *pBlock++; } );
+
+	m_tPacker.CopyBlock ( Span_T<uint8_t>(m_dBlock), uPacking, m_dMinMax );
+	return true;
+}
+
+
+void AttrMerger_c::AddRows ( Iterator_i & tIterator, AttrType_e eType )
+{
+	switch ( eType )
+	{
+	case AttrType_e::STRING:
+		for ( auto i : m_dRowIDs )
+		{
+			const uint8_t * pData = nullptr;
+			int iLength = tIterator.Get ( i, pData );
+			m_tPacker.AddDoc ( pData, iLength );
+		}
+		break;
+
+	case AttrType_e::UINT32SET:
+		for ( auto i : m_dRowIDs )
+		{
+			const uint8_t * pData = nullptr;
+			int iValues = tIterator.Get ( i, pData ) / sizeof(uint32_t);
+			m_dValues.resize(iValues);
+			for ( int iValue = 0; iValue < iValues; iValue++ )
+				m_dValues[iValue] = ((const uint32_t*)pData)[iValue];
+
+			m_tPacker.AddDoc ( m_dValues.data(), iValues );
+		}
+		break;
+
+	case AttrType_e::INT64SET:
+		for ( auto i : m_dRowIDs )
+		{
+			const uint8_t * pData = nullptr;
+			int iValues = tIterator.Get ( i, pData ) / sizeof(int64_t);
+			m_tPacker.AddDoc ( (const int64_t*)pData, iValues );
+		}
+		break;
+
+	case AttrType_e::FLOATVEC:
+		for ( auto i : m_dRowIDs )
+		{
+			Span_T<float> dFloats(m_dFloats);
+			int iValues = tIterator.GetFloatVec ( i, dFloats );
+			if ( iValues>(int)m_dFloats.size() )
+			{
+				m_dFloats.resize(iValues);
+				dFloats = Span_T<float>(m_dFloats);
+				tIterator.GetFloatVec ( i, dFloats );
+			}
+
+			m_dValues.resize(iValues);
+			for ( int iValue = 0; iValue < iValues; iValue++ )
+				m_dValues[iValue] = FloatToUint ( m_dFloats[iValue] );
+
+			m_tPacker.AddDoc ( m_dValues.data(), iValues );
+		}
+		break;
+
+	default:
+		{
+			m_dValues.resize ( m_dRowIDs.size() );
+			Span_T<int64_t> dValues(m_dValues);
+			tIterator.Fetch ( Span_T<uint32_t>(m_dRowIDs), dValues );
+			m_tPacker.AddDocs(dValues);
+		}
+		break;
+	}
+}
+
+
+bool AttrMerger_c::Merge ( std::string & sError )
+{
+	for ( size_t iSource = 0; iSource < m_dSources.size(); iSource++ )
+	{
+		const MergeSource_c & tSource = *m_dSources[iSource];
+		const AttributeHeader_i & tHeader = tSource.GetHeader(m_iAttr);
+		std::unique_ptr<Iterator_i> pIterator;
+
+		for ( int iBlock = 0; iBlock < tHeader.GetNumBlocks(); iBlock++ )
+		{
+			uint32_t tStart = iBlock*DOCS_PER_BLOCK;
+			tSource.GetLiveRows ( tStart, tStart + tHeader.GetNumDocs(iBlock), m_dRowIDs );
+			if ( m_dRowIDs.empty() )
+				continue;
+
+			if ( CanCopyBlock ( tSource, (int)iSource, iBlock, (uint32_t)m_dRowIDs.size() ) )
+			{
+				if ( !CopyBlock ( tSource, iBlock, sError ) )
+					return false;
+			}
+			else
+			{
+				if ( !pIterator )
+				{
+					pIterator.reset ( CreateMergeIterator ( tHeader, tSource.GetVersion(), new FileReader_c ( tSource.GetFD() ) ) );
+					if ( !pIterator )
+					{
+						sError = FormatStr ( "unable to read attribute '%s' from %s", tHeader.GetName().c_str(), tSource.GetFilename().c_str() );
+						return false;
+					}
+				}
+
+				AddRows ( *pIterator, tHeader.GetType() );
+			}
+
+			m_uOutDocs += m_dRowIDs.size();
+		}
+	}
+
+	m_tPacker.Done();
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static FloatVecStorage_e DetectFloatVecStorage ( const std::vector<std::unique_ptr<MergeSource_c>> & dSources, int iAttr )
+{
+	// keep the storage of the first encoded block; other sources are re-encoded (or copied) into the same column
+	for ( const auto & pSource : dSources )
+	{
+		const AttributeHeader_i & tHeader = pSource->GetHeader(iAttr);
+		if ( !tHeader.GetNumBlocks() )
+			continue;
+
+		FileReader_c tReader ( pSource->GetFD() );
+		tReader.Seek ( tHeader.GetBlockOffset(0) );
+		if ( tReader.Unpack_uint32()!=to_underlying ( MvaPacking_e::FLOATVEC ) )
+			return FloatVecStorage_e::DEFAULT;
+
+		tReader.Read_uint8(); // sorted flag
+		auto eStorage = FloatVecStorage_e ( tReader.Read_uint8() );
+		return ( tReader.IsError() || eStorage>=FloatVecStorage_e::TOTAL ) ? FloatVecStorage_e::DEFAULT : eStorage;
+	}
+
+	return FloatVecStorage_e::DEFAULT;
+}
+
+
+static Packer_i * CreateMergePacker ( const std::vector<std::unique_ptr<MergeSource_c>> & dSources, int iAttr )
+{
+	const AttributeHeader_i & tHeader = dSources[0]->GetHeader(iAttr);
+	const Settings_t & tSettings = tHeader.GetSettings();
+	const std::string & sName = tHeader.GetName();
+
+	switch ( tHeader.GetType() )
+	{
+	case AttrType_e::UINT32:
+	case AttrType_e::TIMESTAMP:	return CreatePackerUint32 ( tSettings, sName );
+	case AttrType_e::INT64:		return CreatePackerInt64 ( tSettings, sName );
+	case AttrType_e::UINT64:	return CreatePackerHash ( tSettings, sName, nullptr );	// hashes are copied, not recalculated
+	case AttrType_e::BOOLEAN:	return CreatePackerBool ( tSettings, sName );
+	case AttrType_e::FLOAT:		return CreatePackerFloat ( tSettings, sName );
+	case AttrType_e::STRING:	return CreatePackerStr ( tSettings, sName );
+	case AttrType_e::UINT32SET:	return CreatePackerMva32 ( tSettings, sName );
+	case AttrType_e::INT64SET:	return CreatePackerMva64 ( tSettings, sName );
+	case AttrType_e::FLOATVEC:	return CreatePackerFloatVec ( tSettings, sName, DetectFloatVecStorage ( dSources, iAttr ) );
+	default:					return nullptr;
+	}
+}
+
+
+static bool CheckSchemas ( const std::vector<std::unique_ptr<MergeSource_c>> & dSources, std::string & sError )
+{
+	const MergeSource_c & tFirst = *dSources[0];
+	for ( const auto & pSource : dSources )
+	{
+		bool bSame = pSource->GetNumAttrs()==tFirst.GetNumAttrs();
+		for ( int i = 0; bSame && i < tFirst.GetNumAttrs(); i++ )
+			bSame = pSource->GetHeader(i).GetName()==tFirst.GetHeader(i).GetName() && pSource->GetHeader(i).GetType()==tFirst.GetHeader(i).GetType();
+
+		if ( !bSame )
+		{
+			sError = FormatStr ( "schema mismatch: %s vs %s", pSource->GetFilename().c_str(), tFirst.GetFilename().c_str() );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static bool MergeStorages ( const std::vector<MergeSource_t> & dSources, const std::string & sFile, size_t tBufferSize, int iThreads, std::string & sError )
+{
+	if ( dSources.empty() )
+	{
+		sError = "no columnar storages to merge";
+		return false;
+	}
+
+	std::vector<std::unique_ptr<MergeSource_c>> dLoaded;
+	for ( const auto & i : dSources )
+	{
+		dLoaded.push_back ( std::make_unique<MergeSource_c>(i) );
+		if ( !dLoaded.back()->Setup(sError) )
+			return false;
+	}
+
+	if ( !CheckSchemas ( dLoaded, sError ) )
+		return false;
+
+	FileWriterExtents_c tBodyWriter;
+	int iNumAttrs = dLoaded[0]->GetNumAttrs();
+	std::vector<std::shared_ptr<Packer_i>> dPackers;
+	for ( int i = 0; i < iNumAttrs; i++ )
+	{
+		std::shared_ptr<Packer_i> pPacker ( CreateMergePacker ( dLoaded, i ) );
+		if ( !pPacker )
+		{
+			sError = FormatStr ( "unable to store attribute '%s' in columnar store", dLoaded[0]->GetHeader(i).GetName().c_str() );
+			return false;
+		}
+
+		pPacker->Setup(tBodyWriter);
+		dPackers.push_back(pPacker);
+	}
+
+	// don't truncate the output until every attribute is known to be mergeable
+	if ( !tBodyWriter.Open ( sFile, sizeof(uint32_t)*2 + sizeof(uint64_t), sError ) )
+		return false;
+
+	// a partial block can only be copied if it ends up last in the result
+	std::vector<uint32_t> dLiveDocsAfter ( dLoaded.size(), 0 );
+	for ( int i = (int)dLoaded.size()-2; i>=0; i-- )
+		dLiveDocsAfter[i] = dLiveDocsAfter[i+1] + dLoaded[i+1]->GetNumLiveDocs();
+
+	std::vector<std::string> dErrors ( iNumAttrs );
+	auto fnMerge = [&]( int iAttr )
+	{
+		AttrMerger_c tMerger ( dLoaded, dLiveDocsAfter, iAttr, *dPackers[iAttr] );
+		tMerger.Merge ( dErrors[iAttr] );
+	};
+
+	if ( iThreads<=0 )
+		iThreads = ThreadPool_c::GetDefaultThreads();
+
+	iThreads = std::min ( iThreads, iNumAttrs );
+	if ( iThreads>1 )
+	{
+		ThreadPool_c tPool(iThreads);
+		for ( int i = 0; i < iNumAttrs; i++ )
+			tPool.Enqueue ( [&fnMerge, i]{ fnMerge(i); } );
+
+		tPool.Wait();
+	}
+	else
+		for ( int i = 0; i < iNumAttrs; i++ )
+			fnMerge(i);
+
+	for ( const auto & i : dErrors )
+		if ( !i.empty() )
+		{
+			sError = i;
+			return false;
+		}
+
+	return WriteHeaders ( dPackers, tBodyWriter, sFile, tBufferSize, sError );
+}
+
+} // namespace columnar
+
+
+bool MergeColumnarStorages ( const std::vector<columnar::MergeSource_t> & dSources, const std::string & sFile, size_t tBufferSize, int iThreads, std::string & sError )
+{
+	return columnar::MergeStorages ( dSources, sFile, tBufferSize, iThreads, sError );
+}
@@ -24,10 +24,48 @@
 namespace common
 {
 
+// runtime counters of a single iterator; what a "block" is depends on the iterator
+// (columnar block, minmax leaf, SI block of values or rowids)
+struct IteratorStats_t
+{
+	static const int MAX_PACKINGS = 8;
+
+	int64_t	m_iBlocks = 0;					// blocks visited
+	int64_t	m_iBlocksSkipped = 0;			// blocks rejected without decoding their data
+	int64_t	m_iSubblocks = 0;				// subblocks processed
+	int64_t	m_iSubblocksMinMax = 0;			// subblocks skipped by minmax
+	int64_t	m_iSubblocksDead = 0;			// subblocks skipped because all their rows are dead
+	int64_t	m_dBlocksByPacking[MAX_PACKINGS] = {};	// visited blocks per packing id (attribute-type specific); the last slot also counts unknown ids
+	int64_t	m_iBytesRead = 0;				// bytes read from disk
+	int64_t	m_iRowsEmitted = 0;				// rowids returned to the caller
+	int64_t	m_iTimeNs = 0;					// wall time spent inside GetNextRowIdBlock (block decode and filtering combined); see SetCollectTime
+
+	// packing ids come from disk, so a corrupt file may have any value there
+	void	CountPacking ( int iPacking )	{ m_dBlocksByPacking [ ( iPacking>=0 && iPacking<MAX_PACKINGS ) ? iPacking : MAX_PACKINGS-1 ]++; }
+
+	void	Add ( const IteratorStats_t & tStats )
+	{
+		m_iBlocks += tStats.m_iBlocks;
+		m_iBlocksSkipped += tStats.m_iBlocksSkipped;
+		m_iSubblocks += tStats.m_iSubblocks;
+		m_iSubblocksMinMax += tStats.m_iSubblocksMinMax;
+		m_iSubblocksDead += tStats.m_iSubblocksDead;
+		for ( int i = 0; i < MAX_PACKINGS; i++ )
+			m_dBlocksByPacking[i] += tStats.m_dBlocksByPacking[i];
+
+		m_iBytesRead += tStats.m_iBytesRead;
+		m_iRowsEmitted += tStats.m_iRowsEmitted;
+		m_iTimeNs += tStats.m_iTimeNs;
+	}
+};
+
+
+// block iterators attach their stats so EXPLAIN-style output can show them next to the iterator
 struct IteratorDesc_t
 {
-	std::string m_sAttr;
-	std::string m_sType;
+	std::string		m_sAttr;
+	std::string		m_sType;
+	IteratorStats_t	m_tStats;
 };
 
 
@@ -44,6 +82,10 @@ public:
 	virtual bool		WasCutoffHit() const = 0;
 
 	virtual void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const = 0;
+	virtual void		GetStats ( IteratorStats_t & tStats ) const = 0;
+
+	// per-block timing costs two clock reads per GetNextRowIdBlock, so it is off until enabled; counters are always collected
+	virtual void		SetCollectTime ( bool bCollect ) = 0;
 };
 
 
@@ -72,6 +72,53 @@ struct RowidRange_t
 	uint32_t m_uMax{ std::numeric_limits<uint32_t>::max() };
 };
 
+// killed/deleted rows: bit (N & 63) of word N/64 is set if row N is dead; rows past m_uNumRows are alive
+struct DeadRows_t
+{
+	const uint64_t *	m_pBitmap = nullptr;
+	uint32_t			m_uNumRows = 0;
+
+	inline bool			IsDead ( uint32_t tRowID ) const	{ return tRowID<m_uNumRows && ( m_pBitmap[tRowID>>6] & ( 1ULL << ( tRowID & 63 ) ) ); }
+	inline bool			AllDead ( uint32_t tStart, uint32_t tEnd ) const;
+	inline uint32_t *	RemoveDead ( uint32_t * pStart, uint32_t * pEnd ) const;
+};
+
+
+bool DeadRows_t::AllDead ( uint32_t tStart, uint32_t tEnd ) const
+{
+	if ( tEnd>m_uNumRows )
+		return false;
+
+	uint32_t tRowID = tStart;
+	for ( ; tRowID<tEnd && ( tRowID & 63 ); tRowID++ )
+		if ( !IsDead(tRowID) )
+			return false;
+
+	for ( ; tRowID+64<=tEnd; tRowID+=64 )
+		if ( m_pBitmap[tRowID>>6]!=~0ULL )
+			return false;
+
+	for ( ; tRowID<tEnd; tRowID++ )
+		if ( !IsDead(tRowID) )
+			return false;
+
+	return true;
+}
+
+
+uint32_t * DeadRows_t::RemoveDead ( uint32_t * pStart, uint32_t * pEnd ) const
+{
+	// compacts sorted rowids in place; returns the new end
+	uint32_t * pOut = pStart;
+	for ( uint32_t * pRowID = pStart; pRowID<pEnd; pRowID++ )
+	{
+		*pOut = *pRowID;
+		pOut += !IsDead(*pRowID);
+	}
+
+	return pOut;
+}
+
 void		FixupFilterSettings ( Filter_t & tFilter, AttrType_e eAttrType );
 Filter_t	StringFilterToHashFilter ( const Filter_t & tFilter, bool bGenerateName );
 std::string	GenerateHashAttrName ( const std::string & sAttr );
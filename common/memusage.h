@@ -0,0 +1,61 @@
+// Copyright (c) 2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file is a part of the common headers (API).
+// If you make any significant changes to this file, you MUST bump the LIB_VERSION in columnar.h, secondary.h and knn.h
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace common
+{
+
+enum class MemCategory_e : uint32_t
+{
+	HEADERS,			// attribute headers and index meta
+	MINMAX,				// minmax trees
+	BLOCK_OFFSETS,		// block offset tables
+	PGM,				// PGM indexes
+	HNSW,				// HNSW graphs
+	READER_BUFFERS,		// file reader buffers
+	DECODE_SCRATCH,		// decoder scratch space
+	UPDATES,			// in-memory attribute updates
+
+	TOTAL
+};
+
+
+struct MemoryUsage_t
+{
+	std::string	m_sAttr;		// empty for memory that is not tied to a single attribute
+	int64_t		m_dBytes[(size_t)MemCategory_e::TOTAL] = {};
+
+	void		Add ( MemCategory_e eCategory, int64_t iBytes )	{ m_dBytes[(size_t)eCategory] += iBytes; }
+	int64_t		Get ( MemCategory_e eCategory ) const			{ return m_dBytes[(size_t)eCategory]; }
+
+	int64_t		GetTotal() const
+	{
+		int64_t iTotal = 0;
+		for ( auto i : m_dBytes )
+			iTotal += i;
+
+		return iTotal;
+	}
+};
+
+} // namespace common
@@ -16,6 +16,7 @@
 
 #include "iterator.h"
 #include "knn.h"
+#include "util/util_private.h"
 
 #include <algorithm>
 
@@ -35,6 +36,8 @@ public:
 	void	SetCutoff ( int iCutoff ) override			{}
 	bool	WasCutoffHit() const override				{ return false; }
 	void	AddDesc ( std::vector<common::IteratorDesc_t> & dDesc ) const override {}
+	void	GetStats ( common::IteratorStats_t & tStats ) const override;
+	void	SetCollectTime ( bool bCollect ) override	{}	// the search is timed once, on creation
 
 	Span_T<const DocDist_t> GetData() const override	{ return Span_T<const DocDist_t> ( m_dCollected.data(), m_dCollected.size() ); }
 
@@ -44,17 +47,28 @@ private:
 	std::vector<uint32_t>	m_dRowIDs;
 	std::vector<DocDist_t>	m_dCollected;
 	int						m_iIndex = 0;
+	int64_t					m_iSearchTimeNs = 0;
 };
 
 
 RowidIteratorKNN_c::RowidIteratorKNN_c ( KNNIndex_i & tIndex, const Span_T<float> & dData, int iResults, int iEf )
 {
+	int64_t iStartTime = GetTimeNs();
 	tIndex.Search ( m_dCollected, dData, iResults, iEf );
+	m_iSearchTimeNs = GetTimeNs()-iStartTime;
 	std::sort ( m_dCollected.begin(), m_dCollected.end(), []( const auto & a, const auto & b ) { return a.m_tRowID<b.m_tRowID; } );
 	m_dRowIDs.resize(DOCS_PER_CHUNK);
 }
 
 
+void RowidIteratorKNN_c::GetStats ( common::IteratorStats_t & tStats ) const
+{
+	// the whole search runs in the constructor; rowids are then returned from memory
+	tStats.m_iRowsEmitted = m_iIndex;
+	tStats.m_iTimeNs = m_iSearchTimeNs;
+}
+
+
 bool RowidIteratorKNN_c::HintRowID ( uint32_t tRowID )
 {
 	if ( m_iIndex>=(int)m_dCollected.size() )
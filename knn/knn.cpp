@@ -126,6 +126,7 @@ public:
 	const std::string &	GetName() const								{ return m_sName; }
 	const knn::IndexSettings_t & GetSettings() const				{ return m_tSettings; }
 	void	Search ( std::vector<DocDist_t> & dResults, const Span_T<float> & dData, int iResults, int iEf ) const override;
+	void	AddMemoryUsage ( common::MemoryUsage_t & tUsage ) const;
 
 private:
 	std::string				m_sName;
@@ -146,6 +147,19 @@ HNSWIndex_c::HNSWIndex_c ( const std::string & sName, int64_t iNumElements, cons
 }
 
 
+void HNSWIndex_c::AddMemoryUsage ( common::MemoryUsage_t & tUsage ) const
+{
+	// level 0 is a single preallocated chunk; upper levels are allocated per element
+	const auto & tAlg = *m_pAlg;
+	size_t tBytes = tAlg.max_elements_*( tAlg.size_data_per_element_ + sizeof(char*) ) + tAlg.element_levels_.capacity()*sizeof(int);
+	for ( size_t i = 0; i < tAlg.cur_element_count; i++ )
+		tBytes += tAlg.size_links_per_element_*tAlg.element_levels_[i];
+
+	tUsage.Add ( common::MemCategory_e::HNSW, tBytes );
+	tUsage.Add ( common::MemCategory_e::DECODE_SCRATCH, m_dNormalized.GetAllocatedBytes() );
+}
+
+
 bool HNSWIndex_c::AddDoc ( const Span_T<float> & dData, std::string & sError )
 {
 	if ( dData.size()!=(size_t)m_tSettings.m_iDims )
@@ -187,6 +201,7 @@ class KNN_c : public KNN_i
 public:
 	bool			Load ( const std::string & sFilename, std::string & sError ) override;
 	Iterator_i *	CreateIterator ( const std::string & sName, const Span_T<float> & dData, int iResults, int iEf, std::string & sError ) override;
+	void			GetMemoryUsage ( std::vector<common::MemoryUsage_t> & dUsage ) const override;
 
 private:
 	std::vector<std::unique_ptr<HNSWIndex_c>>		m_dIndexes;
@@ -243,6 +258,19 @@ Iterator_i * KNN_c::CreateIterator ( const std::string & sName, const Span_T<flo
 }
 
 
+void KNN_c::GetMemoryUsage ( std::vector<common::MemoryUsage_t> & dUsage ) const
+{
+	for ( const auto & i : m_dIndexes )
+	{
+		common::MemoryUsage_t tUsage;
+		tUsage.m_sAttr = i->GetName();
+		tUsage.Add ( common::MemCategory_e::HEADERS, sizeof(*i) + i->GetName().capacity() );
+		i->AddMemoryUsage(tUsage);
+		dUsage.push_back(tUsage);
+	}
+}
+
+
 HNSWIndex_c * KNN_c::GetIndex ( const std::string & sName )
 {
 	const auto & tFound = m_hIndexes.find(sName);
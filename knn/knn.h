@@ -22,11 +22,12 @@
 #include "util/util.h"
 #include "common/schema.h"
 #include "common/blockiterator.h"
+#include "common/memusage.h"
 
 namespace knn
 {
 
-static const int LIB_VERSION = 3;
+static const int LIB_VERSION = 7;
 static const uint32_t STORAGE_VERSION = 1;
 
 enum class HNSWSimilarity_e
@@ -74,6 +75,9 @@ public:
 
 	virtual bool	Load ( const std::string & sFilename, std::string & sError ) = 0;
 	virtual Iterator_i * CreateIterator ( const std::string & sName, const util::Span_T<float> & dData, int iResults, int iEf, std::string & sError ) = 0;
+
+	// reports heap memory held by the loaded indexes, one entry per attribute
+	virtual void	GetMemoryUsage ( std::vector<common::MemoryUsage_t> & dUsage ) const = 0;
 };
 
 class Builder_i
@@ -212,7 +212,9 @@ public:
 	bool		HintRowID ( uint32_t tRowID ) override;
 	bool		GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) override;
 	int64_t		GetNumProcessed() const override	{ return m_iNumProcessed; }
-	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const override { dDesc.push_back ( { m_sAttr, "SecondaryIndex" } ); }
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const override { dDesc.push_back ( { m_sAttr, "SecondaryIndex", m_tStats } ); }
+	void		GetStats ( IteratorStats_t & tStats ) const override { tStats = m_tStats; }
+	void		SetCollectTime ( bool bCollect ) override {}	// the bitmap is filled on creation, timed once per drained iterator
 
 	void		SetCutoff ( int iCutoff ) override	{ m_iRowsLeft = iCutoff; }
 	bool		WasCutoffHit() const override		{ return !m_iRowsLeft; }
@@ -228,6 +230,7 @@ private:
 	int							m_iRowsLeft = INT_MAX;
 	RowidRange_t				m_tBounds;
 	SpanResizeable_T<uint32_t>	m_dRows;
+	IteratorStats_t				m_tStats;		// blocks and bytes come from the drained iterators
 };
 
 template <typename BITMAP, bool ROWID_RANGE>
@@ -246,6 +249,7 @@ void BitmapIterator_T<BITMAP,ROWID_RANGE>::Add ( BlockIterator_i * pIterator )
 {
 	assert(pIterator);
 
+	int64_t iStartTime = GetTimeNs();
 	Span_T<uint32_t> dRowIdBlock;
 	while ( pIterator->GetNextRowIdBlock(dRowIdBlock) && m_iRowsLeft>0 )
 	{
@@ -283,6 +287,13 @@ void BitmapIterator_T<BITMAP,ROWID_RANGE>::Add ( BlockIterator_i * pIterator )
 	}
 
 	m_iRowsLeft = std::max ( m_iRowsLeft, 0 );
+
+	// rows of the drained iterator end up in the bitmap; only what we emit counts
+	IteratorStats_t tStats;
+	pIterator->GetStats(tStats);
+	tStats.m_iRowsEmitted = 0;
+	tStats.m_iTimeNs = GetTimeNs()-iStartTime;
+	m_tStats.Add(tStats);
 }
 
 template <typename BITMAP, bool ROWID_RANGE>
@@ -303,6 +314,7 @@ bool BitmapIterator_T<BITMAP,ROWID_RANGE>::GetNextRowIdBlock ( Span_T<uint32_t>
 	
 	m_tBitmap.Fetch ( m_iIndex, 0, pPtr, m_dRows.end() );
 	dRowIdBlock = Span_T<uint32_t>( pData, pPtr-pData );
+	m_tStats.m_iRowsEmitted += dRowIdBlock.size();
 
 	return !dRowIdBlock.empty();
 }
@@ -21,8 +21,9 @@
 #include "delta.h"
 #include "pgm.h"
 #include "bitvec.h"
+#include "threadpool.h"
 
-#include <queue>
+#include <future>
 
 // FastPFOR
 #include "fastpfor.h"
@@ -52,9 +53,11 @@ public:
 	virtual				~SIWriter_i() = default;
 
 	virtual bool		Setup ( const std::string & sSrcFile, uint64_t iFileSize, std::vector<uint64_t> & dOffset, std::string & sError ) = 0;
-	virtual bool		Process ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocksOff, const std::string & sPgmValuesName, std::string & sError ) = 0;
+	virtual bool		Process ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocksOff, const std::string & sPgmValuesName, int iReaderBufSize, std::string & sError ) = 0;
 	virtual const std::vector<uint8_t> & GetPGM() = 0;
 	virtual uint32_t	GetCountDistinct() const = 0;
+	virtual int			GetNumRuns() const = 0;
+	virtual int64_t		GetPGMBuildMem() const = 0;
 };
 
 
@@ -66,13 +69,16 @@ public:
 
 	virtual bool	Setup ( const std::string & sFile, const SchemaAttr_t & tAttr, int iAttr, std::string & sError ) = 0;
 	virtual int		GetItemSize () const = 0;
-	virtual void	SetItemsCount ( int iSize ) = 0;
+	virtual int64_t	GetMemUsed() const = 0;
+	virtual int		GetFreeItems() const = 0;
+	virtual void	Grow ( int iItems ) = 0;	// adds room for iItems values to the row buffer
 
 	virtual void	SetAttr ( uint32_t tRowID, int64_t tAttr ) = 0;
 	virtual void	SetAttr ( uint32_t tRowID, const uint8_t * pData, int iLength ) = 0;
 	virtual void	SetAttr ( uint32_t tRowID, const int64_t * pData, int iLength ) = 0;
 
-	virtual void	Flush () = 0;
+	virtual int64_t	DetachRows() = 0;		// moves collected rows aside for FlushDetached; returns their allocated bytes
+	virtual void	FlushDetached() = 0;	// sorts and spills detached rows, then frees them; may run on another thread
 	virtual void	Done() = 0;
 
 	virtual SIWriter_i * GetWriter ( std::string & sError ) = 0;
@@ -109,6 +115,109 @@ bool RawValueCmp< RawValue_T<float> > ( const RawValue_T<float> & tA, const RawV
 	return ( tA.m_tRowid<tB.m_tRowid );
 }
 
+/////////////////////////////////////////////////////////////////////
+
+// LSD radix sort of (value, rowid) pairs in the RawValueCmp order
+template<typename VALUE>
+class RadixSorter_T
+{
+	using RawValue_t = RawValue_T<VALUE>;
+	using Key_t = typename std::conditional<sizeof(VALUE)==8, uint64_t, uint32_t>::type;
+
+public:
+	void	Sort ( std::vector<RawValue_t> & dValues );
+	void	Reset() { VectorReset(m_dTmp); }
+
+private:
+	static const int KEY_BYTES = sizeof(Key_t);
+	static const int ROWID_BYTES = sizeof(uint32_t);
+	static const int MIN_RADIX_SORT = 256;
+
+	std::vector<RawValue_t>	m_dTmp;
+
+	static FORCE_INLINE Key_t GetKey ( VALUE tValue ) { return (Key_t)tValue; }
+};
+
+template<>
+FORCE_INLINE uint64_t RadixSorter_T<int64_t>::GetKey ( int64_t tValue )
+{
+	return uint64_t(tValue) ^ 0x8000000000000000ULL;
+}
+
+template<>
+FORCE_INLINE uint32_t RadixSorter_T<float>::GetKey ( float fValue )
+{
+	// -0.0 and 0.0 are equal for RawValueCmp, so they need the same key
+	uint32_t uValue = fValue==0.0f ? 0 : FloatToUint(fValue);
+	return ( uValue & 0x80000000 ) ? ~uValue : ( uValue | 0x80000000 );
+}
+
+template<typename VALUE>
+void RadixSorter_T<VALUE>::Sort ( std::vector<RawValue_t> & dValues )
+{
+	size_t tCount = dValues.size();
+	if ( tCount<MIN_RADIX_SORT )
+	{
+		std::sort ( dValues.begin(), dValues.end(), RawValueCmp<RawValue_t> );
+		return;
+	}
+
+	// rows usually come in rowid order; the rowid passes are only needed if they don't
+	bool bRowidSorted = true;
+	for ( size_t i = 1; i < tCount && bRowidSorted; i++ )
+		bRowidSorted = dValues[i-1].m_tRowid<=dValues[i].m_tRowid;
+
+	// histograms for all passes: rowid bytes go first, key bytes after them
+	std::vector<size_t> dHist ( ( ROWID_BYTES + KEY_BYTES )*256, 0 );
+	for ( const auto & i : dValues )
+	{
+		uint32_t uRowid = i.m_tRowid;
+		for ( int iByte = 0; iByte < ROWID_BYTES; iByte++ )
+			dHist[iByte*256 + ( ( uRowid >> ( iByte*8 ) ) & 0xFF )]++;
+
+		Key_t tKey = GetKey ( i.m_tValue );
+		for ( int iByte = 0; iByte < KEY_BYTES; iByte++ )
+			dHist[( ROWID_BYTES+iByte )*256 + ( ( tKey >> ( iByte*8 ) ) & 0xFF )]++;
+	}
+
+	m_dTmp.reserve ( dValues.capacity() );
+	m_dTmp.resize(tCount);
+	RawValue_t * pSrc = dValues.data();
+	RawValue_t * pDst = m_dTmp.data();
+
+	for ( int iPass = bRowidSorted ? ROWID_BYTES : 0; iPass < ROWID_BYTES+KEY_BYTES; iPass++ )
+	{
+		bool bRowidPass = iPass<ROWID_BYTES;
+		int iShift = ( bRowidPass ? iPass : iPass-ROWID_BYTES )*8;
+		auto fnGetByte = [bRowidPass, iShift]( const RawValue_t & tValue ) -> int
+			{ return bRowidPass ? ( tValue.m_tRowid >> iShift ) & 0xFF : int ( ( GetKey ( tValue.m_tValue ) >> iShift ) & 0xFF ); };
+
+		size_t * pHist = &dHist[iPass*256];
+
+		// all values share this byte, nothing to move
+		if ( pHist[fnGetByte(*pSrc)]==tCount )
+			continue;
+
+		size_t tOffset = 0;
+		for ( int i = 0; i < 256; i++ )
+		{
+			size_t tBucket = pHist[i];
+			pHist[i] = tOffset;
+			tOffset += tBucket;
+		}
+
+		for ( size_t i = 0; i < tCount; i++ )
+			pDst[pHist[fnGetByte(pSrc[i])]++] = pSrc[i];
+
+		std::swap ( pSrc, pDst );
+	}
+
+	if ( pSrc!=dValues.data() )
+		dValues.swap(m_dTmp);
+}
+
+/////////////////////////////////////////////////////////////////////
+
 template<typename VALUE>
 class RawWriter_T : public RawWriter_i
 {
@@ -119,8 +228,11 @@ public:
 
 	bool	Setup ( const std::string & sFile, const SchemaAttr_t & tAttr, int iAttr, std::string & sError ) final;
 	int		GetItemSize() const final { return sizeof ( m_dRows[0] ); }
-	void	SetItemsCount ( int iSize ) final { m_dRows.reserve ( iSize ); }
-	void	Flush() final;
+	int64_t	GetMemUsed() const final { return (int64_t)m_dRows.capacity()*GetItemSize(); }
+	int		GetFreeItems() const final { return int ( m_dRows.capacity()-m_dRows.size() ); }
+	void	Grow ( int iItems ) final { m_dRows.reserve ( m_dRows.capacity()+iItems ); }
+	int64_t	DetachRows() final;
+	void	FlushDetached() final;
 	void	Done() final;
 	void	SetAttr ( uint32_t tRowID, int64_t tAttr ) final;
 	void	SetAttr ( uint32_t tRowID, const uint8_t * pData, int iLength ) final;
@@ -132,10 +244,14 @@ public:
 private:
 	Settings_t				m_tSettings;
 	std::vector<RawValue_t>	m_dRows; // value, rowid
+	std::vector<RawValue_t>	m_dDetached;
+	RadixSorter_T<VALUE>	m_tSorter;
 	std::vector<uint64_t>	m_dOffset;
 	FileWriterNonBuffered_c	m_tFile;
 	SchemaAttr_t			m_tAttr;
 	uint64_t				m_iFileSize = 0;
+
+	void	WriteRun ( std::vector<RawValue_t> & dRows );
 };
 
 template<typename VALUE>
@@ -147,27 +263,43 @@ bool RawWriter_T<VALUE>::Setup ( const std::string & sFile, const SchemaAttr_t &
 }
 
 template<typename VALUE>
-void RawWriter_T<VALUE>::Flush()
+void RawWriter_T<VALUE>::WriteRun ( std::vector<RawValue_t> & dRows )
 {
-	size_t iBytesLen = sizeof( m_dRows[0] ) * m_dRows.size();
+	size_t iBytesLen = sizeof( dRows[0] ) * dRows.size();
 	if ( !iBytesLen )
 		return;
 
-	std::sort ( m_dRows.begin(), m_dRows.end(), RawValueCmp<RawValue_t> );
+	m_tSorter.Sort(dRows);
 
 	m_dOffset.emplace_back ( m_tFile.GetPos() );
-	m_tFile.Write ( (const uint8_t *)m_dRows.data(), iBytesLen );
+	m_tFile.Write ( (const uint8_t *)dRows.data(), iBytesLen );
+}
 
-	m_dRows.resize ( 0 ); 
+template<typename VALUE>
+int64_t RawWriter_T<VALUE>::DetachRows()
+{
+	assert ( m_dDetached.empty() );
+	int64_t iBytes = (int64_t)m_dRows.capacity()*GetItemSize();
+	m_dDetached.swap(m_dRows);
+	return iBytes;
+}
+
+template<typename VALUE>
+void RawWriter_T<VALUE>::FlushDetached()
+{
+	WriteRun(m_dDetached);
+	VectorReset(m_dDetached);
+	m_tSorter.Reset();
 }
 
 template<typename VALUE>
 void RawWriter_T<VALUE>::Done()
 {
-	Flush();
+	WriteRun(m_dRows);
 	m_iFileSize = m_tFile.GetPos();
 	m_tFile.Close();
 	VectorReset ( m_dRows );
+	m_tSorter.Reset();
 }
 
 // raw int writer
@@ -525,42 +657,212 @@ void RowWriter_T<VALUE, FLOAT_VALUE>::FlushBlock ( FileWriter_c & tWriter )
 
 /////////////////////////////////////////////////////////////////////
 
+// reads a sorted run in batches of values
 template<typename VALUE>
-struct BinValue_T : public RawValue_T<VALUE>
+class RunReader_T
 {
-	FileReader_c * m_pReader = nullptr;
-	int64_t m_iBinEnd = 0;
+	using RawValue_t = RawValue_T<VALUE>;
+
+public:
+	bool	Setup ( const std::string & sFile, int64_t iStart, int64_t iEnd, int iBufSize, std::string & sError );
+	bool	IsError() const { return m_tReader.IsError(); }
+	std::string GetError() const { return m_tReader.GetError(); }
+
+	FORCE_INLINE bool				IsEmpty() const	{ return m_pCur>=m_pEnd; }
+	FORCE_INLINE const RawValue_t &	Get() const		{ return *m_pCur; }
+	FORCE_INLINE const RawValue_t *	GetBatchEnd() const { return m_pEnd; }
+	FORCE_INLINE const RawValue_t *	GetBatchStart() const { return m_pCur; }
 
-	bool Read ()
+	FORCE_INLINE bool Next()
 	{
-		if ( m_pReader->GetPos()>=m_iBinEnd )
-			return false;
-		
-		m_pReader->Read ( (uint8_t *)( this ), sizeof ( RawValue_T<VALUE> ) );
-		return true;
+		m_pCur++;
+		return m_pCur<m_pEnd || ReadBatch();
 	}
+
+	bool	ReadBatch();
+
+private:
+	FileReader_c			m_tReader;
+	std::vector<RawValue_t>	m_dBatch;
+	const RawValue_t *		m_pCur = nullptr;
+	const RawValue_t *		m_pEnd = nullptr;
+	int64_t					m_iLeft = 0;
 };
 
 template<typename VALUE>
-struct PQGreater
+bool RunReader_T<VALUE>::Setup ( const std::string & sFile, int64_t iStart, int64_t iEnd, int iBufSize, std::string & sError )
+{
+	// half of the buffer goes to the file reader, the other half holds the decoded batch
+	int iBatch = std::max ( iBufSize / 2 / (int)sizeof(RawValue_t), 1 );
+	if ( !m_tReader.Open ( sFile, iBatch*(int)sizeof(RawValue_t), sError ) )
+		return false;
+
+	m_tReader.Seek(iStart);
+	m_iLeft = ( iEnd - iStart ) / sizeof(RawValue_t);
+	m_dBatch.resize(iBatch);
+	ReadBatch();
+
+	return true;
+}
+
+template<typename VALUE>
+bool RunReader_T<VALUE>::ReadBatch()
+{
+	if ( !m_iLeft || m_tReader.IsError() )
+	{
+		m_pCur = m_pEnd = nullptr;
+		return false;
+	}
+
+	size_t tCount = (size_t)std::min<int64_t> ( m_iLeft, m_dBatch.size() );
+	m_tReader.Read ( (uint8_t *)m_dBatch.data(), tCount*sizeof(RawValue_t) );
+	m_iLeft -= tCount;
+	m_pCur = m_dBatch.data();
+	m_pEnd = m_pCur + tCount;
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+// k-way merge of sorted runs over a tournament (loser) tree
+template<typename VALUE>
+class RunMerger_T
 {
-	bool operator() ( const BinValue_T<VALUE> & tA, const BinValue_T<VALUE> & tB ) const;
+	using RawValue_t = RawValue_T<VALUE>;
+
+public:
+	bool	Setup ( const std::string & sFile, const std::vector<uint64_t> & dOffset, uint64_t uFileSize, int iBufSize, std::string & sError );
+
+	template <typename ACTION>
+	bool	Merge ( ACTION && tAction, std::string & sError );
+	void	Reset() { m_dRuns.clear(); }
+
+private:
+	std::vector<std::unique_ptr<RunReader_T<VALUE>>>	m_dRuns;
+	std::vector<int>	m_dTree;	// [0] is the winner, internal nodes store losers
+
+	FORCE_INLINE bool	Less ( int iA, int iB ) const;
+	void				BuildTree();
+	FORCE_INLINE void	Replay ( int iRun );
+	bool				CheckErrors ( std::string & sError ) const;
 };
 
 template<typename VALUE>
-bool PQGreater<VALUE>::operator() ( const BinValue_T<VALUE> & tA, const BinValue_T<VALUE> & tB ) const
+bool RunMerger_T<VALUE>::Setup ( const std::string & sFile, const std::vector<uint64_t> & dOffset, uint64_t uFileSize, int iBufSize, std::string & sError )
 {
-	return ( tA.m_tValue==tB.m_tValue ? tA.m_tRowid>tB.m_tRowid : tA.m_tValue>tB.m_tValue );
+	m_dRuns.resize ( dOffset.size() );
+	for ( size_t i=0; i<dOffset.size(); i++ )
+	{
+		int64_t iEnd = i+1<dOffset.size() ? dOffset[i+1] : uFileSize;
+		m_dRuns[i] = std::make_unique<RunReader_T<VALUE>>();
+		if ( !m_dRuns[i]->Setup ( sFile, dOffset[i], iEnd, iBufSize, sError ) )
+			return false;
+	}
+
+	BuildTree();
+	return true;
 }
 
-template<>
-bool PQGreater<float>::operator() ( const BinValue_T<float> & tA, const BinValue_T<float> & tB ) const
+template<typename VALUE>
+bool RunMerger_T<VALUE>::Less ( int iA, int iB ) const
 {
-	if ( tA.m_tValue>tB.m_tValue )
-		return true;
-	if (tA.m_tValue<tB.m_tValue)
+	// exhausted runs lose every match
+	if ( m_dRuns[iA]->IsEmpty() )
 		return false;
-	return ( tA.m_tRowid>tB.m_tRowid );
+
+	if ( m_dRuns[iB]->IsEmpty() )
+		return true;
+
+	return RawValueCmp ( m_dRuns[iA]->Get(), m_dRuns[iB]->Get() );
+}
+
+template<typename VALUE>
+void RunMerger_T<VALUE>::BuildTree()
+{
+	int iRuns = (int)m_dRuns.size();
+	m_dTree.resize ( std::max ( iRuns, 1 ) );
+	if ( iRuns<=1 )
+	{
+		m_dTree[0] = 0;
+		return;
+	}
+
+	// leaves are nodes [iRuns, 2*iRuns), play the matches bottom-up
+	std::vector<int> dWinners ( iRuns*2 );
+	for ( int i=0; i<iRuns; i++ )
+		dWinners[iRuns+i] = i;
+
+	for ( int iNode=iRuns-1; iNode>0; iNode-- )
+	{
+		int iA = dWinners[iNode*2];
+		int iB = dWinners[iNode*2+1];
+		bool bALess = Less ( iA, iB );
+		dWinners[iNode] = bALess ? iA : iB;
+		m_dTree[iNode] = bALess ? iB : iA;
+	}
+
+	m_dTree[0] = dWinners[1];
+}
+
+template<typename VALUE>
+void RunMerger_T<VALUE>::Replay ( int iRun )
+{
+	int iWinner = iRun;
+	int iRuns = (int)m_dRuns.size();
+	for ( int iNode = ( iRun+iRuns )>>1; iNode>0; iNode>>=1 )
+		if ( Less ( m_dTree[iNode], iWinner ) )
+			std::swap ( m_dTree[iNode], iWinner );
+
+	m_dTree[0] = iWinner;
+}
+
+template<typename VALUE>
+bool RunMerger_T<VALUE>::CheckErrors ( std::string & sError ) const
+{
+	for ( const auto & pRun : m_dRuns )
+		if ( pRun->IsError() )
+		{
+			sError = pRun->GetError();
+			return false;
+		}
+
+	return true;
+}
+
+template<typename VALUE>
+template <typename ACTION>
+bool RunMerger_T<VALUE>::Merge ( ACTION && tAction, std::string & sError )
+{
+	if ( m_dRuns.empty() )
+		return true;
+
+	int iActive = 0;
+	for ( const auto & pRun : m_dRuns )
+		iActive += pRun->IsEmpty() ? 0 : 1;
+
+	while ( iActive>1 )
+	{
+		int iWinner = m_dTree[0];
+		auto & tRun = *m_dRuns[iWinner];
+		tAction ( tRun.Get() );
+		if ( !tRun.Next() )
+			iActive--;
+
+		Replay(iWinner);
+	}
+
+	// only one run left, no need to play matches anymore; move its values batch by batch
+	auto & tLast = *m_dRuns[m_dTree[0]];
+	while ( !tLast.IsEmpty() )
+	{
+		for ( const RawValue_t * pValue = tLast.GetBatchStart(); pValue<tLast.GetBatchEnd(); pValue++ )
+			tAction(*pValue);
+
+		tLast.ReadBatch();
+	}
+
+	return CheckErrors(sError);
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -572,9 +874,11 @@ public:
 				SIWriter_T ( const Settings_t & tSettings ) : m_tSettings ( tSettings ) {}
 
 	bool		Setup ( const std::string & sSrcFile, uint64_t iFileSize, std::vector<uint64_t> & dOffset, std::string & sError ) final;
-	bool		Process ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocksOff, const std::string & sPgmValuesName, std::string & sError ) final;
+	bool		Process ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocksOff, const std::string & sPgmValuesName, int iReaderBufSize, std::string & sError ) final;
 	const std::vector<uint8_t> & GetPGM() { return m_dPGM; }
 	uint32_t	GetCountDistinct() const final { return m_uCountDistinct; }
+	int			GetNumRuns() const final { return (int)m_dOffset.size(); }
+	int64_t		GetPGMBuildMem() const final;
 
 private:
 	Settings_t				m_tSettings;
@@ -596,70 +900,42 @@ bool SIWriter_T<SRC_VALUE, DST_VALUE>::Setup ( const std::string & sSrcName, uin
 }
 
 template<typename SRC_VALUE, typename DST_VALUE>
-bool SIWriter_T<SRC_VALUE, DST_VALUE>::Process ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocksOff, const std::string & sPgmValuesName, std::string & sError )
+bool SIWriter_T<SRC_VALUE, DST_VALUE>::Process ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocksOff, const std::string & sPgmValuesName, int iReaderBufSize, std::string & sError )
 {
 #if BUILD_PRINT_VALUES
 	std::cout << m_sSrcName << std::endl;
 #endif
 
 	FileWriter_c tTmpValsPGM;
+	tTmpValsPGM.SetBufferSize ( tTmpBlocksOff.GetBufferSize() );
 	if ( !tTmpValsPGM.Open ( sPgmValuesName, true, false, true, sError ) )
 		return false;
 
-	std::priority_queue< BinValue_T<SRC_VALUE>, std::vector < BinValue_T<SRC_VALUE> >, PQGreater<SRC_VALUE> > dBins;
-
-	std::vector<std::unique_ptr< FileReader_c > > dSrcFile ( m_dOffset.size() );
-	for ( int iReader=0; iReader<m_dOffset.size(); iReader++ )
-	{
-		FileReader_c * pReader = new FileReader_c();
-		dSrcFile[iReader].reset ( pReader );
-
-		if ( !pReader->Open ( m_sSrcName, sError ) )
-			return false;
-
-		pReader->Seek ( m_dOffset[iReader] );
-		// set file chunk end
-		int64_t iBinEnd = 0;
-		if ( iReader<m_dOffset.size()-1 )
-			iBinEnd = m_dOffset[iReader+1];
-		else
-			iBinEnd = m_iFileSize;
-
-		BinValue_T<SRC_VALUE> tBin;
-		tBin.m_pReader = pReader;
-		tBin.m_iBinEnd = iBinEnd;
-		tBin.Read();
-
-		dBins.push ( tBin );
-	}
+	RunMerger_T<SRC_VALUE> tMerger;
+	if ( !tMerger.Setup ( m_sSrcName, m_dOffset, m_iFileSize, iReaderBufSize, sError ) )
+		return false;
 
 	RowWriter_T<DST_VALUE, std::is_floating_point<SRC_VALUE>::value > tWriter ( &tTmpBlocksOff, &tTmpValsPGM, m_tSettings );
 
-	// initial fill
-	if ( dBins.size() )
-	{
-		BinValue_T<SRC_VALUE> tBin = dBins.top();
-		dBins.pop();
-		tWriter.AddValue ( Convert ( tBin ) );
-		if ( tBin.Read() )
-			dBins.push ( tBin );
-	}
-
-	while ( !dBins.empty() )
-	{
-		BinValue_T<SRC_VALUE> tBin = dBins.top();
-		dBins.pop();
-
-		tWriter.NextValue ( Convert ( tBin ), tDstFile );
-
-		if ( tBin.Read() )
-			dBins.push ( tBin );
-	}
+	bool bFirst = true;
+	bool bOk = tMerger.Merge ( [&]( const RawValue_T<SRC_VALUE> & tValue )
+		{
+			if ( bFirst )
+			{
+				tWriter.AddValue ( Convert(tValue) );
+				bFirst = false;
+			}
+			else
+				tWriter.NextValue ( Convert(tValue), tDstFile );
+		}, sError );
+
+	if ( !bOk )
+		return false;
 
 	tWriter.Done ( tDstFile );
 	m_uCountDistinct = tWriter.GetCountDistinct();
 
-	dSrcFile.clear(); // to free up memory for PGM build phase
+	tMerger.Reset(); // to free up memory for PGM build phase
 	::unlink ( m_sSrcName.c_str() );
 
 	tTmpValsPGM.Close();
@@ -683,6 +959,17 @@ bool SIWriter_T<SRC_VALUE, DST_VALUE>::Process ( FileWriter_c & tDstFile, FileWr
 	return true;
 }
 
+template<typename SRC_VALUE, typename DST_VALUE>
+int64_t SIWriter_T<SRC_VALUE, DST_VALUE>::GetPGMBuildMem() const
+{
+	// upper bound: every raw value might be distinct, every PGM segment covers at least 2*epsilon values
+	// and the built index is kept both as segments and as its serialized copy
+	const int64_t PGM_EPSILON = 8;
+	int64_t iValues = m_iFileSize / sizeof ( RawValue_T<SRC_VALUE> );
+	int64_t iSegments = iValues / ( 2*PGM_EPSILON ) + 1;
+	return iSegments * ( sizeof(SRC_VALUE) + sizeof(float) + sizeof(int32_t) ) * 2;
+}
+
 /////////////////////////////////////////////////////////////////////
 
 template<typename VALUE>
@@ -745,18 +1032,34 @@ public:
 	bool	Done ( std::string & sError ) final;
 
 private:
+	static const int MIN_GROW_ITEMS = 1024;
+
 	std::string	m_sFile;
 	size_t		m_tBufferSize = 0;
+	int64_t		m_iMemoryLimit = 0;
+	int64_t		m_iMemUsed = 0;		// row buffers that are being filled (allocated, not just used)
+	int64_t		m_iSpillMem = 0;	// rows and sort buffer of the background spill
 	uint32_t	m_tRowID = 0;
-	uint32_t	m_iMaxRows = 0;
 
 	std::vector<std::shared_ptr<RawWriter_i>>	m_dRawWriter;
 	std::vector<std::shared_ptr<SIWriter_i>>	m_dCidWriter;
 
 	std::vector<ColumnInfo_t>					m_dAttrs;
+	std::vector<int64_t>						m_dMemUsed;
 	ScopedFilesRemoval_t						m_tCleanup;
-
-	void Flush();
+	std::unique_ptr<ThreadPool_c>				m_pFlushPool;
+	std::future<void>							m_tSpill;
+
+	void ReserveValues ( int iAttr, int iValues );
+	bool FitsMemLimit ( int iAttr, int64_t iGrowth ) const;
+	void UpdateMemUsed ( int iAttr );
+	bool SpillLargest();
+	void WaitSpill();
+	void ForEachRawWriter ( const std::function<void(RawWriter_i &)> & fnAction );
+	int  CalcMergeThreads ( int & iReaderBufSize ) const;
+	bool ProcessSequential ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocks, FileWriter_c & tTmpPgm, std::vector<uint64_t> & dBlocksOffStart, int iReaderBufSize, std::string & sError );
+	bool ProcessParallel ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocks, FileWriter_c & tTmpPgm, std::vector<uint64_t> & dBlocksOffStart, int iThreads, int iReaderBufSize, std::string & sError );
+	bool AppendAttr ( const std::string & sBody, const std::string & sBlocks, FileWriter_c & tDstFile, FileWriter_c & tTmpBlocks, std::string & sError ) const;
 	bool WriteMeta ( const std::string & sPgmName, const std::string & sBlocksName, const std::vector<uint64_t> & dBlocksOffStart, const std::vector<uint64_t> & dBlocksCount, uint64_t uMetaOff, std::string & sError ) const;
 };
 
@@ -823,15 +1126,13 @@ bool Builder_c::Setup ( const Settings_t & tSettings, const Schema_t & tSchema,
 		if ( pWriter )
 			iRowSize += pWriter->GetItemSize();
 
-	m_iMaxRows = std::max ( 1000, iMemoryLimit / iRowSize );
+	// the limit is shared by all attributes: buffers grow on demand, so attributes with few values leave room for the rest
+	m_iMemoryLimit = std::max<int64_t> ( iMemoryLimit, MIN_GROW_ITEMS*iRowSize*4 );
+	m_dMemUsed.resize ( m_dRawWriter.size(), 0 );
 
-	for ( auto & pWriter : m_dRawWriter )
-	{
-		if ( !pWriter )
-			continue;
-
-		pWriter->SetItemsCount ( m_iMaxRows );
-	}
+	int iFlushThreads = std::min ( ThreadPool_c::GetDefaultThreads(), (int)m_dRawWriter.size() );
+	if ( iFlushThreads>1 )
+		m_pFlushPool = std::make_unique<ThreadPool_c>(iFlushThreads);
 
 	return true;
 }
@@ -839,38 +1140,131 @@ bool Builder_c::Setup ( const Settings_t & tSettings, const Schema_t & tSchema,
 void Builder_c::SetRowID ( uint32_t tRowID )
 {
 	m_tRowID = tRowID;
-
-	if ( ( m_tRowID % m_iMaxRows )==0 )
-		Flush();
 }
 
 void Builder_c::SetAttr ( int iAttr, int64_t tAttr )
 {
 	if ( iAttr<m_dRawWriter.size() && m_dRawWriter[iAttr] )
+	{
+		ReserveValues ( iAttr, 1 );
 		m_dRawWriter[iAttr]->SetAttr ( m_tRowID, tAttr );
+	}
 }
 
 void Builder_c::SetAttr ( int iAttr, const uint8_t * pData, int iLength )
 {
 	if ( iAttr<m_dRawWriter.size() && m_dRawWriter[iAttr] )
+	{
+		ReserveValues ( iAttr, 1 );
 		m_dRawWriter[iAttr]->SetAttr ( m_tRowID, pData, iLength );
+	}
 }
 
 void Builder_c::SetAttr ( int iAttr, const int64_t * pData, int iLength )
 {
 	if ( iAttr<m_dRawWriter.size() && m_dRawWriter[iAttr] )
+	{
+		ReserveValues ( iAttr, iLength );
 		m_dRawWriter[iAttr]->SetAttr ( m_tRowID, pData, iLength );
+	}
 }
 
-bool Builder_c::Done ( std::string & sError )
+void Builder_c::ReserveValues ( int iAttr, int iValues )
 {
-	// flush tail attributes
-	for ( auto & pWriter : m_dRawWriter )
+	RawWriter_i & tWriter = *m_dRawWriter[iAttr];
+	if ( tWriter.GetFreeItems()>=iValues )
+		return;
+
+	int iItemSize = tWriter.GetItemSize();
+	while ( true )
 	{
-		if ( pWriter )
-			pWriter->Done();
+		// try to double the buffer, then smaller steps; a spill is only forced when none of them fits
+		int64_t iCapacity = m_dMemUsed[iAttr]/iItemSize;
+		for ( int64_t iItems = std::max<int64_t> ( iCapacity, MIN_GROW_ITEMS ); iItems>=MIN_GROW_ITEMS; iItems /= 2 )
+		{
+			int64_t iGrowItems = std::max<int64_t> ( iItems, iValues );
+			if ( FitsMemLimit ( iAttr, iGrowItems*iItemSize ) )
+			{
+				tWriter.Grow ( (int)iGrowItems );
+				UpdateMemUsed(iAttr);
+				return;
+			}
+		}
+
+		// a running spill frees its rows and sort buffer once it is done
+		if ( m_tSpill.valid() )
+		{
+			WaitSpill();
+			continue;
+		}
+
+		// nothing left to spill; can only happen on a single huge MVA
+		if ( !SpillLargest() )
+		{
+			tWriter.Grow ( (int)std::max<int64_t> ( MIN_GROW_ITEMS, iValues ) );
+			UpdateMemUsed(iAttr);
+			return;
+		}
+	}
+}
+
+bool Builder_c::FitsMemLimit ( int iAttr, int64_t iGrowth ) const
+{
+	// leave room for the sort buffer of the next spill, which is as large as the largest row buffer
+	int64_t iLargest = std::max ( m_dMemUsed[iAttr] + iGrowth, *std::max_element ( m_dMemUsed.begin(), m_dMemUsed.end() ) );
+	return m_iMemUsed + iGrowth + m_iSpillMem + iLargest <= m_iMemoryLimit;
+}
+
+void Builder_c::UpdateMemUsed ( int iAttr )
+{
+	int64_t iUsed = m_dRawWriter[iAttr]->GetMemUsed();
+	m_iMemUsed += iUsed - m_dMemUsed[iAttr];
+	m_dMemUsed[iAttr] = iUsed;
+}
+
+bool Builder_c::SpillLargest()
+{
+	assert ( !m_tSpill.valid() );
+
+	// attributes that produce more values (MVA, strings) spill more often; the rest get fewer, longer runs
+	int iLargest = int ( std::max_element ( m_dMemUsed.begin(), m_dMemUsed.end() ) - m_dMemUsed.begin() );
+	if ( !m_dMemUsed[iLargest] )
+		return false;
+
+	std::shared_ptr<RawWriter_i> pWriter = m_dRawWriter[iLargest];
+	int64_t iDetached = pWriter->DetachRows();
+	UpdateMemUsed(iLargest);
+
+	if ( !m_pFlushPool )
+	{
+		pWriter->FlushDetached();
+		return true;
 	}
 
+	// the detached rows and their sort buffer stay allocated until the run is written
+	m_iSpillMem = iDetached*2;
+	auto pDone = std::make_shared<std::promise<void>>();
+	m_tSpill = pDone->get_future();
+	m_pFlushPool->Enqueue ( [pWriter, pDone]{ pWriter->FlushDetached(); pDone->set_value(); } );
+	return true;
+}
+
+void Builder_c::WaitSpill()
+{
+	if ( !m_tSpill.valid() )
+		return;
+
+	m_tSpill.get();
+	m_iSpillMem = 0;
+}
+
+bool Builder_c::Done ( std::string & sError )
+{
+	// flush tail attributes
+	WaitSpill();
+	ForEachRawWriter ( []( RawWriter_i & tWriter ){ tWriter.Done(); } );
+	m_pFlushPool.reset();
+
 	// create Secondary Index writers
 	for ( auto & pWriter : m_dRawWriter )
 	{
@@ -902,8 +1296,6 @@ bool Builder_c::Done ( std::string & sError )
 	if ( !tTmpPgm.Open ( sPgmName, true, true, true, sError ) )
 		return false;
 
-	std::string sPgmValuesName = m_sFile + ".tmp.pgmvalues";
-
 	// reserve space at main file for meta
 	tDstFile.Write_uint32 ( STORAGE_VERSION ); // storage version
 	tDstFile.Write_uint64 ( 0 ); // offset to meta itself
@@ -912,12 +1304,73 @@ bool Builder_c::Done ( std::string & sError )
 	std::vector<uint64_t> dBlocksCount ( m_dCidWriter.size() );
 
 	// process raw attributes into column index
+	int iReaderBufSize = 0;
+	int iThreads = CalcMergeThreads(iReaderBufSize);
+	bool bOk = iThreads>1 ? ProcessParallel ( tDstFile, tTmpBlocks, tTmpPgm, dBlocksOffStart, iThreads, iReaderBufSize, sError ) : ProcessSequential ( tDstFile, tTmpBlocks, tTmpPgm, dBlocksOffStart, iReaderBufSize, sError );
+	if ( !bOk )
+		return false;
+
+	int64_t iLastBlock = tTmpBlocks.GetPos();
+	for ( size_t iBlock=1; iBlock<dBlocksCount.size(); iBlock++ )
+		dBlocksCount[iBlock-1] = ( dBlocksOffStart[iBlock] - dBlocksOffStart[iBlock-1] ) / sizeof ( dBlocksOffStart[iBlock] );
+
+	dBlocksCount.back() = ( iLastBlock - dBlocksOffStart.back() ) / sizeof ( dBlocksOffStart.back() );
+
+	// meta
+	uint64_t uMetaOff = tDstFile.GetPos();
+	tDstFile.Close();
+	// close temp writers
+	tTmpBlocks.Close();
+	tTmpPgm.Close();
+
+	// write header and meta
+	ComputeDeltas ( dBlocksOffStart.data(), (int)dBlocksOffStart.size(), true );
+	return WriteMeta ( sPgmName, sBlocksName, dBlocksOffStart, dBlocksCount, uMetaOff, sError );
+}
+
+int Builder_c::CalcMergeThreads ( int & iReaderBufSize ) const
+{
+	const int MIN_READER_BUFFER = 4096;
+	const int MAX_READER_BUFFER = 65536;
+
+	// reserved by RowWriter_T for a block of values, their rows and packed rows plus per-block attributes
+	const int64_t ROW_WRITER_MEM = VALUES_PER_BLOCK * ( sizeof(uint64_t) + sizeof(uint32_t)*8 + 16*sizeof(uint32_t) + 16*2 );
+
+	int iMaxRuns = 1;
+	int64_t iMaxPGMMem = 0;
+	for ( const auto & pWriter : m_dCidWriter )
+	{
+		iMaxRuns = std::max ( iMaxRuns, pWriter->GetNumRuns() );
+		iMaxPGMMem = std::max ( iMaxPGMMem, pWriter->GetPGMBuildMem() );
+	}
+
+	// every worker holds a reader per sorted run plus writers for its block data, block offsets and PGM values
+	// the run readers are released before the PGM is built, so the PGM build only has to fit into their share
+	int64_t iWriterMem = (int64_t)m_tBufferSize*3 + ROW_WRITER_MEM;
+	int64_t iMinWorkerMem = iWriterMem + std::max ( (int64_t)iMaxRuns*MIN_READER_BUFFER, iMaxPGMMem );
+
+	int iThreads = std::min ( ThreadPool_c::GetDefaultThreads(), (int)m_dCidWriter.size() );
+	iThreads = (int)std::min<int64_t> ( iThreads, m_iMemoryLimit / iMinWorkerMem );
+	iThreads = std::max ( iThreads, 1 );
+
+	// split what is left of the budget between the run readers of each worker
+	int64_t iReaderMem = ( m_iMemoryLimit/iThreads - iWriterMem ) / iMaxRuns;
+	iReaderBufSize = (int)std::max<int64_t> ( MIN_READER_BUFFER, std::min<int64_t> ( MAX_READER_BUFFER, iReaderMem ) );
+
+	return iThreads;
+}
+
+
+bool Builder_c::ProcessSequential ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocks, FileWriter_c & tTmpPgm, std::vector<uint64_t> & dBlocksOffStart, int iReaderBufSize, std::string & sError )
+{
+	std::string sPgmValuesName = m_sFile + ".tmp.pgmvalues";
+
 	for ( size_t iWriter=0; iWriter<m_dCidWriter.size(); iWriter++ )
 	{
 		dBlocksOffStart[iWriter] = tTmpBlocks.GetPos();
 
 		auto & pWriter = m_dCidWriter[iWriter];
-		if ( !pWriter->Process ( tDstFile, tTmpBlocks, sPgmValuesName, sError ) )
+		if ( !pWriter->Process ( tDstFile, tTmpBlocks, sPgmValuesName, iReaderBufSize, sError ) )
 			return false;
 
 		// temp meta
@@ -928,24 +1381,132 @@ bool Builder_c::Done ( std::string & sError )
 		m_dCidWriter[iWriter] = nullptr;
 	}
 
-	int64_t iLastBlock = tTmpBlocks.GetPos();
-	for ( size_t iBlock=1; iBlock<dBlocksCount.size(); iBlock++ )
-		dBlocksCount[iBlock-1] = ( dBlocksOffStart[iBlock] - dBlocksOffStart[iBlock-1] ) / sizeof ( dBlocksOffStart[iBlock] );
+	return true;
+}
 
-	dBlocksCount.back() = ( iLastBlock - dBlocksOffStart.back() ) / sizeof ( dBlocksOffStart.back() );
 
-	// meta
-	uint64_t uMetaOff = tDstFile.GetPos();
-	tDstFile.Close();
-	// close temp writers
-	tTmpBlocks.Close();
-	tTmpPgm.Close();
+bool Builder_c::ProcessParallel ( FileWriter_c & tDstFile, FileWriter_c & tTmpBlocks, FileWriter_c & tTmpPgm, std::vector<uint64_t> & dBlocksOffStart, int iThreads, int iReaderBufSize, std::string & sError )
+{
+	// every attribute gets its own block data and block offsets files; these are stitched into the main file afterwards
+	int iNumAttrs = (int)m_dCidWriter.size();
+	std::vector<std::string> dBodyNames ( iNumAttrs );
+	std::vector<std::string> dBlocksNames ( iNumAttrs );
+	for ( int i = 0; i < iNumAttrs; i++ )
+	{
+		dBodyNames[i] = FormatStr ( "%s.%d.tmp.body", m_sFile.c_str(), i );
+		dBlocksNames[i] = FormatStr ( "%s.%d.tmp.meta", m_sFile.c_str(), i );
+		m_tCleanup.m_dFiles.push_back ( dBodyNames[i] );
+		m_tCleanup.m_dFiles.push_back ( dBlocksNames[i] );
+	}
 
-	// write header and meta
-	ComputeDeltas ( dBlocksOffStart.data(), (int)dBlocksOffStart.size(), true );
-	return WriteMeta ( sPgmName, sBlocksName, dBlocksOffStart, dBlocksCount, uMetaOff, sError );
+	std::vector<std::string> dErrors ( iNumAttrs );
+	auto fnProcess = [&]( int iAttr )
+	{
+		std::string & sAttrError = dErrors[iAttr];
+
+		FileWriter_c tBody;
+		tBody.SetBufferSize(m_tBufferSize);
+		if ( !tBody.Open ( dBodyNames[iAttr], true, false, false, sAttrError ) )
+			return;
+
+		FileWriter_c tBlocks;
+		tBlocks.SetBufferSize(m_tBufferSize);
+		if ( !tBlocks.Open ( dBlocksNames[iAttr], true, false, false, sAttrError ) )
+			return;
+
+		std::string sPgmValuesName = FormatStr ( "%s.%d.tmp.pgmvalues", m_sFile.c_str(), iAttr );
+		if ( !m_dCidWriter[iAttr]->Process ( tBody, tBlocks, sPgmValuesName, iReaderBufSize, sAttrError ) )
+			return;
+
+		tBody.Close();
+		tBlocks.Close();
+		if ( tBody.IsError() )
+			sAttrError = tBody.GetError();
+		else if ( tBlocks.IsError() )
+			sAttrError = tBlocks.GetError();
+	};
+
+	{
+		ThreadPool_c tPool(iThreads);
+		for ( int i = 0; i < iNumAttrs; i++ )
+			tPool.Enqueue ( [&fnProcess, i]{ fnProcess(i); } );
+
+		tPool.Wait();
+	}
+
+	for ( const auto & i : dErrors )
+		if ( !i.empty() )
+		{
+			sError = i;
+			return false;
+		}
+
+	for ( int i = 0; i < iNumAttrs; i++ )
+	{
+		dBlocksOffStart[i] = tTmpBlocks.GetPos();
+		if ( !AppendAttr ( dBodyNames[i], dBlocksNames[i], tDstFile, tTmpBlocks, sError ) )
+			return false;
+
+		auto & pWriter = m_dCidWriter[i];
+		WriteVectorLen ( pWriter->GetPGM(), tTmpPgm );
+		m_dAttrs[i].m_uCountDistinct = pWriter->GetCountDistinct();
+		pWriter = nullptr;
+	}
+
+	return true;
 }
 
+
+bool Builder_c::AppendAttr ( const std::string & sBody, const std::string & sBlocks, FileWriter_c & tDstFile, FileWriter_c & tTmpBlocks, std::string & sError ) const
+{
+	uint64_t uBodyOff = tDstFile.GetPos();
+
+	{
+		FileReader_c tReader;
+		if ( !tReader.Open ( sBody, sError ) )
+			return false;
+
+		int64_t iLeft = tReader.GetFileSize();
+		std::vector<uint8_t> dBuf ( std::max<size_t> ( tReader.GetBufferSize(), 1 ) );
+		while ( iLeft>0 && !tReader.IsError() )
+		{
+			size_t tChunk = (size_t)std::min<int64_t> ( iLeft, dBuf.size() );
+			tReader.Read ( dBuf.data(), tChunk );
+			tDstFile.Write ( dBuf.data(), tChunk );
+			iLeft -= tChunk;
+		}
+
+		if ( tReader.IsError() )
+		{
+			sError = tReader.GetError();
+			return false;
+		}
+	}
+
+	// block offsets were recorded relative to the attribute's own body
+	{
+		FileReader_c tReader;
+		if ( !tReader.Open ( sBlocks, sError ) )
+			return false;
+
+		int64_t iNumBlocks = tReader.GetFileSize() / sizeof(uint64_t);
+		for ( int64_t i = 0; i < iNumBlocks; i++ )
+			tTmpBlocks.Write_uint64 ( tReader.Read_uint64() + uBodyOff );
+
+		if ( tReader.IsError() )
+		{
+			sError = tReader.GetError();
+			return false;
+		}
+	}
+
+	::unlink ( sBody.c_str() );
+	::unlink ( sBlocks.c_str() );
+
+	return true;
+}
+
+
 bool Builder_c::WriteMeta ( const std::string & sPgmName, const std::string & sBlocksName, const std::vector<uint64_t> & dBlocksOffStart, const std::vector<uint64_t> & dBlocksCount, uint64_t uMetaOff, std::string & sError ) const
 {
 	uint64_t uNextMeta = 0;
@@ -993,23 +1554,33 @@ bool Builder_c::WriteMeta ( const std::string & sPgmName, const std::string & sB
 	return true;
 }
 
-void Builder_c::Flush()
+void Builder_c::ForEachRawWriter ( const std::function<void(RawWriter_i &)> & fnAction )
 {
-	for ( auto & pWriter : m_dRawWriter )
+	if ( !m_pFlushPool )
 	{
-		if ( pWriter )
-			pWriter->Flush();
+		for ( auto & pWriter : m_dRawWriter )
+			if ( pWriter )
+				fnAction(*pWriter);
+
+		return;
 	}
+
+	// every attribute sorts and spills into its own file
+	for ( auto & pWriter : m_dRawWriter )
+		if ( pWriter )
+			m_pFlushPool->Enqueue ( [&fnAction, pWriter]{ fnAction(*pWriter); } );
+
+	m_pFlushPool->Wait();
 }
 
 
-RawValue_T<uint32_t> Convert ( const BinValue_T<uint32_t> & tSrc )
+RawValue_T<uint32_t> Convert ( const RawValue_T<uint32_t> & tSrc )
 {
 	return tSrc;
 }
 
 
-RawValue_T<uint32_t> Convert ( const BinValue_T<float> & tSrc )
+RawValue_T<uint32_t> Convert ( const RawValue_T<float> & tSrc )
 {
 	RawValue_T<uint32_t> tRes;
 	tRes.m_tValue = FloatToUint ( tSrc.m_tValue );
@@ -1018,7 +1589,7 @@ RawValue_T<uint32_t> Convert ( const BinValue_T<float> & tSrc )
 }
 
 
-RawValue_T<uint64_t> Convert ( const BinValue_T<int64_t> & tSrc )
+RawValue_T<uint64_t> Convert ( const RawValue_T<int64_t> & tSrc )
 {
 	RawValue_T<uint64_t> tRes;
 	tRes.m_tValue = (uint64_t)tSrc.m_tValue;
@@ -1027,7 +1598,7 @@ RawValue_T<uint64_t> Convert ( const BinValue_T<int64_t> & tSrc )
 }
 
 
-RawValue_T<uint64_t> Convert ( const BinValue_T<uint64_t> & tSrc )
+RawValue_T<uint64_t> Convert ( const RawValue_T<uint64_t> & tSrc )
 {
 	return tSrc;
 }
@@ -34,9 +34,11 @@ public:
 
 	bool		HintRowID ( uint32_t tRowID ) override;
 	bool		GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) override;
-	int64_t		GetNumProcessed() const override { return 0; }
+	int64_t		GetNumProcessed() const override { return m_tStats.m_iRowsEmitted; }
 
-	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const override { dDesc.push_back ( { m_sAttr, "SecondaryIndex" } ); }
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const override { dDesc.push_back ( { m_sAttr, "SecondaryIndex", m_tStats } ); }
+	void		GetStats ( IteratorStats_t & tStats ) const override { tStats = m_tStats; }
+	void		SetCollectTime ( bool bCollect ) override { m_bCollectTime = bCollect; }
 
 	void		SetCutoff ( int iCutoff ) override {}
 	bool		WasCutoffHit() const override { return false; }
@@ -59,6 +61,7 @@ private:
 	bool				m_bStarted = false;
 	bool				m_bStopped = false;
 	bool				m_bNeedToRewind = true;
+	bool				m_bCollectTime = false;
 
 	int					m_iCurBlock = 0;
 	SpanResizeable_T<uint32_t>	m_dRows;
@@ -66,7 +69,9 @@ private:
 	SpanResizeable_T<uint32_t>	m_dBlockOffsets;
 	SpanResizeable_T<uint32_t>	m_dTmp;
 	BitVec_T<uint64_t>	m_dMatchingBlocks{0};
+	IteratorStats_t		m_tStats;
 
+	FORCE_INLINE bool	DoGetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock );
 	bool				StartBlock ( Span_T<uint32_t> & dRowIdBlock );
 	FORCE_INLINE bool	ReadNextBlock ( Span_T<uint32_t> & dRowIdBlock );
 
@@ -146,6 +151,23 @@ bool RowidIterator_T<ROWID_RANGE>::GetNextRowIdBlock ( Span_T<uint32_t> & dRowId
 	if ( m_bStopped )
 		return false;
 
+	// the reader can be shared with other iterators, so only count what was read during this call
+	int64_t iStartTime = m_bCollectTime ? GetTimeNs() : 0;
+	int64_t iBytesRead = m_pReader->GetBytesRead();
+	bool bResult = DoGetNextRowIdBlock(dRowIdBlock);
+	if ( bResult )
+		m_tStats.m_iRowsEmitted += dRowIdBlock.size();
+
+	m_tStats.m_iBytesRead += m_pReader->GetBytesRead()-iBytesRead;
+	if ( m_bCollectTime )
+		m_tStats.m_iTimeNs += GetTimeNs()-iStartTime;
+
+	return bResult;
+}
+
+template <bool ROWID_RANGE>
+bool RowidIterator_T<ROWID_RANGE>::DoGetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock )
+{
 	if ( !m_bStarted )
 		return StartBlock ( dRowIdBlock );
 
@@ -181,6 +203,7 @@ uint32_t RowidIterator_T<true>::MarkMatchingBlocks()
 			uSet++;
 		}
 
+	m_tStats.m_iBlocksSkipped += m_dBlockOffsets.size() - uSet;
 	return uSet;
 }
 
@@ -188,6 +211,7 @@ template <bool ROWID_RANGE>
 bool RowidIterator_T<ROWID_RANGE>::StartBlock ( Span_T<uint32_t> & dRowIdBlock )
 {
 	m_bStarted = true;
+	m_tStats.CountPacking ( (int)to_underlying(m_eType) );
 	switch ( m_eType )
 	{
 	case Packing_e::ROW:
@@ -259,6 +283,7 @@ bool RowidIterator_T<ROWID_RANGE>::ReadNextBlock ( Span_T<uint32_t> & dRowIdBloc
 	iBlockSize -= iBlockOffset;
 
 	m_pReader->Seek ( m_iDataOffset + ( iBlockOffset << 2 ) );
+	m_tStats.m_iBlocks++;
 
 	m_dTmp.resize(iBlockSize);
 	ReadVectorData ( m_dTmp, *m_pReader );
@@ -304,6 +329,7 @@ void RowidIterator_T<ROWID_RANGE>::Setup ( Packing_e eType, uint64_t uStartOffse
 	m_bNeedToRewind = true;
 
 	m_iCurBlock = 0;
+	m_tStats = IteratorStats_t();
 	m_dRows.resize(0);
 	m_dMinMax.resize(0);
 	m_dBlockOffsets.resize(0);
@@ -314,6 +340,51 @@ void RowidIterator_T<ROWID_RANGE>::Setup ( Packing_e eType, uint64_t uStartOffse
 
 /////////////////////////////////////////////////////////////////////
 
+// drops dead rows from the rowid blocks of the wrapped iterator
+class DeadRowsIterator_c : public BlockIterator_i
+{
+public:
+				DeadRowsIterator_c ( BlockIterator_i * pIterator, const DeadRows_t & tDeadRows ) : m_pIterator ( pIterator ), m_tDeadRows ( tDeadRows ) {}
+
+	bool		HintRowID ( uint32_t tRowID ) override					{ return m_pIterator->HintRowID(tRowID); }
+	bool		GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock ) override;
+	int64_t		GetNumProcessed() const override						{ return m_pIterator->GetNumProcessed(); }
+
+	void		AddDesc ( std::vector<IteratorDesc_t> & dDesc ) const override { m_pIterator->AddDesc(dDesc); }
+	void		GetStats ( IteratorStats_t & tStats ) const override	{ m_pIterator->GetStats(tStats); }
+	void		SetCollectTime ( bool bCollect ) override				{ m_pIterator->SetCollectTime(bCollect); }
+
+	void		SetCutoff ( int iCutoff ) override						{ m_pIterator->SetCutoff(iCutoff); }
+	bool		WasCutoffHit() const override							{ return m_pIterator->WasCutoffHit(); }
+
+private:
+	std::unique_ptr<BlockIterator_i>	m_pIterator;
+	DeadRows_t							m_tDeadRows;
+	std::vector<uint32_t>				m_dRows;
+};
+
+
+bool DeadRowsIterator_c::GetNextRowIdBlock ( Span_T<uint32_t> & dRowIdBlock )
+{
+	// rowids are copied as the wrapped iterator may hand out its cached blocks again
+	Span_T<uint32_t> dRows;
+	while ( m_pIterator->GetNextRowIdBlock(dRows) )
+	{
+		m_dRows.resize ( dRows.size() );
+		memcpy ( m_dRows.data(), dRows.data(), dRows.size()*sizeof(dRows[0]) );
+		m_dRows.resize ( m_tDeadRows.RemoveDead ( m_dRows.data(), m_dRows.data() + m_dRows.size() ) - m_dRows.data() );
+		if ( !m_dRows.empty() )
+		{
+			dRowIdBlock = Span_T<uint32_t>(m_dRows);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 BlockIteratorWithSetup_i * CreateRowidIterator ( const std::string & sAttr, Packing_e eType, uint64_t uStartOffset, uint32_t uMinRowID, uint32_t uMaxRowID, uint32_t uCount, uint32_t uRowidsPerBlock, std::shared_ptr<FileReader_c> & pSharedReader, std::shared_ptr<IntCodec_i> & pCodec, const RowidRange_t * pBounds, bool bBitmap )
 {
 	if ( pBounds )
@@ -344,4 +415,10 @@ bool SetupRowidIterator ( BlockIteratorWithSetup_i * pIterator, Packing_e eType,
 	return true;
 }
 
+
+BlockIterator_i * CreateDeadRowsIterator ( BlockIterator_i * pIterator, const DeadRows_t & tDeadRows )
+{
+	return new DeadRowsIterator_c ( pIterator, tDeadRows );
+}
+
 }
\ No newline at end of file
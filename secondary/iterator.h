@@ -38,5 +38,6 @@ public:
 
 BlockIteratorWithSetup_i *	CreateRowidIterator ( const std::string & sAttr, Packing_e eType, uint64_t uStartOffset, uint32_t uMinRowID, uint32_t uMaxRowID, uint32_t uCount, uint32_t uRowidsPerBlock, std::shared_ptr<util::FileReader_c> & pSharedReader, std::shared_ptr<util::IntCodec_i> & pCodec, const common::RowidRange_t * pBounds, bool bBitmap );
 bool						SetupRowidIterator ( BlockIteratorWithSetup_i * pIterator, Packing_e eType, uint64_t uStartOffset, uint32_t uMinRowID, uint32_t uMaxRowID, uint32_t uCount, const common::RowidRange_t * pBounds );
+common::BlockIterator_i *	CreateDeadRowsIterator ( common::BlockIterator_i * pIterator, const common::DeadRows_t & tDeadRows );
 
 }
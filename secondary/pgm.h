@@ -38,6 +38,7 @@ namespace SI
 		virtual void		Load ( util::FileReader_c & tRd ) = 0;
 		virtual ApproxPos_t	Search ( uint64_t uVal ) const = 0;
 		virtual bool		IsEmpty() const = 0;
+		virtual size_t		GetAllocatedBytes() const = 0;
 	};
 
 	template <typename VALUE>
@@ -106,6 +107,7 @@ namespace SI
 		void		WriteTypedKey ( util::MemWriter_c & tWr, VALUE tVal ) const		{ tWr.Pack_uint64 ( (uint64_t)tVal ); }
 		void		LoadTypedKey ( util::FileReader_c & tRd, VALUE  & tVal ) const	{ tVal = tRd.Unpack_uint64(); }
 		bool		IsEmpty () const final											{ return this->n==0; }
+		size_t		GetAllocatedBytes() const final									{ return this->segments.capacity()*sizeof(this->segments[0]) + ( this->levels_sizes.capacity() + this->levels_offsets.capacity() )*sizeof(size_t); }
 	};
 
 	template<>
@@ -20,6 +20,7 @@
 #include "delta.h"
 #include "codec.h"
 #include "blockreader.h"
+#include "iterator.h"
 #include "bitvec.h"
 
 #include <unordered_map>
@@ -35,13 +36,14 @@ class SecondaryIndex_c : public Index_i
 public:
 	bool		Setup ( const std::string & sFile, std::string & sError );
 
-	bool		CreateIterators ( std::vector<BlockIterator_i *> & dIterators, const Filter_t & tFilter, const RowidRange_t * pBounds, uint32_t uMaxValues, int64_t iRsetSize, int iCutoff, std::string & sError ) const override;
+	bool		CreateIterators ( std::vector<BlockIterator_i *> & dIterators, const Filter_t & tFilter, const RowidRange_t * pBounds, uint32_t uMaxValues, int64_t iRsetSize, int iCutoff, const DeadRows_t * pDeadRows, std::string & sError ) const override;
 	bool		CalcCount ( uint32_t & uCount, const common::Filter_t & tFilter, uint32_t uMaxValues, std::string & sError ) const override;
 	uint32_t	GetNumIterators ( const common::Filter_t & tFilter ) const override;
 	bool		IsEnabled ( const std::string & sName ) const override;
 	int64_t		GetCountDistinct ( const std::string & sName ) const override;
 	bool		SaveMeta ( std::string & sError ) override;
 	void		ColumnUpdated ( const char * sName ) override;
+	void		GetMemoryUsage ( std::vector<MemoryUsage_t> & dUsage ) const override;
 
 private:
 	Settings_t	m_tSettings;
@@ -241,6 +243,27 @@ void SecondaryIndex_c::ColumnUpdated ( const char * sName )
 }
 
 
+void SecondaryIndex_c::GetMemoryUsage ( std::vector<MemoryUsage_t> & dUsage ) const
+{
+	MemoryUsage_t tShared;
+	tShared.Add ( MemCategory_e::READER_BUFFERS, m_tReader.GetAllocatedBytes() );
+	tShared.Add ( MemCategory_e::HEADERS, m_dAttrs.capacity()*sizeof(m_dAttrs[0]) + m_dIdx.capacity()*sizeof(m_dIdx[0]) );
+	dUsage.push_back(tShared);
+
+	for ( size_t i = 0; i < m_dAttrs.size(); i++ )
+	{
+		MemoryUsage_t tUsage;
+		tUsage.m_sAttr = m_dAttrs[i].m_sName;
+		tUsage.Add ( MemCategory_e::HEADERS, m_dAttrs[i].m_sName.capacity() );
+		tUsage.Add ( MemCategory_e::BLOCK_OFFSETS, sizeof(m_dBlockStartOff[0]) + sizeof(m_dBlocksCount[0]) );
+		if ( i<m_dIdx.size() && m_dIdx[i] )
+			tUsage.Add ( MemCategory_e::PGM, m_dIdx[i]->GetAllocatedBytes() );
+
+		dUsage.push_back(tUsage);
+	}
+}
+
+
 bool SecondaryIndex_c::PrepareBlocksValues ( const Filter_t & tFilter, std::vector<BlockIter_t> * pBlocksIt, uint64_t & uBlockBaseOff, int64_t & iNumIterators, uint64_t & uBlocksCount ) const
 {
 	iNumIterators = 0;
@@ -439,7 +462,7 @@ const ColumnInfo_t * SecondaryIndex_c::GetAttr ( const Filter_t & tFilter, std::
 }
 
 
-bool SecondaryIndex_c::CreateIterators ( std::vector<BlockIterator_i *> & dIterators, const Filter_t & tFilter, const RowidRange_t * pBounds, uint32_t uMaxValues, int64_t iRsetSize, int iCutoff, std::string & sError ) const
+bool SecondaryIndex_c::CreateIterators ( std::vector<BlockIterator_i *> & dIterators, const Filter_t & tFilter, const RowidRange_t * pBounds, uint32_t uMaxValues, int64_t iRsetSize, int iCutoff, const DeadRows_t * pDeadRows, std::string & sError ) const
 {
 	const auto * pCol = GetAttr ( tFilter, sError );
 	if ( !pCol )
@@ -449,21 +472,28 @@ bool SecondaryIndex_c::CreateIterators ( std::vector<BlockIterator_i *> & dItera
 	if ( !FixupFilter ( tFixedFilter, tFilter, *pCol ) )
 		return false;
 
+	size_t tFirstNew = dIterators.size();
 	switch ( tFixedFilter.m_eType )
 	{
 	case FilterType_e::VALUES:
 		GetValsRows ( &dIterators, tFixedFilter, pBounds, uMaxValues, iRsetSize, iCutoff );
-		return true;
+		break;
 
 	case FilterType_e::RANGE:
 	case FilterType_e::FLOATRANGE:
 		GetRangeRows ( &dIterators, tFixedFilter, pBounds, uMaxValues, iRsetSize, iCutoff );
-		return true;
+		break;
 
 	default:
 		sError = FormatStr ( "unhandled filter type '%d'", to_underlying ( tFixedFilter.m_eType ) );
 		return false;
 	}
+
+	if ( pDeadRows )
+		for ( size_t i = tFirstNew; i < dIterators.size(); i++ )
+			dIterators[i] = CreateDeadRowsIterator ( dIterators[i], *pDeadRows );
+
+	return true;
 }
 
 
@@ -21,6 +21,7 @@
 
 #include "util/util.h"
 #include "common/schema.h"
+#include "common/memusage.h"
 
 namespace util
 {
@@ -32,13 +33,14 @@ namespace common
 {
 	struct Filter_t;
 	struct RowidRange_t;
+	struct DeadRows_t;
 	class BlockIterator_i;
 }
 
 namespace SI
 {
 
-static const int LIB_VERSION = 14;
+static const int LIB_VERSION = 19;
 static const uint32_t STORAGE_VERSION = 8;
 
 class Index_i
@@ -46,13 +48,17 @@ class Index_i
 public:
 	virtual				~Index_i() = default;
 
-	virtual bool		CreateIterators ( std::vector<common::BlockIterator_i *> & dIterators, const common::Filter_t & tFilter, const common::RowidRange_t * pBounds, uint32_t uMaxValues, int64_t iRsetSize, int iCutoff, std::string & sError ) const = 0;
+	// rows marked in pDeadRows (optional; must outlive the iterators) are never returned
+	virtual bool		CreateIterators ( std::vector<common::BlockIterator_i *> & dIterators, const common::Filter_t & tFilter, const common::RowidRange_t * pBounds, uint32_t uMaxValues, int64_t iRsetSize, int iCutoff, const common::DeadRows_t * pDeadRows, std::string & sError ) const = 0;
 	virtual bool		CalcCount ( uint32_t & uCount, const common::Filter_t & tFilter, uint32_t uMaxValues, std::string & sError ) const = 0;
 	virtual uint32_t	GetNumIterators ( const common::Filter_t & tFilter ) const = 0;
 	virtual bool		IsEnabled ( const std::string & sName ) const = 0;
 	virtual int64_t		GetCountDistinct ( const std::string & sName ) const = 0;
 	virtual bool		SaveMeta ( std::string & sError ) = 0;
 	virtual void		ColumnUpdated ( const char * sName ) = 0;
+
+	// reports heap memory held by the index: one entry per attribute plus one with an empty name for shared structures
+	virtual void		GetMemoryUsage ( std::vector<common::MemoryUsage_t> & dUsage ) const = 0;
 };
 
 class Builder_i;
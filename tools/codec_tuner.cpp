@@ -0,0 +1,119 @@
+// Copyright (c) 2020-2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// benchmarks integer codecs on the attributes of an existing columnar storage and prints per-attribute recommendations
+// usage: columnar_codec_tuner [--blocks N] [--rounds N] [--min-decode-speed F] [--json] <file> <num_docs> <attr> [<attr> ...]
+
+#include "builder.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace columnar;
+
+static void PrintUsage()
+{
+	printf ( "usage: columnar_codec_tuner [--blocks N] [--rounds N] [--min-decode-speed F] [--json] <file> <num_docs> <attr> [<attr> ...]\n" );
+}
+
+
+static void PrintText ( const std::vector<CodecTuneResult_t> & dResults )
+{
+	for ( const auto & tResult : dResults )
+	{
+		printf ( "%s (%s)\n", tResult.m_sAttr.c_str(), tResult.m_bUINT64 ? "uint64" : "uint32" );
+		printf ( "  %-22s %8s %12s %12s\n", "codec", "ratio", "enc MB/s", "dec MB/s" );
+		for ( const auto & i : tResult.m_dStats )
+			printf ( "%c %-22s %8.3f %12.1f %12.1f\n", i.m_sCodec==tResult.m_sRecommended ? '*' : ' ', i.m_sCodec.c_str(), double(i.m_iUncompressedBytes)/std::max<int64_t> ( i.m_iCompressedBytes, 1 ), i.m_fEncodeMBs, i.m_fDecodeMBs );
+
+		printf ( "  recommended: %s=%s\n\n", tResult.m_bUINT64 ? "compression_uint64" : "compression_uint32", tResult.m_sRecommended.c_str() );
+	}
+}
+
+
+static void PrintJson ( const std::vector<CodecTuneResult_t> & dResults )
+{
+	printf ( "[\n" );
+	for ( size_t iResult = 0; iResult < dResults.size(); iResult++ )
+	{
+		const auto & tResult = dResults[iResult];
+		printf ( "  { \"attr\": \"%s\", \"width\": %d, \"recommended\": \"%s\", \"codecs\": [\n", tResult.m_sAttr.c_str(), tResult.m_bUINT64 ? 64 : 32, tResult.m_sRecommended.c_str() );
+		for ( size_t i = 0; i < tResult.m_dStats.size(); i++ )
+		{
+			const auto & tStats = tResult.m_dStats[i];
+			printf ( "    { \"codec\": \"%s\", \"uncompressed_bytes\": %lld, \"compressed_bytes\": %lld, \"encode_mbs\": %.1f, \"decode_mbs\": %.1f }%s\n",
+				tStats.m_sCodec.c_str(), (long long)tStats.m_iUncompressedBytes, (long long)tStats.m_iCompressedBytes, tStats.m_fEncodeMBs, tStats.m_fDecodeMBs, i+1<tResult.m_dStats.size() ? "," : "" );
+		}
+
+		printf ( "  ] }%s\n", iResult+1<dResults.size() ? "," : "" );
+	}
+	printf ( "]\n" );
+}
+
+
+int main ( int argc, char ** argv )
+{
+	CodecTuneSettings_t tSettings;
+	bool bJson = false;
+	std::vector<std::string> dArgs;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		std::string sArg = argv[i];
+		bool bHaveValue = i+1 < argc;
+		if ( sArg=="--blocks" && bHaveValue )					tSettings.m_iSampleBlocks = atoi ( argv[++i] );
+		else if ( sArg=="--rounds" && bHaveValue )				tSettings.m_iRounds = atoi ( argv[++i] );
+		else if ( sArg=="--min-decode-speed" && bHaveValue )	tSettings.m_fMinDecodeSpeed = (float)atof ( argv[++i] );
+		else if ( sArg=="--json" )								bJson = true;
+		else if ( sArg.size()>1 && sArg[0]=='-' )
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+			dArgs.push_back(sArg);
+	}
+
+	if ( dArgs.size()<3 )
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// attribute types are taken from the storage; only the names matter here
+	Schema_t tSchema;
+	for ( size_t i = 2; i < dArgs.size(); i++ )
+	{
+		AttrWithSettings_t tAttr;
+		tAttr.m_sName = dArgs[i];
+		tSchema.push_back(tAttr);
+	}
+
+	std::vector<CodecTuneResult_t> dResults;
+	std::string sError;
+	if ( !TuneColumnarCodecs ( dArgs[0], (uint32_t)strtoul ( dArgs[1].c_str(), nullptr, 10 ), tSchema, tSettings, dResults, sError ) )
+	{
+		fprintf ( stderr, "error: %s\n", sError.c_str() );
+		return 1;
+	}
+
+	if ( bJson )
+		PrintJson(dResults);
+	else
+		PrintText(dResults);
+
+	return 0;
+}
@@ -84,7 +84,7 @@ static FORCE_INLINE bool Decode ( const util::Span_T<uint32_t> & dCompressed, ut
 }
 
 
-FastPForLib::IntegerCODEC * CreateFastPFORCodec ( const std::string & sName )
+static FastPForLib::IntegerCODEC * TryToCreateFastPFORCodec ( const std::string & sName )
 {
 	using namespace FastPForLib;
 
@@ -121,10 +121,17 @@ FastPForLib::IntegerCODEC * CreateFastPFORCodec ( const std::string & sName )
 	if ( sName=="simdgroupsimple_ringbuf" )	return new CompositeCodec<SIMDGroupSimple<true, true>, VariableByte>;
 	if ( sName=="copy" )					return new JustCopy;
 
-	assert ( 0 && "Unknown integer codec" );
 	return nullptr;
 }
 
+
+FastPForLib::IntegerCODEC * CreateFastPFORCodec ( const std::string & sName )
+{
+	FastPForLib::IntegerCODEC * pCodec = TryToCreateFastPFORCodec(sName);
+	assert ( pCodec && "Unknown integer codec" );
+	return pCodec;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 class Int32FastPFORCodec_c
@@ -288,6 +295,24 @@ void BitUnpack ( const util::Span_T<uint32_t> & dPacked, util::Span_T<uint32_t>
 }
 
 
+bool CheckIntCodec ( const std::string & sCodec32, const std::string & sCodec64, std::string & sError )
+{
+	if ( sCodec32!="libstreamvbyte" && !std::unique_ptr<FastPForLib::IntegerCODEC> ( TryToCreateFastPFORCodec(sCodec32) ) )
+	{
+		sError = FormatStr ( "Unknown uint32 codec '%s'", sCodec32.c_str() );
+		return false;
+	}
+
+	if ( !std::unique_ptr<FastPForLib::IntegerCODEC> ( TryToCreateFastPFORCodec(sCodec64) ) )
+	{
+		sError = FormatStr ( "Unknown uint64 codec '%s'", sCodec64.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+
 IntCodec_i * CreateIntCodec ( const std::string & sCodec32, const std::string & sCodec64 )
 {
 	if ( sCodec32=="libstreamvbyte" )
@@ -296,4 +321,74 @@ IntCodec_i * CreateIntCodec ( const std::string & sCodec32, const std::string &
 	return new IntCodec_T<Int32FastPFORCodec_c, Int64FastPFORCodec_c> ( sCodec32, sCodec64 );
 }
 
+
+const std::vector<std::string> & GetIntCodecs32()
+{
+	// simple9/16/8b and simdgroupsimple are left out: they can't encode values wider than 28 bits
+	static const std::vector<std::string> dCodecs = { "libstreamvbyte", "fastpfor128", "fastpfor256", "simdfastpfor128", "simdfastpfor256", "simdbinarypacking",
+		"fastbinarypacking8", "fastbinarypacking16", "fastbinarypacking32", "simdpfor", "simplepfor", "simdsimplepfor", "varint", "varintgb", "maskedvbyte", "streamvbyte" };
+	return dCodecs;
+}
+
+
+const std::vector<std::string> & GetIntCodecs64()
+{
+	// only these implement 64-bit encoding in FastPFOR
+	static const std::vector<std::string> dCodecs = { "fastpfor128", "fastpfor256", "varint" };
+	return dCodecs;
+}
+
+
+template <typename T>
+static bool BenchmarkIntCodec ( IntCodec_i & tCodec, std::vector<std::vector<T>> & dChunks, int iRounds, IntCodecBench_t & tResult )
+{
+	std::vector<std::vector<uint32_t>> dCompressed ( dChunks.size() );
+	SpanResizeable_T<T> dDecompressed;
+
+	tResult = IntCodecBench_t();
+	tResult.m_iEncodeTimeNs = tResult.m_iDecodeTimeNs = INT64_MAX;
+	for ( const auto & i : dChunks )
+		tResult.m_iUncompressedBytes += i.size()*sizeof(T);
+
+	for ( int iRound = 0; iRound < std::max ( iRounds, 1 ); iRound++ )
+	{
+		int64_t iStart = GetTimeNs();
+		for ( size_t i = 0; i < dChunks.size(); i++ )
+			tCodec.Encode ( Span_T<T> ( dChunks[i] ), dCompressed[i] );
+
+		tResult.m_iEncodeTimeNs = std::min ( tResult.m_iEncodeTimeNs, GetTimeNs()-iStart );
+
+		iStart = GetTimeNs();
+		for ( size_t i = 0; i < dChunks.size(); i++ )
+		{
+			// libstreamvbyte doesn't store the number of values
+			dDecompressed.resize ( dChunks[i].size() );
+			tCodec.Decode ( Span_T<uint32_t> ( dCompressed[i] ), dDecompressed );
+			if ( !iRound && ( dDecompressed.size()!=dChunks[i].size() || memcmp ( dDecompressed.data(), dChunks[i].data(), dChunks[i].size()*sizeof(T) ) ) )
+				return false;
+		}
+
+		tResult.m_iDecodeTimeNs = std::min ( tResult.m_iDecodeTimeNs, GetTimeNs()-iStart );
+	}
+
+	for ( const auto & i : dCompressed )
+		tResult.m_iCompressedBytes += i.size()*sizeof(i[0]);
+
+	return true;
+}
+
+
+bool BenchmarkIntCodec ( const std::string & sCodec, std::vector<std::vector<uint32_t>> & dChunks, int iRounds, IntCodecBench_t & tResult )
+{
+	std::unique_ptr<IntCodec_i> pCodec ( CreateIntCodec ( sCodec, "fastpfor256" ) );
+	return BenchmarkIntCodec ( *pCodec, dChunks, iRounds, tResult );
+}
+
+
+bool BenchmarkIntCodec ( const std::string & sCodec, std::vector<std::vector<uint64_t>> & dChunks, int iRounds, IntCodecBench_t & tResult )
+{
+	std::unique_ptr<IntCodec_i> pCodec ( CreateIntCodec ( "libstreamvbyte", sCodec ) );
+	return BenchmarkIntCodec ( *pCodec, dChunks, iRounds, tResult );
+}
+
 } // namespace util
\ No newline at end of file
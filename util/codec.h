@@ -45,5 +45,22 @@ void BitUnpack ( const std::vector<uint32_t> & dPacked, std::vector<uint32_t> &
 void BitUnpack ( const util::Span_T<uint32_t> & dPacked, util::Span_T<uint32_t> & dValues, int iBits );
 
 IntCodec_i * CreateIntCodec ( const std::string & sCodec32, const std::string & sCodec64 );
+bool		CheckIntCodec ( const std::string & sCodec32, const std::string & sCodec64, std::string & sError );
+
+// codecs that can be used for uint32/uint64 values and are safe for any input
+const std::vector<std::string> & GetIntCodecs32();
+const std::vector<std::string> & GetIntCodecs64();
+
+struct IntCodecBench_t
+{
+	int64_t	m_iUncompressedBytes = 0;
+	int64_t	m_iCompressedBytes = 0;
+	int64_t	m_iEncodeTimeNs = 0;	// best of all rounds
+	int64_t	m_iDecodeTimeNs = 0;	// best of all rounds
+};
+
+// encodes and decodes every chunk with the given uint32 or uint64 codec; returns false if decoded values don't match
+bool		BenchmarkIntCodec ( const std::string & sCodec, std::vector<std::vector<uint32_t>> & dChunks, int iRounds, IntCodecBench_t & tResult );
+bool		BenchmarkIntCodec ( const std::string & sCodec, std::vector<std::vector<uint64_t>> & dChunks, int iRounds, IntCodecBench_t & tResult );
 
 } // namespace util
@@ -178,6 +178,7 @@ bool FileReader_c::ReadToBuffer()
 	m_tUsed = iRead;
 	m_tPtr = 0;
 	m_iFilePos = iNewFilePos;
+	m_iBytesRead += iRead;
 
 	return true;
 }
@@ -35,6 +35,8 @@ public:
 
 	int64_t					GetPos() const			{ return m_iFilePos+m_tPtr; }
 	size_t					GetBufferSize() const	{ return m_tSize; }
+	size_t					GetAllocatedBytes() const { return m_pData ? m_tSize : 0; }	// the buffer is allocated on first read
+	int64_t					GetBytesRead() const	{ return m_iBytesRead; }
 	int						GetFD() const			{ return m_iFD; }
 	const std::string &		GetFilename() const		{ return m_sFile; }
 	int64_t					GetFileSize();
@@ -98,6 +100,7 @@ private:
 	size_t      m_tPtr = 0;
 
 	int64_t     m_iFilePos = 0;
+	int64_t     m_iBytesRead = 0;
 
 	bool        m_bError = false;
 	std::string m_sError;
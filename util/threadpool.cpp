@@ -0,0 +1,96 @@
+// Copyright (c) 2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace util
+{
+
+ThreadPool_c::ThreadPool_c ( int iThreads )
+{
+	iThreads = std::max ( iThreads, 1 );
+	for ( int i = 0; i < iThreads; i++ )
+		m_dThreads.emplace_back ( [this]{ WorkerFunc(); } );
+}
+
+
+ThreadPool_c::~ThreadPool_c()
+{
+	{
+		std::unique_lock<std::mutex> tLock(m_tLock);
+		m_bStop = true;
+	}
+
+	m_tJobAdded.notify_all();
+	for ( auto & i : m_dThreads )
+		i.join();
+}
+
+
+void ThreadPool_c::Enqueue ( std::function<void()> && fnJob )
+{
+	{
+		std::unique_lock<std::mutex> tLock(m_tLock);
+		m_dJobs.push_back ( std::move(fnJob) );
+	}
+
+	m_tJobAdded.notify_one();
+}
+
+
+void ThreadPool_c::Wait()
+{
+	std::unique_lock<std::mutex> tLock(m_tLock);
+	m_tJobDone.wait ( tLock, [this]{ return m_dJobs.empty() && !m_iRunning; } );
+}
+
+
+int ThreadPool_c::GetDefaultThreads()
+{
+	return std::max ( (int)std::thread::hardware_concurrency(), 1 );
+}
+
+
+void ThreadPool_c::WorkerFunc()
+{
+	while ( true )
+	{
+		std::function<void()> fnJob;
+		{
+			std::unique_lock<std::mutex> tLock(m_tLock);
+			m_tJobAdded.wait ( tLock, [this]{ return m_bStop || !m_dJobs.empty(); } );
+			if ( m_dJobs.empty() )
+				return;
+
+			fnJob = std::move ( m_dJobs.front() );
+			m_dJobs.pop_front();
+			m_iRunning++;
+		}
+
+		fnJob();
+
+		{
+			std::unique_lock<std::mutex> tLock(m_tLock);
+			m_iRunning--;
+		}
+
+		m_tJobDone.notify_all();
+	}
+}
+
+} // namespace util
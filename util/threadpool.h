@@ -0,0 +1,54 @@
+// Copyright (c) 2024, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace util
+{
+
+// fixed-size pool of worker threads; jobs run in FIFO order
+class ThreadPool_c
+{
+public:
+	explicit	ThreadPool_c ( int iThreads );
+			~ThreadPool_c();
+
+	void	Enqueue ( std::function<void()> && fnJob );
+	void	Wait();		// waits until all enqueued jobs are finished
+	int		GetNumThreads() const { return (int)m_dThreads.size(); }
+
+	static int GetDefaultThreads();
+
+private:
+	std::vector<std::thread>			m_dThreads;
+	std::deque<std::function<void()>>	m_dJobs;
+	std::mutex							m_tLock;
+	std::condition_variable				m_tJobAdded;
+	std::condition_variable				m_tJobDone;
+	int									m_iRunning = 0;
+	bool								m_bStop = false;
+
+	void	WorkerFunc();
+};
+
+} // namespace util
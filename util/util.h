@@ -119,6 +119,8 @@ public:
 		BASE::m_tLength = tLength;
 	}
 
+	size_t			GetAllocatedBytes() const { return m_dData.capacity()*sizeof(T); }
+
 private:
 	std::vector<T>	m_dData;
 	size_t			m_tMaxLength = 0;
@@ -22,6 +22,9 @@
 #include <limits>
 
 #ifdef _MSC_VER
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
 	#include <io.h>
 #else
 	#include <unistd.h>
@@ -44,6 +47,25 @@ int CalcNumBits ( uint64_t uNumber )
 }
 
 
+BitIndexTable_t::BitIndexTable_t()
+{
+	for ( int i = 0; i < 256; i++ )
+	{
+		int iCount = 0;
+		for ( int iBit = 0; iBit < 8; iBit++ )
+			if ( i & ( 1<<iBit ) )
+				m_dIndexes[i][iCount++] = (uint8_t)iBit;
+
+		for ( int iBit = iCount; iBit < 8; iBit++ )
+			m_dIndexes[i][iBit] = 0;
+
+		m_dCount[i] = (uint8_t)iCount;
+	}
+}
+
+const BitIndexTable_t g_tBitIndexTable;
+
+
 void NormalizeVec ( util::Span_T<float> & dData )
 {
 	float fNorm = 0.0f;
@@ -375,6 +397,141 @@ void FileWriterNonBuffered_c::Seek ( int64_t iOffset )
 
 /////////////////////////////////////////////////////////////////////
 
+#ifdef _MSC_VER
+static bool PwriteWrapper ( int iFD, const uint8_t * pData, size_t tLength, int64_t iOffset )
+{
+	HANDLE hFile = (HANDLE)_get_osfhandle(iFD);
+	if ( hFile==INVALID_HANDLE_VALUE )
+		return false;
+
+	while ( tLength )
+	{
+		OVERLAPPED tOverlapped;
+		memset ( &tOverlapped, 0, sizeof(OVERLAPPED) );
+		tOverlapped.Offset = (DWORD)( iOffset & 0xFFFFFFFFULL );
+		tOverlapped.OffsetHigh = (DWORD)( iOffset>>32 );
+
+		DWORD uWritten = 0;
+		DWORD uToWrite = (DWORD)std::min ( tLength, (size_t)0x40000000 );
+		if ( !WriteFile ( hFile, pData, uToWrite, &uWritten, &tOverlapped ) )
+			return false;
+
+		pData += uWritten;
+		iOffset += uWritten;
+		tLength -= uWritten;
+	}
+
+	return true;
+}
+#else
+#if HAVE_PWRITE
+static bool PwriteWrapper ( int iFD, const uint8_t * pData, size_t tLength, int64_t iOffset )
+{
+	while ( tLength )
+	{
+		ssize_t iWritten = ::pwrite ( iFD, pData, tLength, (off_t)iOffset );
+		if ( iWritten<0 )
+		{
+			if ( errno==EINTR )
+				continue;
+
+			return false;
+		}
+
+		pData += iWritten;
+		iOffset += iWritten;
+		tLength -= (size_t)iWritten;
+	}
+
+	return true;
+}
+#else
+static bool PwriteWrapper ( int iFD, const uint8_t * pData, size_t tLength, int64_t iOffset )
+{
+	// no positional writes; seek+write pairs have to be serialized
+	static std::mutex tLock;
+	std::unique_lock<std::mutex> tGuard(tLock);
+
+	if ( lseek ( iFD, (off_t)iOffset, SEEK_SET )==(off_t)-1 )
+		return false;
+
+	while ( tLength )
+	{
+		ssize_t iWritten = ::write ( iFD, pData, tLength );
+		if ( iWritten<0 )
+			return false;
+
+		pData += iWritten;
+		tLength -= (size_t)iWritten;
+	}
+
+	return true;
+}
+#endif
+#endif // _MSC_VER
+
+
+FileWriterExtents_c::~FileWriterExtents_c()
+{
+	Close();
+}
+
+
+bool FileWriterExtents_c::Open ( const std::string & sFile, int64_t iStartOffset, std::string & sError )
+{
+	assert ( m_iFD<0 );
+
+	m_sFile = sFile;
+	m_iFD = ::open ( sFile.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_BINARY, 0644 );
+	if ( m_iFD<0 )
+	{
+		sError = FormatStr ( "error creating '%s': %s", sFile.c_str(), strerror(errno) );
+		return false;
+	}
+
+	m_iEnd = iStartOffset;
+	m_bError = false;
+	m_sError = "";
+
+	return true;
+}
+
+
+void FileWriterExtents_c::Close()
+{
+	if ( m_iFD<0 )
+		return;
+
+	::close(m_iFD);
+	m_iFD = -1;
+}
+
+
+int64_t FileWriterExtents_c::Append ( const uint8_t * pData, size_t tLength )
+{
+	assert ( m_iFD>=0 );
+
+	// reserve the extent first; writes to different extents don't need to be serialized
+	int64_t iOffset = m_iEnd.fetch_add ( (int64_t)tLength );
+	if ( !PwriteWrapper ( m_iFD, pData, tLength, iOffset ) )
+	{
+		std::unique_lock<std::mutex> tGuard(m_tErrorLock);
+		m_sError = FormatStr ( "write error in '%s': %d (%s)", m_sFile.c_str(), errno, strerror(errno) );
+		m_bError = true;
+	}
+
+	return iOffset;
+}
+
+
+std::string FileWriterExtents_c::GetError() const
+{
+	std::unique_lock<std::mutex> tGuard(m_tErrorLock);
+	return m_sError;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 MemWriter_c::MemWriter_c ( std::vector<uint8_t> & dData )
 	: m_dData ( dData )
 {}
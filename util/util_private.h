@@ -17,6 +17,9 @@
 #pragma once
 
 #include "util.h"
+#include <atomic>
+#include <mutex>
+#include <chrono>
 
 #if defined(USE_SIMDE)
 	#define SIMDE_ENABLE_NATIVE_ALIASES 1
@@ -180,6 +183,7 @@ public:
 	void        Pack_uint64 ( uint64_t uValue ) { PackValue(uValue); }
 
 	int64_t     GetPos() const { return m_iFilePos + (int64_t)m_tUsed; }
+	size_t      GetBufferSize() const { return m_tSize; }
 
 private:
 	static const size_t DEFAULT_SIZE = 1048576;
@@ -216,6 +220,30 @@ public:
 	int64_t     GetPos() const { return m_iFilePos; }
 };
 
+// several writers (possibly on different threads) append whole extents to a single file
+class FileWriterExtents_c
+{
+public:
+				~FileWriterExtents_c();
+
+	bool		Open ( const std::string & sFile, int64_t iStartOffset, std::string & sError );
+	void		Close();
+
+	int64_t		Append ( const uint8_t * pData, size_t tLength );	// returns extent offset
+	int64_t		GetPos() const { return m_iEnd; }
+
+	bool		IsError() const	{ return m_bError; }
+	std::string	GetError() const;
+
+private:
+	int						m_iFD = -1;
+	std::string				m_sFile;
+	std::atomic<int64_t>	m_iEnd { 0 };
+	std::atomic<bool>		m_bError { false };
+	mutable std::mutex		m_tErrorLock;
+	std::string				m_sError;
+};
+
 
 class MemWriter_c
 {
@@ -227,7 +255,7 @@ public:
 
 	void    Write_uint8 ( uint8_t uValue ) { m_dData.push_back(uValue); }
 	void    Write_uint16 ( uint16_t uValue ) { WriteValue(uValue); }
-	void    Write_uint32 ( uint64_t uValue ) { WriteValue(uValue); }
+	void    Write_uint32 ( uint32_t uValue ) { WriteValue(uValue); }
 	void    Write_uint64 ( uint64_t uValue ) { WriteValue(uValue); }
 
 	void    Pack_uint32 ( uint32_t uValue ) { PackValue(uValue); }
@@ -264,6 +292,12 @@ std::string FormatStr ( const std::string & sFormat, Args ... args )
 }
 
 
+inline int64_t GetTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
 inline uint32_t FloatToUint ( float fValue )
 {
 	union { float m_fValue; uint32_t m_uValue; } tUnion;
@@ -279,6 +313,64 @@ inline float UintToFloat ( uint32_t uValue )
 	return tUnion.m_fValue;
 }
 
+// IEEE 754 half precision, round to nearest even
+inline uint16_t FloatToHalf ( float fValue )
+{
+	const uint32_t DENORM_MAGIC = ( ( 127-15 ) + ( 23-10 ) + 1 ) << 23;
+
+	uint32_t uValue = FloatToUint(fValue);
+	uint32_t uSign = uValue & 0x80000000;
+	uValue ^= uSign;
+
+	uint16_t uResult;
+	if ( uValue>=0x47800000 )		// inf or nan
+		uResult = uValue>0x7F800000 ? 0x7E00 : 0x7C00;
+	else if ( uValue<0x38800000 )	// denormal or zero; let fp addition do the rounding
+		uResult = uint16_t ( FloatToUint ( UintToFloat(uValue) + UintToFloat(DENORM_MAGIC) ) - DENORM_MAGIC );
+	else
+	{
+		uint32_t uMantOdd = ( uValue >> 13 ) & 1;
+		uValue += ( uint32_t(15-127) << 23 ) + 0xFFF + uMantOdd;
+		uResult = uint16_t ( uValue >> 13 );
+	}
+
+	return uResult | uint16_t ( uSign >> 16 );
+}
+
+
+inline float HalfToFloat ( uint16_t uValue )
+{
+	const uint32_t SHIFTED_EXP = 0x7C00 << 13;
+
+	uint32_t uResult = ( uValue & 0x7FFF ) << 13;
+	uint32_t uExp = uResult & SHIFTED_EXP;
+	uResult += ( 127-15 ) << 23;
+
+	if ( uExp==SHIFTED_EXP )		// inf or nan
+		uResult += ( 128-16 ) << 23;
+	else if ( !uExp )				// zero or denormal
+		uResult = FloatToUint ( UintToFloat ( uResult + ( 1 << 23 ) ) - UintToFloat ( 113 << 23 ) );
+
+	return UintToFloat ( uResult | ( uint32_t ( uValue & 0x8000 ) << 16 ) );
+}
+
+// bfloat16 (upper half of float32), round to nearest even
+inline uint16_t FloatToBFloat16 ( float fValue )
+{
+	uint32_t uValue = FloatToUint(fValue);
+	if ( ( uValue & 0x7FFFFFFF ) > 0x7F800000 )
+		return uint16_t ( ( uValue >> 16 ) | 0x40 );
+
+	uValue += 0x7FFF + ( ( uValue >> 16 ) & 1 );
+	return uint16_t ( uValue >> 16 );
+}
+
+
+inline float BFloat16ToFloat ( uint16_t uValue )
+{
+	return UintToFloat ( uint32_t(uValue) << 16 );
+}
+
 template <typename T>
 constexpr auto to_underlying(T t) noexcept
 {
@@ -402,4 +494,48 @@ inline int FillWithIncreasingValues ( uint32_t *& pRowID, size_t uNumValues, uin
     return (int)uNumValues;
 }
 
+FORCE_INLINE int PopCount64 ( uint64_t uValue )
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(uValue);
+#else
+	return __builtin_popcountll(uValue);
+#endif
+}
+
+// set bit positions for every byte value
+struct BitIndexTable_t
+{
+	uint8_t	m_dIndexes[256][8];
+	uint8_t	m_dCount[256];
+
+			BitIndexTable_t();
+};
+
+extern const BitIndexTable_t g_tBitIndexTable;
+
+// writes rowids of all set bits in a 64-bit word (bit i => tBaseRowID+i)
+// NOTE: may write up to 8 values past the last result
+FORCE_INLINE void BitmapWordToRowIDs ( uint64_t uWord, uint32_t tBaseRowID, uint32_t * & pRowID )
+{
+	if ( uWord==0xFFFFFFFFFFFFFFFFULL )
+	{
+		FillWithIncreasingValues ( pRowID, 64, tBaseRowID );
+		return;
+	}
+
+	for ( ; uWord; uWord >>= 8, tBaseRowID += 8 )
+	{
+		uint8_t uByte = uint8_t(uWord);
+		if ( !uByte )
+			continue;
+
+		__m128i tBase = _mm_set1_epi32 ( (int)tBaseRowID );
+		__m128i tIndexes = _mm_loadl_epi64 ( (const __m128i*)g_tBitIndexTable.m_dIndexes[uByte] );
+		_mm_storeu_si128 ( (__m128i*)pRowID,		_mm_add_epi32 ( _mm_cvtepu8_epi32(tIndexes), tBase ) );
+		_mm_storeu_si128 ( (__m128i*)(pRowID+4),	_mm_add_epi32 ( _mm_cvtepu8_epi32 ( _mm_srli_si128 ( tIndexes, 4 ) ), tBase ) );
+		pRowID += g_tBitIndexTable.m_dCount[uByte];
+	}
+}
+
 } // namespace util
\ No newline at end of file